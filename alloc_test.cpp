@@ -0,0 +1,121 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "alloc_tracker.h"
+#include "input_queue.h"
+#include "pong_game.h"
+#include "sound_cues.h"
+
+// Plays PongGame without a window the way the game loop does: a scripted
+// player one pressing keys partway through ticks, the CPU as player two,
+// sound cues queued and drained, and in some runs the recorder on. Ticks
+// settle as frames do in the game, and a settled tick that allocates fails
+// the test. The target is always built with PONG_TRACK_ALLOCATIONS.
+//
+// Only the match's ticks are covered: the menu and all drawing need a
+// window and a GL context for their textures, so their frames are still
+// checked by hand with the game's --check-allocations N.
+
+const std::uint32_t TICKS = 5000;
+const char* const RECORD_PATH = "pong_alloc_test.rec";
+
+static sf::Event KeyEvent(const sf::Keyboard::Key key, const bool pressed)
+{
+    sf::Event event = sf::Event();
+    event.type = pressed ? sf::Event::KeyPressed : sf::Event::KeyReleased;
+    event.key.code = key;
+    return event;
+}
+
+static AllocationStats Play(const PHYSICS physics, const float tickMilliseconds, const bool record)
+{
+    PongGame game(3);
+    game.SetPhysics(physics);
+    game.SetTickMilliseconds(tickMilliseconds);
+    game.SetCpuOpponent(CpuSettings::Normal());
+    SoundQueue sounds;
+    game.SetSoundQueue(&sounds);
+    if (record)
+        game.SetRecordPath(RECORD_PATH);
+
+    const sf::Keyboard::Key keys[] = { sf::Keyboard::Q,sf::Keyboard::Z,sf::Keyboard::Space };
+    bool held[3] = {};
+    std::uint32_t random = 2463534242u;
+
+    InputQueue inputs;
+    FrameAllocations ticks;
+    const InputQueue::Clock::duration tick =
+        std::chrono::duration_cast<InputQueue::Clock::duration>(std::chrono::duration<float, std::milli>(tickMilliseconds));
+    InputQueue::Clock::time_point tickEnd = InputQueue::Clock::now();
+    for (std::uint32_t i = 0; i < TICKS; ++i)
+    {
+        ticks.BeginFrame();
+        tickEnd += tick;
+
+        // about one tick in four presses or lets go of a key halfway through
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        if ((random & 3) == 0)
+        {
+            const std::uint32_t key = (random >> 2) % 3;
+            held[key] = !held[key];
+            inputs.HandleEvent(KeyEvent(keys[key], held[key]), tickEnd - tick / 2);
+        }
+
+        const GAME_STATE gameState = game.Update(tickMilliseconds, inputs, tickEnd);
+        SOUND sound;
+        while (sounds.Pop(sound))
+        {
+        }
+
+        // a finished match is written out and restarted, as the game does
+        if (gameState != GAME_STATE::IN_GAME)
+            game.Reset();
+        ticks.EndFrame(gameState == GAME_STATE::IN_GAME);
+    }
+    return ticks.GetStats();
+}
+
+int main()
+{
+    if (!AllocationTracker::IsEnabled())
+    {
+        std::cerr << "pong_alloc_test needs PONG_TRACK_ALLOCATIONS" << std::endl;
+        return 1;
+    }
+
+    struct Run
+    {
+        const char* name;
+        PHYSICS physics;
+        float tickMilliseconds;
+        bool record;
+    };
+    const Run runs[] = {
+        { "tick",PHYSICS::TICK,UPDATE_MS,false },
+        { "exact",PHYSICS::EXACT,UPDATE_MS,false },
+        { "fixed point",PHYSICS::FIXED_POINT,UPDATE_MS,false },
+        { "tick, recording",PHYSICS::TICK,UPDATE_MS,true },
+        { "tick at 1000 Hz",PHYSICS::TICK,MIN_UPDATE_MS,false },
+        { "tick at 1000 Hz, recording",PHYSICS::TICK,MIN_UPDATE_MS,true }
+    };
+
+    bool failed = false;
+    for (const Run& run : runs)
+    {
+        const AllocationStats stats = Play(run.physics, run.tickMilliseconds, run.record);
+        std::cout << run.name << ": " << stats.steadyFrames << " settled ticks, "
+            << stats.allocatingFrames << " allocating, " << stats.allocations << " allocations"
+            << " (max " << stats.maxPerFrame << " in a tick";
+        if (stats.allocatingFrames > 0)
+            std::cout << ", first at tick " << stats.firstAllocatingFrame;
+        std::cout << ")" << std::endl;
+        failed = failed || stats.allocatingFrames > 0 || stats.steadyFrames == 0;
+    }
+    std::remove(RECORD_PATH);
+    return failed ? 1 : 0;
+}
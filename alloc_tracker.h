@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Counts heap allocations on every thread. The count only moves when the
+// program is built with PONG_TRACK_ALLOCATIONS, which replaces the global
+// operator new below; since that defines the operators, include this header
+// from one translation unit per program.
+class AllocationTracker
+{
+public:
+    static bool IsEnabled()
+    {
+#ifdef PONG_TRACK_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static std::uint64_t GetCount()
+    {
+        return Counter().load(std::memory_order_relaxed);
+    }
+
+    static void Record()
+    {
+        Counter().fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    static std::atomic<std::uint64_t>& Counter()
+    {
+        // constant-initialised, so safe to use from operator new before main
+        static std::atomic<std::uint64_t> count(0);
+        return count;
+    }
+};
+
+struct AllocationStats
+{
+    std::uint64_t steadyFrames = 0;
+    std::uint64_t allocatingFrames = 0;
+    std::uint64_t allocations = 0;
+    std::uint64_t maxPerFrame = 0;
+    // counted from 1 over every frame ended, steady or not; 0 for none
+    std::uint64_t firstAllocatingFrame = 0;
+};
+
+// Allocations per frame. A frame is steady once the game has stayed in the
+// same state for WARMUP_FRAMES, which gives containers, textures and
+// per-thread buffers time to reach their working size; only steady frames
+// go into the stats, and a steady frame should allocate nothing.
+class FrameAllocations
+{
+public:
+    static const std::uint32_t WARMUP_FRAMES = 60;
+
+    FrameAllocations()
+        :
+        m_frameStart(0),
+        m_frames(0),
+        m_settledFrames(0)
+    {
+    }
+
+    void BeginFrame()
+    {
+        m_frameStart = AllocationTracker::GetCount();
+    }
+
+    // settled is false when the frame changed state; returns the frame's
+    // allocations if it was steady and 0 otherwise
+    std::uint64_t EndFrame(const bool settled)
+    {
+        const std::uint64_t allocations = AllocationTracker::GetCount() - m_frameStart;
+        ++m_frames;
+        if (!settled)
+        {
+            m_settledFrames = 0;
+            return 0;
+        }
+        if (m_settledFrames < WARMUP_FRAMES)
+        {
+            ++m_settledFrames;
+            return 0;
+        }
+
+        ++m_stats.steadyFrames;
+        if (allocations > 0)
+        {
+            if (m_stats.allocatingFrames == 0)
+                m_stats.firstAllocatingFrame = m_frames;
+            ++m_stats.allocatingFrames;
+            m_stats.allocations += allocations;
+            if (allocations > m_stats.maxPerFrame)
+                m_stats.maxPerFrame = allocations;
+        }
+        return allocations;
+    }
+
+    const AllocationStats& GetStats() const
+    {
+        return m_stats;
+    }
+
+private:
+    std::uint64_t m_frameStart;
+    std::uint64_t m_frames;
+    std::uint32_t m_settledFrames;
+    AllocationStats m_stats;
+};
+
+#ifdef PONG_TRACK_ALLOCATIONS
+#if defined(__GNUC__) && !defined(__clang__)
+// inlined into callers, the frees below look mismatched with their new
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// The nothrow and array forms of the standard library call these, so
+// replacing the plain and aligned forms catches every allocation.
+void* operator new(std::size_t size)
+{
+    AllocationTracker::Record();
+    if (void* memory = std::malloc(size != 0 ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    AllocationTracker::Record();
+    const std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    if (void* memory = _aligned_malloc(size != 0 ? size : 1, align))
+        return memory;
+#else
+    void* memory = nullptr;
+    if (posix_memalign(&memory, align < sizeof(void*) ? sizeof(void*) : align, size != 0 ? size : 1) == 0)
+        return memory;
+#endif
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+    operator delete(memory, alignment);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A whole file mapped read-only into memory rather than read, so opening it
+// costs the same however big it is and pages only come in when touched.
+class MappedFile
+{
+public:
+    MappedFile()
+        :
+        m_data(nullptr),
+        m_size(0)
+    {
+    }
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path)
+    {
+        Close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr)
+            return false;
+        m_data = static_cast<const std::uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping);
+        if (m_data == nullptr)
+            return false;
+        m_size = static_cast<std::size_t>(size.QuadPart);
+#else
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+        struct stat status;
+        void* data = MAP_FAILED;
+        if (fstat(file, &status) == 0 && status.st_size > 0)
+            data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (data == MAP_FAILED)
+            return false;
+        m_data = static_cast<const std::uint8_t*>(data);
+        m_size = static_cast<std::size_t>(status.st_size);
+#endif
+        return true;
+    }
+
+    void Close()
+    {
+        if (m_data == nullptr)
+            return;
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(const_cast<std::uint8_t*>(m_data), m_size);
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    const std::uint8_t* GetData() const
+    {
+        return m_data;
+    }
+
+    std::size_t GetSize() const
+    {
+        return m_size;
+    }
+
+private:
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+};
+
+// Pack layout: a header, a table of named entries, then each entry's bytes
+// at an offset aligned for in-place use. Little-endian, as every platform
+// the game ships on is.
+const char PACK_MAGIC[4] = { 'P','P','A','K' };
+const std::uint32_t PACK_VERSION = 1;
+const std::size_t PACK_ALIGNMENT = 16;
+
+struct PackHeader
+{
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t entryCount;
+    std::uint32_t reserved;
+};
+
+struct PackEntry
+{
+    char name[48];
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+
+// Glyph metrics as sf::Glyph holds them, at the atlas's character size.
+// Bounds are relative to the pen position on the baseline.
+struct PackGlyph
+{
+    float advance;
+    float left;
+    float top;
+    float width;
+    float height;
+    std::int32_t textureLeft;
+    std::int32_t textureTop;
+    std::int32_t textureWidth;
+    std::int32_t textureHeight;
+};
+
+// One character size of pre-rasterised glyphs, indexed by ASCII code;
+// followed in the pack by width * height RGBA pixels.
+struct PackAtlas
+{
+    static const std::size_t GLYPH_COUNT = 128;
+
+    std::uint32_t characterSize;
+    std::uint32_t width;
+    std::uint32_t height;
+    float lineSpacing;
+    PackGlyph glyphs[GLYPH_COUNT];
+};
+
+// An opened pack. Opening checks the header and the entry table bounds and
+// nothing else; entries are used straight from the mapping.
+class AssetPack
+{
+public:
+    AssetPack()
+        :
+        m_entries(nullptr),
+        m_entryCount(0)
+    {
+    }
+
+    bool Open(const std::string& path)
+    {
+        m_entries = nullptr;
+        m_entryCount = 0;
+        if (!m_file.Open(path) || m_file.GetSize() < sizeof(PackHeader))
+            return false;
+
+        const PackHeader* header = reinterpret_cast<const PackHeader*>(m_file.GetData());
+        if (std::memcmp(header->magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || header->version != PACK_VERSION ||
+            sizeof(PackHeader) + static_cast<std::uint64_t>(header->entryCount) * sizeof(PackEntry) > m_file.GetSize())
+        {
+            m_file.Close();
+            return false;
+        }
+
+        m_entries = reinterpret_cast<const PackEntry*>(m_file.GetData() + sizeof(PackHeader));
+        m_entryCount = header->entryCount;
+        return true;
+    }
+
+    bool IsOpen() const
+    {
+        return m_entries != nullptr;
+    }
+
+    // the named entry's bytes, or nullptr if the pack has none or it lies outside the file
+    const void* Find(const char* name, std::size_t& size) const
+    {
+        for (std::uint32_t i = 0; i < m_entryCount; ++i)
+        {
+            const PackEntry& entry = m_entries[i];
+            if (std::strncmp(entry.name, name, sizeof(entry.name)) != 0)
+                continue;
+            if (entry.offset > m_file.GetSize() || entry.size > m_file.GetSize() - entry.offset)
+                return nullptr;
+            size = static_cast<std::size_t>(entry.size);
+            return m_file.GetData() + entry.offset;
+        }
+        return nullptr;
+    }
+
+private:
+    MappedFile m_file;
+    const PackEntry* m_entries;
+    std::uint32_t m_entryCount;
+};
+
+// builds a pack; used by the pong_pack build step
+class AssetPackWriter
+{
+public:
+    void Add(const std::string& name, const void* data, const std::size_t size)
+    {
+        const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+        m_names.push_back(name);
+        m_blobs.emplace_back(bytes, bytes + size);
+    }
+
+    bool Write(const std::string& path) const
+    {
+        std::vector<PackEntry> entries(m_blobs.size());
+        std::uint64_t offset = Align(sizeof(PackHeader) + entries.size() * sizeof(PackEntry));
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            if (m_names[i].size() >= sizeof(entries[i].name))
+                return false;
+            std::memset(entries[i].name, 0, sizeof(entries[i].name));
+            std::memcpy(entries[i].name, m_names[i].data(), m_names[i].size());
+            entries[i].offset = offset;
+            entries[i].size = m_blobs[i].size();
+            offset = Align(offset + m_blobs[i].size());
+        }
+
+        PackHeader header;
+        std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+        header.version = PACK_VERSION;
+        header.entryCount = static_cast<std::uint32_t>(entries.size());
+        header.reserved = 0;
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PackEntry)));
+        std::uint64_t written = sizeof(header) + entries.size() * sizeof(PackEntry);
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            static const char padding[PACK_ALIGNMENT] = {};
+            file.write(padding, static_cast<std::streamsize>(entries[i].offset - written));
+            file.write(reinterpret_cast<const char*>(m_blobs[i].data()), static_cast<std::streamsize>(m_blobs[i].size()));
+            written = entries[i].offset + m_blobs[i].size();
+        }
+        return static_cast<bool>(file);
+    }
+
+private:
+    static std::uint64_t Align(const std::uint64_t offset)
+    {
+        return (offset + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+    }
+
+    std::vector<std::string> m_names;
+    std::vector<std::vector<std::uint8_t>> m_blobs;
+};
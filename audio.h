@@ -0,0 +1,113 @@
+#pragma once
+
+#include <SFML/Audio.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+#include "sound_cues.h"
+
+// Plays the match sounds queued by whichever thread steps the match. Every
+// buffer is loaded once at startup and every voice is bound to its buffer
+// then, since binding a buffer to an sf::Sound allocates; playing a
+// sound is only a stop and play on a voice that is already set up. Each
+// sound has its own few voices and, when all are busy, takes over the one
+// that started longest ago.
+class AudioEngine
+{
+public:
+    static const std::size_t VOICES_PER_SOUND = 4;
+
+    // sounds come from the pack when it has them and are synthesised otherwise
+    explicit AudioEngine(const AssetPack* pack)
+        :
+        m_started(0),
+        m_available(true),
+        m_muted(false)
+    {
+        std::vector<std::int16_t> synthesized;
+        for (std::size_t sound = 0; sound < SOUND_COUNT; ++sound)
+        {
+            const std::string name = "sound." + std::to_string(sound);
+            std::size_t size = 0;
+            const void* packed = pack != nullptr ? pack->Find(name.c_str(), size) : nullptr;
+            if (packed != nullptr)
+                m_available &= m_buffers[sound].loadFromSamples(static_cast<const sf::Int16*>(packed), size / sizeof(sf::Int16), 1, SOUND_SAMPLE_RATE);
+            else
+            {
+                SoundSynthesizer::Synthesize(static_cast<SOUND>(sound), synthesized);
+                m_available &= m_buffers[sound].loadFromSamples(synthesized.data(), synthesized.size(), 1, SOUND_SAMPLE_RATE);
+            }
+
+            for (Voice& voice : m_voices[sound])
+            {
+                voice.sound.setBuffer(m_buffers[sound]);
+                voice.started = 0;
+            }
+        }
+    }
+
+    AudioEngine(const AudioEngine&) = delete;
+    AudioEngine& operator=(const AudioEngine&) = delete;
+
+    SoundQueue& GetQueue()
+    {
+        return m_queue;
+    }
+
+    void SetMuted(const bool muted)
+    {
+        m_muted = muted;
+    }
+
+    // plays everything queued since the last call; call often from one thread
+    void Update()
+    {
+        SOUND sound;
+        while (m_queue.Pop(sound))
+        {
+            if (m_available && !m_muted)
+                Play(sound);
+        }
+    }
+
+private:
+    static const std::size_t SOUND_COUNT = static_cast<std::size_t>(SOUND::COUNT);
+
+    struct Voice
+    {
+        sf::Sound sound;
+        std::uint64_t started;
+    };
+
+    void Play(const SOUND sound)
+    {
+        std::array<Voice, VOICES_PER_SOUND>& voices = m_voices[static_cast<std::size_t>(sound)];
+        Voice* chosen = &voices[0];
+        for (Voice& voice : voices)
+        {
+            if (voice.sound.getStatus() == sf::Sound::Stopped)
+            {
+                chosen = &voice;
+                break;
+            }
+            if (voice.started < chosen->started)
+                chosen = &voice;
+        }
+
+        chosen->sound.stop();
+        chosen->sound.play();
+        chosen->started = ++m_started;
+    }
+
+    // buffers first, so the voices using them are destroyed before them
+    std::array<sf::SoundBuffer, SOUND_COUNT> m_buffers;
+    std::array<std::array<Voice, VOICES_PER_SOUND>, SOUND_COUNT> m_voices;
+    SoundQueue m_queue;
+    std::uint64_t m_started;
+    bool m_available;
+    bool m_muted;
+};
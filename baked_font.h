@@ -0,0 +1,208 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "asset_pack.h"
+
+// One character size of a font, rasterised ahead of time into a single
+// texture: either read from the asset pack, where the glyph table is used in
+// place and the pixels go straight to the GPU, or baked from an sf::Font at
+// startup when there is no pack. Text drawn with it never rasterises.
+class BakedAtlas
+{
+public:
+    BakedAtlas()
+        :
+        m_atlas(nullptr)
+    {
+    }
+
+    BakedAtlas(const BakedAtlas&) = delete;
+    BakedAtlas& operator=(const BakedAtlas&) = delete;
+
+    // rasterises printable ASCII from font now
+    bool Bake(const sf::Font& font, const unsigned characterSize)
+    {
+        std::memset(&m_owned, 0, sizeof(m_owned));
+        for (unsigned code = FIRST_PRINTABLE; code <= LAST_PRINTABLE; ++code)
+        {
+            const sf::Glyph& glyph = font.getGlyph(code, characterSize, false);
+            m_owned.glyphs[code] = { glyph.advance,
+                glyph.bounds.left,glyph.bounds.top,glyph.bounds.width,glyph.bounds.height,
+                glyph.textureRect.left,glyph.textureRect.top,glyph.textureRect.width,glyph.textureRect.height };
+        }
+
+        // the font's page only grows, and keeps every glyph where it first put it
+        m_texture = font.getTexture(characterSize);
+        m_owned.characterSize = characterSize;
+        m_owned.width = m_texture.getSize().x;
+        m_owned.height = m_texture.getSize().y;
+        m_owned.lineSpacing = font.getLineSpacing(characterSize);
+        m_atlas = &m_owned;
+        return m_owned.width > 0;
+    }
+
+    // the atlas the pack holds for characterSize; the pack must stay open
+    bool Load(const AssetPack& pack, const unsigned characterSize)
+    {
+        std::size_t size = 0;
+        const void* data = pack.Find(GetEntryName(characterSize).c_str(), size);
+        if (data == nullptr || size < sizeof(PackAtlas))
+            return false;
+
+        const PackAtlas* atlas = static_cast<const PackAtlas*>(data);
+        if (atlas->characterSize != characterSize || size - sizeof(PackAtlas) < static_cast<std::uint64_t>(atlas->width) * atlas->height * 4 ||
+            !m_texture.create(atlas->width, atlas->height))
+            return false;
+
+        m_texture.update(static_cast<const sf::Uint8*>(data) + sizeof(PackAtlas));
+        m_texture.setSmooth(true);
+        m_atlas = atlas;
+        return true;
+    }
+
+    // adds the atlas to a pack being built
+    void AddTo(AssetPackWriter& writer) const
+    {
+        const sf::Image image = m_texture.copyToImage();
+        std::string bytes(reinterpret_cast<const char*>(m_atlas), sizeof(PackAtlas));
+        bytes.append(reinterpret_cast<const char*>(image.getPixelsPtr()), static_cast<std::size_t>(m_atlas->width) * m_atlas->height * 4);
+        writer.Add(GetEntryName(m_atlas->characterSize), bytes.data(), bytes.size());
+    }
+
+    static std::string GetEntryName(const unsigned characterSize)
+    {
+        return "atlas." + std::to_string(characterSize);
+    }
+
+    bool IsLoaded() const
+    {
+        return m_atlas != nullptr;
+    }
+
+    // characters that were not baked have no size and no advance
+    const PackGlyph& GetGlyph(const char character) const
+    {
+        const unsigned char code = static_cast<unsigned char>(character);
+        return m_atlas->glyphs[code < PackAtlas::GLYPH_COUNT ? code : 0];
+    }
+
+    unsigned GetCharacterSize() const
+    {
+        return m_atlas->characterSize;
+    }
+
+    const sf::Texture& GetTexture() const
+    {
+        return m_texture;
+    }
+
+private:
+    static const unsigned FIRST_PRINTABLE = 32;
+    static const unsigned LAST_PRINTABLE = 126;
+
+    const PackAtlas* m_atlas;
+    PackAtlas m_owned;
+    sf::Texture m_texture;
+};
+
+// A short line of text drawn from a BakedAtlas. The quads live in a fixed
+// array and are only rebuilt when the string, position or colour changes,
+// so drawing never allocates. Positioned like sf::Text, from the top left
+// with the baseline one character size down; kerning is not applied.
+class BakedText
+{
+public:
+    static const std::size_t MAX_CHARACTERS = 32;
+
+    BakedText(const BakedAtlas& atlas)
+        :
+        m_atlas(atlas),
+        m_position(0, 0),
+        m_color(sf::Color::White),
+        m_length(0),
+        m_width(0)
+    {
+        m_text[0] = '\0';
+    }
+
+    // longer strings are cut at MAX_CHARACTERS
+    void SetString(const char* text)
+    {
+        m_length = 0;
+        while (m_length < MAX_CHARACTERS && text[m_length] != '\0')
+        {
+            m_text[m_length] = text[m_length];
+            ++m_length;
+        }
+        m_text[m_length] = '\0';
+        Build();
+    }
+
+    void SetPosition(const sf::Vector2f position)
+    {
+        m_position = position;
+        Build();
+    }
+
+    void SetColor(const sf::Color color)
+    {
+        m_color = color;
+        Build();
+    }
+
+    // advance of the whole string
+    float GetWidth() const
+    {
+        return m_width;
+    }
+
+    void Draw(sf::RenderTarget& target) const
+    {
+        sf::RenderStates states;
+        states.texture = &m_atlas.GetTexture();
+        target.draw(m_vertices.data(), m_length * 6, sf::Triangles, states);
+    }
+
+private:
+    void Build()
+    {
+        float x = m_position.x;
+        const float baseline = m_position.y + m_atlas.GetCharacterSize();
+        for (std::size_t i = 0; i < m_length; ++i)
+        {
+            const PackGlyph& glyph = m_atlas.GetGlyph(m_text[i]);
+            const float left = x + glyph.left;
+            const float top = baseline + glyph.top;
+            const float right = left + glyph.width;
+            const float bottom = top + glyph.height;
+            const float textureLeft = static_cast<float>(glyph.textureLeft);
+            const float textureTop = static_cast<float>(glyph.textureTop);
+            const float textureRight = textureLeft + glyph.textureWidth;
+            const float textureBottom = textureTop + glyph.textureHeight;
+
+            sf::Vertex* quad = &m_vertices[i * 6];
+            quad[0] = sf::Vertex({ left,top }, m_color, { textureLeft,textureTop });
+            quad[1] = sf::Vertex({ right,top }, m_color, { textureRight,textureTop });
+            quad[2] = sf::Vertex({ right,bottom }, m_color, { textureRight,textureBottom });
+            quad[3] = quad[0];
+            quad[4] = quad[2];
+            quad[5] = sf::Vertex({ left,bottom }, m_color, { textureLeft,textureBottom });
+            x += glyph.advance;
+        }
+        m_width = x - m_position.x;
+    }
+
+    const BakedAtlas& m_atlas;
+    sf::Vector2f m_position;
+    sf::Color m_color;
+    std::array<char, MAX_CHARACTERS + 1> m_text;
+    std::size_t m_length;
+    float m_width;
+    std::array<sf::Vertex, MAX_CHARACTERS * 6> m_vertices;
+};
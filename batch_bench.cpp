@@ -0,0 +1,181 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "pong_batch.h"
+#include "pong_core.h"
+
+// Compares PongBatch against N separate PongSimulation objects stepping the
+// same matches with the same inputs, then checks that all three agree.
+
+const std::uint64_t INPUT_PERIOD = 64;
+
+// per-match input stream: always serving, paddles wander randomly
+static std::uint8_t NextInput(std::uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    std::uint8_t bits = PongInput::SERVE;
+    switch (state & 3)
+    {
+    case 0: bits |= PongInput::PLAYER_ONE_UP; break;
+    case 1: bits |= PongInput::PLAYER_ONE_DOWN; break;
+    default: break;
+    }
+    switch ((state >> 2) & 3)
+    {
+    case 0: bits |= PongInput::PLAYER_TWO_UP; break;
+    case 1: bits |= PongInput::PLAYER_TWO_DOWN; break;
+    default: break;
+    }
+    return bits;
+}
+
+// inputs are generated up front and replayed every INPUT_PERIOD ticks so the
+// timed loops measure stepping, not the random number generator
+static std::vector<std::uint8_t> MakeInputs(const std::size_t matches)
+{
+    std::vector<std::uint8_t> inputs(INPUT_PERIOD * matches);
+    for (std::size_t i = 0; i < matches; ++i)
+    {
+        std::uint32_t state = static_cast<std::uint32_t>(i * 2654435761u + 1);
+        for (std::uint64_t tick = 0; tick < INPUT_PERIOD; ++tick)
+            inputs[tick * matches + i] = NextInput(state);
+    }
+    return inputs;
+}
+
+struct RunResult
+{
+    double seconds;
+    std::uint64_t finished;
+};
+
+static RunResult RunObjects(std::vector<PongSimulation>& matches, const std::vector<std::uint8_t>& inputs, const std::uint64_t ticks)
+{
+    std::uint64_t finished = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::uint64_t tick = 0; tick < ticks; ++tick)
+    {
+        const std::uint8_t* tickInputs = &inputs[tick % INPUT_PERIOD * matches.size()];
+        for (std::size_t i = 0; i < matches.size(); ++i)
+        {
+            if (matches[i].Update(UPDATE_MS, PongInput::FromBits(tickInputs[i])) != GAME_STATE::IN_GAME)
+            {
+                matches[i].Reset();
+                ++finished;
+            }
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return { elapsed.count(),finished };
+}
+
+static RunResult RunBatch(PongBatch& batch, const std::vector<std::uint8_t>& inputs, const std::uint64_t ticks, const bool scalar)
+{
+    const std::size_t matches = batch.GetMatchCount();
+    std::uint64_t finished = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::uint64_t tick = 0; tick < ticks; ++tick)
+    {
+        std::memcpy(batch.GetInputs(), &inputs[tick % INPUT_PERIOD * matches], matches);
+
+        if (scalar)
+            batch.StepScalar(UPDATE_MS);
+        else
+            batch.Step(UPDATE_MS);
+        finished += batch.ResetFinished();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return { elapsed.count(),finished };
+}
+
+static std::size_t CountMismatches(const std::vector<PongSimulation>& matches, const PongBatch& batch)
+{
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < matches.size(); ++i)
+    {
+        const PongSimulation& match = matches[i];
+        if (match.GetBall().GetPosition().x != batch.GetBallX()[i] ||
+            match.GetBall().GetPosition().y != batch.GetBallY()[i] ||
+            match.GetBall().GetVelocity().x != batch.GetBallDX()[i] ||
+            match.GetBall().GetVelocity().y != batch.GetBallDY()[i] ||
+            match.GetPlayerOne().GetPositionSize().y != batch.GetPlayerOneY()[i] ||
+            match.GetPlayerTwo().GetPositionSize().y != batch.GetPlayerTwoY()[i] ||
+            match.GetPlayerOneScore() != batch.GetPlayerOneScore()[i] ||
+            match.GetPlayerTwoScore() != batch.GetPlayerTwoScore()[i] ||
+            static_cast<float>(match.GetPlayState()) != batch.GetPlayState()[i])
+            ++mismatches;
+    }
+    return mismatches;
+}
+
+static void Report(const char* name, const RunResult& result, const std::size_t matches, const std::uint64_t ticks, const double baseline)
+{
+    const double matchTicks = static_cast<double>(matches) * ticks;
+    std::cout << name
+        << "  seconds: " << result.seconds
+        << "  match ticks/s: " << matchTicks / result.seconds
+        << "  matches/s: " << result.finished / result.seconds
+        << "  speedup: " << baseline / result.seconds << "x" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t matches = 4096;
+    std::uint64_t ticks = 2000;
+    int scoreToWin = 3;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--matches") == 0 && hasValue)
+            matches = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--ticks") == 0 && hasValue)
+            ticks = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--score") == 0 && hasValue)
+            scoreToWin = std::atoi(argv[++i]);
+        else
+        {
+            std::cerr << "usage: pong_batch_bench [--matches N] [--ticks N] [--score N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (matches == 0 || scoreToWin < 1 || scoreToWin > 255)
+    {
+        std::cerr << "need at least one match and a score to win between 1 and 255" << std::endl;
+        return 1;
+    }
+
+    const std::uint_fast8_t maxScore = static_cast<std::uint_fast8_t>(scoreToWin);
+
+    std::vector<PongSimulation> objects(matches, PongSimulation(maxScore));
+    PongBatch scalarBatch(matches, maxScore);
+    PongBatch simdBatch(matches, maxScore);
+
+    const std::vector<std::uint8_t> inputs = MakeInputs(matches);
+    const RunResult objectResult = RunObjects(objects, inputs, ticks);
+    const RunResult scalarResult = RunBatch(scalarBatch, inputs, ticks, true);
+    const RunResult simdResult = RunBatch(simdBatch, inputs, ticks, false);
+
+    std::cout << matches << " matches x " << ticks << " ticks, " << PongBatch::GetLaneWidth() << " lanes per instruction" << std::endl;
+    Report("PongSimulation x N", objectResult, matches, ticks, objectResult.seconds);
+    Report("PongBatch scalar  ", scalarResult, matches, ticks, objectResult.seconds);
+    Report("PongBatch simd    ", simdResult, matches, ticks, objectResult.seconds);
+
+    const std::size_t scalarMismatches = CountMismatches(objects, scalarBatch);
+    const std::size_t simdMismatches = CountMismatches(objects, simdBatch);
+    std::cout << "mismatched matches: scalar " << scalarMismatches << ", simd " << simdMismatches << std::endl;
+
+    return scalarMismatches == 0 && simdMismatches == 0 ? 0 : 1;
+}
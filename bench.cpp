@@ -0,0 +1,593 @@
+#ifdef PONG_BENCH_SFML
+#include <SFML/Graphics.hpp>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#ifdef PONG_BENCH_SFML
+#include "game.h"
+#include "input_queue.h"
+#endif
+#include "pong_ai.h"
+#include "pong_core.h"
+
+// Micro and macro benchmarks for the game's hot paths. The simulation cases
+// always build; the drawing and menu cases need SFML and a font and are
+// compiled in with PONG_BENCH_SFML. Results can be written as JSON to track
+// regressions between releases.
+
+struct BenchResult
+{
+    std::string name;
+    double nsPerOp;
+    double minNsPerOp;
+    double maxNsPerOp;
+    std::uint64_t iterations;
+};
+
+// a figure measured some other way than ns per op, e.g. a search depth
+struct BenchMetric
+{
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+const int SAMPLES = 5;
+
+// keeps results alive so the optimizer can't drop the work being timed
+static volatile float g_sink;
+
+class Bench
+{
+public:
+    Bench(const double minSeconds, const std::string& filter)
+        :
+        m_minSeconds(minSeconds),
+        m_filter(filter)
+    {
+    }
+
+    // whether --filter lets the named case run
+    bool Wants(const std::string& name) const
+    {
+        return m_filter.empty() || name.find(m_filter) != std::string::npos;
+    }
+
+    // Times op, which returns a float derived from its work. The batch size
+    // doubles until a batch fills its share of minSeconds; the reported
+    // figure is the median of SAMPLES batches.
+    template <class Op>
+    void Run(const std::string& name, Op op)
+    {
+        if (!Wants(name))
+            return;
+
+        std::uint64_t batch = 1;
+        for (;;)
+        {
+            if (Time(op, batch) >= m_minSeconds / SAMPLES || batch >= (1ull << 40))
+                break;
+            batch *= 2;
+        }
+
+        std::vector<double> samples;
+        for (int i = 0; i < SAMPLES; ++i)
+            samples.push_back(Time(op, batch) * 1e9 / batch);
+        std::sort(samples.begin(), samples.end());
+
+        const BenchResult result = { name,samples[SAMPLES / 2],samples.front(),samples.back(),batch * SAMPLES };
+        std::cout << name << std::string(name.size() < 32 ? 32 - name.size() : 1, ' ')
+            << result.nsPerOp << " ns/op  (min " << result.minNsPerOp << ", max " << result.maxNsPerOp << ")" << std::endl;
+        m_results.push_back(result);
+    }
+
+    // the caller prints it; this only keeps it for the JSON
+    void Record(const std::string& name, const double value, const std::string& unit)
+    {
+        m_metrics.push_back({ name,value,unit });
+    }
+
+    bool WriteJson(const std::string& path) const
+    {
+        std::ofstream file(path);
+        const std::time_t now = std::time(nullptr);
+        char timestamp[32];
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        file << "{\n"
+            << "  \"timestamp\": \"" << timestamp << "\",\n"
+#ifdef __VERSION__
+            << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+#endif
+#ifdef NDEBUG
+            << "  \"optimized\": true,\n"
+#else
+            << "  \"optimized\": false,\n"
+#endif
+            << "  \"min_seconds\": " << m_minSeconds << ",\n"
+            << "  \"benchmarks\": [\n";
+        for (std::size_t i = 0; i < m_results.size(); ++i)
+        {
+            const BenchResult& result = m_results[i];
+            file << "    { \"name\": \"" << result.name
+                << "\", \"ns_per_op\": " << result.nsPerOp
+                << ", \"min_ns_per_op\": " << result.minNsPerOp
+                << ", \"max_ns_per_op\": " << result.maxNsPerOp
+                << ", \"iterations\": " << result.iterations << " }"
+                << (i + 1 < m_results.size() ? ",\n" : "\n");
+        }
+        file << "  ],\n"
+            << "  \"metrics\": [\n";
+        for (std::size_t i = 0; i < m_metrics.size(); ++i)
+        {
+            const BenchMetric& metric = m_metrics[i];
+            file << "    { \"name\": \"" << metric.name
+                << "\", \"value\": " << metric.value
+                << ", \"unit\": \"" << metric.unit << "\" }"
+                << (i + 1 < m_metrics.size() ? ",\n" : "\n");
+        }
+        file << "  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+
+private:
+    template <class Op>
+    static double Time(Op& op, const std::uint64_t batch)
+    {
+        float sink = 0;
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (std::uint64_t i = 0; i < batch; ++i)
+            sink += op();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        g_sink = sink;
+        return elapsed.count();
+    }
+
+    double m_minSeconds;
+    std::string m_filter;
+    std::vector<BenchResult> m_results;
+    std::vector<BenchMetric> m_metrics;
+};
+
+// serves, and moves the paddles flagged in follow toward the ball
+static PongInput Chase(const PongSimulation& simulation, const bool followOne, const bool followTwo)
+{
+    const float ballY = simulation.GetBall().GetPosition().y;
+    const float centerOne = simulation.GetPlayerOne().GetPositionSize().y + PADDLE_LENGTH / 2;
+    const float centerTwo = simulation.GetPlayerTwo().GetPositionSize().y + PADDLE_LENGTH / 2;
+
+    PongInput input;
+    input.serve = true;
+    input.playerOneUp = followOne && ballY < centerOne - PADDLE_LENGTH / 4;
+    input.playerOneDown = followOne && ballY > centerOne + PADDLE_LENGTH / 4;
+    input.playerTwoUp = followTwo && ballY < centerTwo - PADDLE_LENGTH / 4;
+    input.playerTwoDown = followTwo && ballY > centerTwo + PADDLE_LENGTH / 4;
+    return input;
+}
+
+// Plays a fresh match with both paddles chasing the ball until the step
+// after the current state would satisfy trigger(before, after), and
+// returns the state before it.
+template <class Trigger>
+static PongSimulation FindState(Trigger trigger)
+{
+    PongSimulation simulation(3);
+    for (int tick = 0; tick < 100000; ++tick)
+    {
+        PongSimulation next = simulation;
+        next.Update(UPDATE_MS, Chase(simulation, true, true));
+        if (trigger(simulation, next))
+            return simulation;
+        simulation = next;
+    }
+    std::cerr << "benchmark setup never reached its state" << std::endl;
+    std::exit(1);
+}
+
+static float BallDY(const PongSimulation& simulation)
+{
+    return simulation.GetBall().GetVelocity().y;
+}
+
+// a cheap way to hand a result to the sink
+static float Observe(const PongSimulation& simulation)
+{
+    return simulation.GetBall().GetPosition().x + simulation.GetPlayerOne().GetPositionSize().y;
+}
+
+// Depth-first lookahead for player two over up, stay and down, each move
+// held for PLY_TICKS ticks while player one chases the ball. Every node
+// restores its parent's PongState into one scratch simulation, steps it and
+// forks the result, which is the pattern a tree search branches with.
+class LookaheadSearch
+{
+public:
+    static const int PLY_TICKS = 3;
+
+    LookaheadSearch()
+        :
+        m_scratch(3),
+        m_nodes(0)
+    {
+    }
+
+    float Search(const PongState& state, const int depth)
+    {
+        ++m_nodes;
+        if (depth == 0)
+            return Evaluate(state);
+
+        float best = -std::numeric_limits<float>::max();
+        for (int move = 0; move < 3; ++move)
+        {
+            m_scratch.Restore(state);
+            for (int tick = 0; tick < PLY_TICKS; ++tick)
+            {
+                PongInput input = Chase(m_scratch, true, false);
+                input.playerTwoUp = move == 0;
+                input.playerTwoDown = move == 2;
+                m_scratch.Update(UPDATE_MS, input);
+            }
+            const PongState child = m_scratch.Fork();
+
+            // a goal ends the line
+            float value;
+            if (child.playerOneScore != state.playerOneScore)
+                value = -1000;
+            else if (child.playerTwoScore != state.playerTwoScore)
+                value = 1000;
+            else
+                value = Search(child, depth - 1);
+            best = value > best ? value : best;
+        }
+        return best;
+    }
+
+    std::uint64_t GetNodes() const
+    {
+        return m_nodes;
+    }
+
+private:
+    // stay level with a ball on its way
+    static float Evaluate(const PongState& state)
+    {
+        if (state.playState != PLAY_STATE::TOWARD_PLAYER_TWO)
+            return 0;
+        return -std::fabs(state.playerTwoY + PADDLE_LENGTH / 2 - state.ballY);
+    }
+
+    PongSimulation m_scratch;
+    std::uint64_t m_nodes;
+};
+
+// Deepens the search one ply at a time from start and reports the deepest
+// search that finished inside one UPDATE_MS frame.
+static void LookaheadBenchmark(Bench& bench, const PongSimulation& start)
+{
+    const PongState root = start.Fork();
+    int depth = 0;
+    std::uint64_t nodes = 0;
+    double seconds = 0;
+    for (int next = 1; next < 32; ++next)
+    {
+        LookaheadSearch search;
+        const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        g_sink = search.Search(root, next);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+        if ((seconds + elapsed.count()) * 1000 > UPDATE_MS)
+            break;
+        seconds += elapsed.count();
+        nodes += search.GetNodes();
+        depth = next;
+    }
+
+    std::cout << "lookahead_search_frame          depth " << depth << " (" << depth * LookaheadSearch::PLY_TICKS
+        << " ticks) in one " << UPDATE_MS << " ms frame, " << nodes << " nodes, "
+        << (seconds > 0 ? nodes / seconds : 0.0) << " forks/s" << std::endl;
+    bench.Record("lookahead_search_frame_depth", depth, "plies");
+    bench.Record("lookahead_search_frame_ticks", depth * LookaheadSearch::PLY_TICKS, "ticks");
+    bench.Record("lookahead_search_frame_forks", seconds > 0 ? nodes / seconds : 0.0, "forks/s");
+}
+
+// one tick of Update from a fixed state; the state is copied back each time
+template <class Update>
+static void RunUpdate(Bench& bench, const std::string& name, const PongSimulation& start, const PongInput& input, Update update)
+{
+    PongSimulation simulation = start;
+    bench.Run(name, [&]()
+    {
+        simulation = start;
+        update(simulation, input);
+        return Observe(simulation);
+    });
+}
+
+static void SimulationBenchmarks(Bench& bench)
+{
+    PongInput idle;
+    PongInput serve;
+    serve.serve = true;
+
+    const PongSimulation fresh(3);
+    const PongSimulation towardTwo = FindState([](const PongSimulation& before, const PongSimulation&)
+    {
+        return before.GetPlayState() == PLAY_STATE::TOWARD_PLAYER_TWO && before.GetBall().GetPosition().x > WINDOW_WIDTH / 2;
+    });
+    const PongSimulation paddleHit = FindState([](const PongSimulation& before, const PongSimulation& after)
+    {
+        return before.GetPlayState() == PLAY_STATE::TOWARD_PLAYER_TWO && after.GetPlayState() == PLAY_STATE::TOWARD_PLAYER_ONE;
+    });
+    const PongSimulation towardOne = FindState([](const PongSimulation& before, const PongSimulation&)
+    {
+        return before.GetPlayState() == PLAY_STATE::TOWARD_PLAYER_ONE && before.GetBall().GetPosition().x < WINDOW_WIDTH / 2;
+    });
+    const PongSimulation wallBounce = FindState([](const PongSimulation& before, const PongSimulation& after)
+    {
+        return before.GetPlayState() == after.GetPlayState() && BallDY(before) != 0 && (BallDY(before) > 0) != (BallDY(after) > 0);
+    });
+    // first serve with the paddles still: player one misses the return
+    PongSimulation goal(3);
+    for (;;)
+    {
+        PongSimulation next = goal;
+        next.Update(UPDATE_MS, serve);
+        if (next.GetPlayerTwoScore() != goal.GetPlayerTwoScore())
+            break;
+        goal = next;
+    }
+
+    const auto update = [](PongSimulation& simulation, const PongInput& input) { simulation.Update(UPDATE_MS, input); };
+    const auto updateExact = [](PongSimulation& simulation, const PongInput& input) { simulation.UpdateExact(UPDATE_MS, input); };
+    const auto updateFixed = [](PongSimulation& simulation, const PongInput& input) { simulation.UpdateFixed(UPDATE_MS, input); };
+
+    {
+        PongSimulation simulation = fresh;
+        bench.Run("state_copy", [&]()
+        {
+            simulation = towardTwo;
+            return Observe(simulation);
+        });
+    }
+
+    {
+        // alternate between two states so the work can't be hoisted
+        const PongSimulation simulations[] = { towardTwo,towardOne };
+        std::size_t next = 0;
+        bench.Run("state_fork", [&]()
+        {
+            next ^= 1;
+            const PongState state = simulations[next].Fork();
+            return state.ballX + state.playerOneY;
+        });
+
+        PongSimulation simulation = towardTwo;
+        const PongState states[] = { towardTwo.Fork(),towardOne.Fork() };
+        bench.Run("state_restore", [&]()
+        {
+            next ^= 1;
+            simulation.Restore(states[next]);
+            return Observe(simulation);
+        });
+    }
+
+    RunUpdate(bench, "update_serve_wait", fresh, idle, update);
+    RunUpdate(bench, "update_serve", fresh, serve, update);
+    RunUpdate(bench, "update_toward_player_two", towardTwo, serve, update);
+    RunUpdate(bench, "update_toward_player_one", towardOne, serve, update);
+    RunUpdate(bench, "update_paddle_hit", paddleHit, serve, update);
+    RunUpdate(bench, "update_wall_bounce", wallBounce, serve, update);
+    RunUpdate(bench, "update_goal", goal, serve, update);
+
+    RunUpdate(bench, "update_exact_toward_player_two", towardTwo, serve, updateExact);
+    RunUpdate(bench, "update_exact_paddle_hit", paddleHit, serve, updateExact);
+    RunUpdate(bench, "update_exact_wall_bounce", wallBounce, serve, updateExact);
+
+    RunUpdate(bench, "update_fixed_toward_player_two", towardTwo, serve, updateFixed);
+    RunUpdate(bench, "update_fixed_paddle_hit", paddleHit, serve, updateFixed);
+    RunUpdate(bench, "update_fixed_wall_bounce", wallBounce, serve, updateFixed);
+
+    // a whole match: player one chases the ball, player two never moves
+    std::uint64_t matchTicks = 0;
+    bench.Run("full_match", [&]()
+    {
+        PongSimulation simulation(3);
+        matchTicks = 1;
+        while (simulation.Update(UPDATE_MS, Chase(simulation, true, false)) == GAME_STATE::IN_GAME)
+            ++matchTicks;
+        return Observe(simulation);
+    });
+    if (matchTicks > 0)
+        std::cout << "  (" << matchTicks << " ticks per match)" << std::endl;
+
+    // a second of rally at the classic tick and at --tick-rate 1000, to show
+    // what the faster rate costs per second of play
+    const auto playSecond = [&](const char* name, const float tickMilliseconds)
+    {
+        const int ticks = static_cast<int>(1000 / tickMilliseconds);
+        bench.Run(name, [&]()
+        {
+            PongSimulation simulation = towardTwo;
+            for (int tick = 0; tick < ticks; ++tick)
+                simulation.Update(tickMilliseconds, Chase(simulation, true, true));
+            return Observe(simulation);
+        });
+    };
+    playSecond("play_second_30hz", UPDATE_MS);
+    playSecond("play_second_1000hz", MIN_UPDATE_MS);
+
+    // the CPU player's per-tick cost, with and without a fresh prediction
+    {
+        Ball ball = towardTwo.GetBall();
+        const float planeX = TrajectoryPredictor::PaddlePlane(towardTwo.GetPlayerTwo(), false);
+        float offset = 0;
+        bench.Run("predict_interception", [&]()
+        {
+            // vary the start so the prediction can't be hoisted
+            offset = offset > 100 ? 0 : offset + 1;
+            ball.SetPosition({ towardTwo.GetBall().GetPosition().x,towardTwo.GetBall().GetPosition().y + offset });
+            return TrajectoryPredictor::Predict(ball, towardTwo.GetCourt(), planeX).y;
+        });
+    }
+    {
+        CpuSettings settings;
+        settings.reactionTicks = 0;
+        CpuOpponent cpu(false, settings, 1);
+        PongInput input;
+        bench.Run("cpu_drive", [&]()
+        {
+            cpu.Drive(towardTwo, input);
+            return cpu.GetTarget();
+        });
+
+        // alternating rally legs make every call re-aim
+        bool flip = false;
+        bench.Run("cpu_drive_reaim", [&]()
+        {
+            flip = !flip;
+            cpu.Drive(flip ? towardOne : towardTwo, input);
+            return cpu.GetTarget();
+        });
+    }
+
+    {
+        LookaheadSearch search;
+        const PongState root = towardTwo.Fork();
+        bench.Run("lookahead_search_depth_6", [&]()
+        {
+            return search.Search(root, 6);
+        });
+    }
+    if (bench.Wants("lookahead_search_frame"))
+        LookaheadBenchmark(bench, towardTwo);
+}
+
+#ifdef PONG_BENCH_SFML
+static void DrawingBenchmarks(Bench& bench, const std::string& fontPath)
+{
+    sf::Font font;
+    sf::RenderTexture target;
+    BakedAtlas scoreFont;
+    BakedAtlas buttonFont;
+    if (!font.loadFromFile(fontPath) || !target.create(WINDOW_WIDTH, WINDOW_HEIGHT) ||
+        !scoreFont.Bake(font, GameRenderer::SCORE_CHARACTER_SIZE) || !buttonFont.Bake(font, PongMenu::BUTTON_CHARACTER_SIZE))
+    {
+        std::cerr << "skipping drawing benchmarks: need the font " << fontPath << " and render texture support" << std::endl;
+        return;
+    }
+
+    const PongSimulation simulation(3);
+    {
+        GameRenderer renderer(target, scoreFont, simulation.GetCourt());
+        Paddle playerOne = simulation.GetPlayerOne();
+        float offset = 0;
+        bench.Run("game_renderer_render", [&]()
+        {
+            // move a paddle so the vertex rewrite isn't a no-op
+            offset = offset > 100 ? 0 : offset + 1;
+            playerOne.SetPosition({ playerOne.GetPositionSize().x,WINDOW_HEIGHT / 2 + offset });
+            target.clear();
+            renderer.Render(UPDATE_MS, playerOne, simulation.GetPlayerTwo(), simulation.GetBall(), 1, 2);
+            target.display();
+            return offset;
+        });
+    }
+
+    {
+        Button button("PLAY", { WINDOW_WIDTH / 2,WINDOW_HEIGHT / 2,140,65 });
+        bench.Run("button_render", [&]()
+        {
+            target.clear();
+            button.Render(target, buttonFont);
+            target.display();
+            return 0.0f;
+        });
+    }
+
+    {
+        // sweep the pointer across both buttons and the empty space around them
+        PongMenu menu(target, buttonFont);
+        std::vector<Vector2D> positions;
+        for (int y = 0; y < 8; ++y)
+            for (int x = 0; x < 8; ++x)
+                positions.push_back({ WINDOW_WIDTH / 2 - 100 + x * 40.0f,WINDOW_HEIGHT / 2 - 50 + y * 30.0f });
+        std::size_t next = 0;
+        bench.Run("menu_update_hit_test", [&]()
+        {
+            next = (next + 1) % positions.size();
+            return static_cast<float>(menu.Update(UPDATE_MS, positions[next], MOUSE_STATE::UP));
+        });
+
+        bench.Run("menu_render_cached", [&]()
+        {
+            target.clear();
+            menu.Render(UPDATE_MS);
+            target.display();
+            return 0.0f;
+        });
+    }
+
+    {
+        // the game's per-tick entry point with an empty input queue
+        PongGame game(3);
+        InputQueue inputs;
+        bench.Run("pong_game_update_serve_wait", [&]()
+        {
+            return static_cast<float>(game.Update(UPDATE_MS, inputs, InputQueue::Clock::now()));
+        });
+    }
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    double minSeconds = 0.5;
+    std::string filter;
+    std::string jsonPath;
+    std::string fontPath = "SourceSansPro-Regular.otf";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--min-time") == 0 && hasValue)
+            minSeconds = std::strtod(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--filter") == 0 && hasValue)
+            filter = argv[++i];
+        else if (std::strcmp(argv[i], "--json") == 0 && hasValue)
+            jsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "--font") == 0 && hasValue)
+            fontPath = argv[++i];
+        else
+        {
+            std::cerr << "usage: pong_bench [--min-time SECONDS] [--filter NAME] [--json FILE] [--font FILE]" << std::endl;
+            return 1;
+        }
+    }
+
+    Bench bench(minSeconds, filter);
+    SimulationBenchmarks(bench);
+#ifdef PONG_BENCH_SFML
+    DrawingBenchmarks(bench, fontPath);
+#else
+    std::cout << "built without SFML; drawing and menu benchmarks skipped" << std::endl;
+#endif
+
+    if (!jsonPath.empty() && !bench.WriteJson(jsonPath))
+    {
+        std::cerr << "could not write " << jsonPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "pong_batch.h"
+#include "shared_env.h"
+
+// Plays the trainer against a pong_env_server it forks for itself: random
+// actions for every match, one request per step, timing each round trip.
+// The server's own stepping time is taken off to leave the cost of driving
+// it from another process. At the end the observations are checked against
+// a PongBatch stepped locally with the same actions.
+
+// per-match random paddles, always serving
+static std::uint8_t NextAction(std::uint32_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    static const std::uint8_t moves[] = { 0,PongInput::PLAYER_ONE_UP,PongInput::PLAYER_ONE_DOWN,0 };
+    return PongInput::SERVE | moves[state & 3] | static_cast<std::uint8_t>(moves[(state >> 2) & 3] << 2);
+}
+
+static void FillActions(std::vector<std::uint32_t>& states, std::uint8_t* actions)
+{
+    for (std::size_t i = 0; i < states.size(); ++i)
+        actions[i] = NextAction(states[i]);
+}
+
+static std::vector<std::uint32_t> MakeStates(const std::size_t envs)
+{
+    std::vector<std::uint32_t> states(envs);
+    for (std::size_t i = 0; i < envs; ++i)
+        states[i] = static_cast<std::uint32_t>(i * 2654435761u + 1);
+    return states;
+}
+
+int main(int argc, char** argv)
+{
+    std::string name = "/pong_env_bench";
+    std::uint32_t envs = 1024;
+    std::uint64_t steps = 20000;
+    std::uint32_t ticks = 1;
+    unsigned spins = SharedEnvSync::DefaultSpins();
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--name") == 0 && hasValue)
+            name = argv[++i];
+        else if (std::strcmp(argv[i], "--envs") == 0 && hasValue)
+            envs = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--steps") == 0 && hasValue)
+            steps = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--ticks") == 0 && hasValue)
+            ticks = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--spins") == 0 && hasValue)
+            spins = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else
+        {
+            std::cerr << "usage: pong_env_bench [--name /NAME] [--envs N] [--steps N] [--ticks N] [--spins N]" << std::endl;
+            return 1;
+        }
+    }
+    if (envs == 0 || steps == 0 || ticks == 0)
+    {
+        std::cerr << "need at least one match, step and tick" << std::endl;
+        return 1;
+    }
+
+    // created before the fork so the trainer never sees a half-built object
+    SharedEnvServer server;
+    if (!server.Create(name, envs, 3))
+    {
+        std::cerr << "could not create shared memory " << name << std::endl;
+        return 1;
+    }
+    const pid_t child = fork();
+    if (child < 0)
+    {
+        std::cerr << "could not fork the server" << std::endl;
+        return 1;
+    }
+    if (child == 0)
+    {
+        server.Disown();
+        const std::atomic<bool> never(false);
+        server.Run(spins, never);
+        _exit(0);
+    }
+
+    SharedEnvClient trainer;
+    if (!trainer.Open(name))
+    {
+        std::cerr << "could not open shared memory " << name << std::endl;
+        kill(child, SIGKILL);
+        return 1;
+    }
+    trainer.SetSpins(spins);
+
+    std::vector<std::uint32_t> states = MakeStates(envs);
+    std::vector<double> roundTrips(steps);
+    std::uint64_t finished = 0;
+    const std::uint64_t serverStart = trainer.GetServerNanoseconds();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::uint64_t step = 0; step < steps; ++step)
+    {
+        FillActions(states, trainer.GetActions());
+        const std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+        trainer.Step(ticks);
+        roundTrips[step] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count();
+
+        const std::uint8_t* done = trainer.GetDone();
+        for (std::uint32_t i = 0; i < envs; ++i)
+            finished += done[i];
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double serverMicroseconds = (trainer.GetServerNanoseconds() - serverStart) / 1000.0;
+
+    // the same actions through a local batch, resetting as the server does
+    PongBatch local(envs, 3);
+    states = MakeStates(envs);
+    for (std::uint64_t step = 0; step < steps; ++step)
+    {
+        local.ResetFinished();
+        FillActions(states, local.GetInputs());
+        for (std::uint32_t tick = 0; tick < ticks; ++tick)
+            local.Step(UPDATE_MS);
+    }
+    const bool agree =
+        std::memcmp(local.GetBallX(), trainer.GetObservation(ENV_FIELD::BALL_X), envs * sizeof(float)) == 0 &&
+        std::memcmp(local.GetBallY(), trainer.GetObservation(ENV_FIELD::BALL_Y), envs * sizeof(float)) == 0 &&
+        std::memcmp(local.GetPlayerOneY(), trainer.GetObservation(ENV_FIELD::PLAYER_ONE_Y), envs * sizeof(float)) == 0 &&
+        std::memcmp(local.GetPlayerTwoScore(), trainer.GetObservation(ENV_FIELD::PLAYER_TWO_SCORE), envs * sizeof(float)) == 0;
+
+    trainer.Stop();
+    int status = 0;
+    waitpid(child, &status, 0);
+
+    double mean = 0;
+    for (const double roundTrip : roundTrips)
+        mean += roundTrip / steps;
+    const double serverPerStep = serverMicroseconds / steps;
+    std::sort(roundTrips.begin(), roundTrips.end());
+
+    std::cout << envs << " matches x " << steps << " steps of " << ticks << " ticks, spins " << spins << "\n"
+        << "round trip us: mean " << mean
+        << " p50 " << roundTrips[steps / 2]
+        << " p99 " << roundTrips[steps * 99 / 100]
+        << "  server stepping us: " << serverPerStep << "\n"
+        << "overhead per request us: " << mean - serverPerStep
+        << "  per match step ns: " << (mean - serverPerStep) * 1000 / envs << "\n"
+        << "match steps/s: " << static_cast<double>(envs) * steps / elapsed.count()
+        << "  matches finished: " << finished << "\n"
+        << (agree ? "observations match a local batch" : "observations DIFFER from a local batch") << std::endl;
+    return agree ? 0 : 1;
+}
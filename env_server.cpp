@@ -0,0 +1,65 @@
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "shared_env.h"
+
+// Hosts --envs matches in a shared-memory object for an outside trainer to
+// step; see shared_env.h for the layout. Runs until the trainer sends STOP
+// or the process is interrupted, then removes the object.
+
+static std::atomic<bool> g_stop(false);
+
+static void HandleSignal(int)
+{
+    g_stop.store(true);
+}
+
+int main(int argc, char** argv)
+{
+    std::string name = SHARED_ENV_DEFAULT_NAME;
+    std::uint32_t envs = 1024;
+    int scoreToWin = 3;
+    unsigned spins = SharedEnvSync::DefaultSpins();
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--name") == 0 && hasValue)
+            name = argv[++i];
+        else if (std::strcmp(argv[i], "--envs") == 0 && hasValue)
+            envs = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--score") == 0 && hasValue)
+            scoreToWin = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--spins") == 0 && hasValue)
+            spins = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else
+        {
+            std::cerr << "usage: pong_env_server [--name /NAME] [--envs N] [--score N] [--spins N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (scoreToWin < 1 || scoreToWin > 255)
+    {
+        std::cerr << "score to win must be between 1 and 255" << std::endl;
+        return 1;
+    }
+
+    SharedEnvServer server;
+    if (!server.Create(name, envs, static_cast<std::uint_fast8_t>(scoreToWin)))
+    {
+        std::cerr << "could not create shared memory " << name << " for " << envs << " matches" << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, HandleSignal);
+    std::signal(SIGTERM, HandleSignal);
+    std::cout << "serving " << envs << " matches at " << name << std::endl;
+    server.Run(spins, g_stop);
+    return 0;
+}
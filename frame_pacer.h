@@ -0,0 +1,210 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+#include "pong_core.h"
+
+struct FrameStats
+{
+    std::uint64_t frames = 0;
+    double meanMilliseconds = 0;
+    double stdDevMilliseconds = 0;
+    double minMilliseconds = 0;
+    double maxMilliseconds = 0;
+    std::uint64_t lateFrames = 0;
+    std::uint64_t droppedSteps = 0;
+};
+
+// Drives the main loop from the monotonic clock: tells the caller how many
+// fixed simulation steps are due each frame, caps how much time can pile up
+// after a stall, waits out the rest of the frame for a target render rate and
+// keeps frame time statistics.
+class FramePacer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef std::chrono::nanoseconds Nanoseconds;
+
+    FramePacer(const float updateMilliseconds, const float targetFps)
+        :
+        m_updateStep(ToNanoseconds(updateMilliseconds)),
+        m_frameTime(0),
+        m_lag(0),
+        m_maxCatchUp(ToNanoseconds(5 * UPDATE_MS)),
+        m_spinThreshold(std::chrono::milliseconds(2)),
+        m_lastFrame(Clock::now()),
+        m_nextDeadline(m_lastFrame),
+        m_frameSum(0),
+        m_frameSquareSum(0)
+    {
+        SetTargetFps(targetFps);
+    }
+
+    // 0 leaves the frame rate uncapped
+    void SetTargetFps(const float targetFps)
+    {
+        m_framePeriod = targetFps > 0 ? Nanoseconds(static_cast<std::int64_t>(1e9 / targetFps)) : Nanoseconds(0);
+        m_nextDeadline = Clock::now() + m_framePeriod;
+    }
+
+    // The cap is time rather than steps so it means the same at any tick
+    // rate; at least one step is always allowed.
+    void SetMaxCatchUpMilliseconds(const float milliseconds)
+    {
+        m_maxCatchUp = ToNanoseconds(milliseconds);
+    }
+
+    // changes the step from the next BeginFrame on; lag carries over
+    void SetUpdateMilliseconds(const float milliseconds)
+    {
+        m_updateStep = ToNanoseconds(milliseconds);
+    }
+
+    float GetUpdateMilliseconds() const
+    {
+        return m_updateStep.count() / 1e6f;
+    }
+
+    // how long before a deadline to stop sleeping and spin instead; covers
+    // the scheduler's wake-up slack, which is coarse on some platforms
+    void SetSpinThreshold(const Nanoseconds threshold)
+    {
+        m_spinThreshold = threshold;
+    }
+
+    // Starts a frame and returns how many fixed steps to simulate. Lag beyond
+    // the catch-up cap is dropped rather than simulated.
+    std::uint32_t BeginFrame()
+    {
+        const Clock::time_point now = Clock::now();
+        m_frameTime = now - m_lastFrame;
+        m_lastFrame = now;
+        m_lag += m_frameTime;
+        Record(m_frameTime);
+
+        std::uint32_t steps = static_cast<std::uint32_t>(m_lag / m_updateStep);
+        const std::uint32_t maxSteps = std::max<std::uint32_t>(1, static_cast<std::uint32_t>(m_maxCatchUp / m_updateStep));
+        if (steps > maxSteps)
+        {
+            m_stats.droppedSteps += steps - maxSteps;
+            steps = maxSteps;
+            m_lag = m_updateStep * maxSteps + m_lag % m_updateStep;
+        }
+        m_lag -= m_updateStep * steps;
+
+        return steps;
+    }
+
+    // Blocks until the next frame is due: sleeps while far from the deadline,
+    // then spins for the last stretch so wake-up slack doesn't add jitter.
+    // poll() is called at least every millisecond while waiting, which lets
+    // input events be picked up and timestamped close to when they arrive.
+    template <class Poll>
+    void WaitForNextFrame(Poll poll)
+    {
+        if (m_framePeriod.count() == 0)
+            return;
+
+        Clock::time_point now = Clock::now();
+        if (now > m_nextDeadline + m_framePeriod)
+        {
+            // fell more than a frame behind; start a fresh schedule
+            ++m_stats.lateFrames;
+            m_nextDeadline = now;
+        }
+        else if (now > m_nextDeadline)
+            ++m_stats.lateFrames;
+
+        const Nanoseconds pollInterval = std::chrono::milliseconds(1);
+        while (m_nextDeadline - now > m_spinThreshold)
+        {
+            const Nanoseconds sleep = m_nextDeadline - now - m_spinThreshold;
+            std::this_thread::sleep_for(sleep < pollInterval ? sleep : pollInterval);
+            poll();
+            now = Clock::now();
+        }
+        while (Clock::now() < m_nextDeadline)
+        {
+            poll();
+            std::this_thread::yield();
+        }
+
+        m_nextDeadline += m_framePeriod;
+    }
+
+    void WaitForNextFrame()
+    {
+        WaitForNextFrame([]() {});
+    }
+
+    // forget time spent outside the loop (e.g. blocked on events) and make one step due
+    void Resync()
+    {
+        m_lastFrame = Clock::now();
+        m_nextDeadline = m_lastFrame + m_framePeriod;
+        m_lag = m_updateStep;
+    }
+
+    // wall-clock time at which step (0-based, of the steps BeginFrame returned) ends
+    Clock::time_point GetStepEnd(const std::uint32_t step, const std::uint32_t steps) const
+    {
+        return m_lastFrame - m_lag - m_updateStep * (steps - 1 - step);
+    }
+
+    float GetFrameMilliseconds() const
+    {
+        return m_frameTime.count() / 1e6f;
+    }
+
+    float GetLagMilliseconds() const
+    {
+        return m_lag.count() / 1e6f;
+    }
+
+    FrameStats GetStats() const
+    {
+        FrameStats stats = m_stats;
+        if (stats.frames > 0)
+        {
+            const double mean = m_frameSum / stats.frames;
+            stats.meanMilliseconds = mean;
+            stats.stdDevMilliseconds = std::sqrt(std::fmax(m_frameSquareSum / stats.frames - mean * mean, 0.0));
+        }
+        return stats;
+    }
+
+private:
+    static Nanoseconds ToNanoseconds(const float milliseconds)
+    {
+        return Nanoseconds(static_cast<std::int64_t>(milliseconds * 1e6));
+    }
+
+    void Record(const Nanoseconds frameTime)
+    {
+        const double milliseconds = frameTime.count() / 1e6;
+        if (m_stats.frames == 0 || milliseconds < m_stats.minMilliseconds)
+            m_stats.minMilliseconds = milliseconds;
+        if (m_stats.frames == 0 || milliseconds > m_stats.maxMilliseconds)
+            m_stats.maxMilliseconds = milliseconds;
+        m_frameSum += milliseconds;
+        m_frameSquareSum += milliseconds * milliseconds;
+        ++m_stats.frames;
+    }
+
+    Nanoseconds m_updateStep;
+    Nanoseconds m_framePeriod;
+    Nanoseconds m_frameTime;
+    Nanoseconds m_lag;
+    Nanoseconds m_maxCatchUp;
+    Nanoseconds m_spinThreshold;
+    Clock::time_point m_lastFrame;
+    Clock::time_point m_nextDeadline;
+
+    FrameStats m_stats;
+    double m_frameSum;
+    double m_frameSquareSum;
+};
@@ -1,674 +1,612 @@
-#include <SFML/Audio.hpp>
 #include <SFML/Graphics.hpp>
 
-#include <cstdint>
+#include <algorithm>
 #include <chrono>
-#include <functional>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
-
-const std::uint16_t WINDOW_WIDTH = 1600;
-const std::uint16_t WINDOW_HEIGHT = 900;
-
-const float UPDATE_MS = 33;
-
-const float BALL_RADIUS = 10;
-const float BALL_VELOCITY = 400;
-const float BALL_VEL_INCR = 60;
-
-const float PADDLE_WIDTH = 10;
-const float PADDLE_LENGTH = 50;
-const float PADDLE_PADDING = 20;
-const float PADDLE_SPEED = 400;
-
-const float COURT_MARGIN = 10;
-const float COURT_OUTLINE_WIDTH = 5;
-
-enum class GAME_STATE : std::uint_fast8_t
-{
-    MENU,
-    IN_GAME,
-    EXIT
-};
-
-enum class PLAY_STATE : std::uint_fast8_t
-{
-    SERVE_PLAYER_ONE,
-    SERVE_PLAYER_TWO,
-    TOWARD_PLAYER_ONE,
-    TOWARD_PLAYER_TWO
-};
-
-enum class MOUSE_STATE : std::uint_fast8_t
-{
-    UP,
-    DOWN
-};
-
-struct Vector2D
+#include <memory>
+#include <string>
+
+#include "alloc_tracker.h"
+#include "asset_pack.h"
+#include "audio.h"
+#include "baked_font.h"
+#include "frame_pacer.h"
+#include "game.h"
+#include "input_queue.h"
+#include "multiball_game.h"
+#include "netplay.h"
+#include "pong_ai.h"
+#include "pong_core.h"
+#include "profiler.h"
+#include "profiler_overlay.h"
+#include "replay.h"
+#include "sim_thread.h"
+#include "spectator.h"
+#include "tick_rate.h"
+
+// ticks to keep sending after an online match ends
+const std::uint32_t NETPLAY_LINGER_TICKS = 30;
+
+int main(int argc, char** argv)
 {
-    float x;
-    float y;
-};
+    const std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
 
-struct RectangleShape
-{
-    float x;
-    float y;
-    float width;
-    float height;
-};
+    sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Pong");
 
-class Court
-{
-public:
-    Court(const RectangleShape dimensions)
-        :
-        m_dimensions(dimensions)
-    {
+    GAME_STATE gameState = GAME_STATE::MENU;
 
+    PHYSICS physics = PHYSICS::TICK;
+    bool cpu = false;
+    CpuSettings cpuSettings;
+    std::string packPath = "pong.pack";
+    bool quitAfterFirstFrame = false;
+    float targetFps = 60;
+    float tickMilliseconds = UPDATE_MS;
+    bool adaptiveTickRate = true;
+    std::string recordPath;
+    std::string replayPath;
+    unsigned short netPort = 0;
+    std::string netPeer;
+    std::uint8_t netPlayer = 0;
+    float netLatency = 0;
+    float netJitter = 0;
+    float netLoss = 0;
+    unsigned short spectatePort = 0;
+    std::string watchHost;
+    bool profile = false;
+    std::string tracePath = "pong_trace.json";
+    std::size_t multiBalls = 0;
+    bool singleThread = false;
+    bool mute = false;
+    std::uint64_t checkAllocationFrames = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::string(argv[i]) == "--exact-physics")
+            physics = PHYSICS::EXACT;
+        else if (std::string(argv[i]) == "--fixed-point")
+            physics = PHYSICS::FIXED_POINT;
+        else if (std::string(argv[i]) == "--pack" && i + 1 < argc)
+            packPath = argv[++i];
+        else if (std::string(argv[i]) == "--quit-after-first-frame")
+            quitAfterFirstFrame = true;
+        else if (std::string(argv[i]) == "--fps" && i + 1 < argc)
+            targetFps = std::strtof(argv[++i], nullptr);
+        else if (std::string(argv[i]) == "--tick-rate" && i + 1 < argc)
+            tickMilliseconds = 1000 / std::strtof(argv[++i], nullptr);
+        else if (std::string(argv[i]) == "--fixed-tick-rate")
+            adaptiveTickRate = false;
+        else if (std::string(argv[i]) == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (std::string(argv[i]) == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (std::string(argv[i]) == "--net-port" && i + 1 < argc)
+            netPort = static_cast<unsigned short>(std::atoi(argv[++i]));
+        else if (std::string(argv[i]) == "--net-peer" && i + 1 < argc)
+            netPeer = argv[++i];
+        else if (std::string(argv[i]) == "--net-player" && i + 1 < argc)
+            netPlayer = std::atoi(argv[++i]) == 2 ? 1 : 0;
+        else if (std::string(argv[i]) == "--net-latency" && i + 1 < argc)
+            netLatency = std::strtof(argv[++i], nullptr);
+        else if (std::string(argv[i]) == "--net-jitter" && i + 1 < argc)
+            netJitter = std::strtof(argv[++i], nullptr);
+        else if (std::string(argv[i]) == "--net-loss" && i + 1 < argc)
+            netLoss = std::strtof(argv[++i], nullptr);
+        else if (std::string(argv[i]) == "--spectate-port" && i + 1 < argc)
+            spectatePort = static_cast<unsigned short>(std::atoi(argv[++i]));
+        else if (std::string(argv[i]) == "--watch" && i + 1 < argc)
+            watchHost = argv[++i];
+        else if (std::string(argv[i]) == "--cpu")
+        {
+            // optional difficulty: --cpu [easy|normal|hard]
+            const std::string level = i + 1 < argc ? argv[i + 1] : "";
+            if (level == "easy" || level == "normal" || level == "hard")
+            {
+                cpuSettings = level == "easy" ? CpuSettings::Easy() : level == "hard" ? CpuSettings::Hard() : CpuSettings::Normal();
+                ++i;
+            }
+            cpu = true;
+        }
+        else if (std::string(argv[i]) == "--multiball" && i + 1 < argc)
+            multiBalls = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::string(argv[i]) == "--mute")
+            mute = true;
+        else if (std::string(argv[i]) == "--single-thread")
+            singleThread = true;
+        else if (std::string(argv[i]) == "--check-allocations" && i + 1 < argc)
+            checkAllocationFrames = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::string(argv[i]) == "--profile")
+            profile = true;
+        else if (std::string(argv[i]) == "--trace" && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+            profile = true;
+        }
     }
 
-    const RectangleShape& GetDimensions() const
+    // --tick-rate HZ runs local matches at up to 1000 ticks a second; unless
+    // --fixed-tick-rate, the rate drops while ticks cost too much to keep up
+    if (!std::isfinite(tickMilliseconds) || tickMilliseconds <= 0)
     {
-        return m_dimensions;
+        std::cerr << "--tick-rate needs a rate in Hz" << std::endl;
+        return 1;
     }
+    tickMilliseconds = std::max(tickMilliseconds, MIN_UPDATE_MS);
 
-private:
-    RectangleShape m_dimensions;
-};
-
-class Paddle
-{
-public:
-    Paddle(const RectangleShape startingPosition)
-        :
-        m_rect(startingPosition)
+    // --check-allocations N runs N frames, e.g. of a --replay, and fails if
+    // any steady frame allocated; it needs a build with PONG_TRACK_ALLOCATIONS
+    if (checkAllocationFrames > 0 && !AllocationTracker::IsEnabled())
     {
+        std::cerr << "--check-allocations needs a build configured with -DPONG_TRACK_ALLOCATIONS=ON" << std::endl;
+        return 1;
     }
 
-    const RectangleShape& GetPositionSize() const
-    {
-        return m_rect;
+    // Assets come from the pack pong_pack builds when it is there: the font
+    // and glyph atlases are used straight from the mapped file. Without it
+    // the font file is loaded and the atlases are rasterised here instead.
+    const std::chrono::steady_clock::time_point assetsStart = std::chrono::steady_clock::now();
+    AssetPack pack;
+    sf::Font font;
+    BakedAtlas scoreFont;
+    BakedAtlas buttonFont;
+    std::size_t packedFontSize = 0;
+    const void* packedFont = pack.Open(packPath) ? pack.Find("font", packedFontSize) : nullptr;
+    const bool fromPack = packedFont != nullptr && font.loadFromMemory(packedFont, packedFontSize) &&
+        scoreFont.Load(pack, GameRenderer::SCORE_CHARACTER_SIZE) && buttonFont.Load(pack, PongMenu::BUTTON_CHARACTER_SIZE);
+    if (!fromPack)
+    {
+        if (!font.loadFromFile("SourceSansPro-Regular.otf"))
+        {
+            std::cerr << "could not load " << packPath << " or font " << std::endl;
+            return 0;
+        }
+        scoreFont.Bake(font, GameRenderer::SCORE_CHARACTER_SIZE);
+        buttonFont.Bake(font, PongMenu::BUTTON_CHARACTER_SIZE);
     }
 
-    void SetPositionSize(const RectangleShape newPositionSize)
-    {
-        m_rect = newPositionSize;
-    }
+    // the match queues its sounds and this thread plays them between frames
+    AudioEngine audio(pack.IsOpen() ? &pack : nullptr);
+    audio.SetMuted(mute);
+    const std::chrono::steady_clock::time_point assetsEnd = std::chrono::steady_clock::now();
 
-    void SetPosition(const Vector2D newPosition)
-    {
-        m_rect.x = newPosition.x;
-        m_rect.y = newPosition.y;
-    }
+    PongGame pong(3);
+    PongMenu menu(window, buttonFont);
+    pong.SetPhysics(physics);
+    pong.SetTickMilliseconds(tickMilliseconds);
+    if (cpu)
+        pong.SetCpuOpponent(cpuSettings);
+    pong.SetSoundQueue(&audio.GetQueue());
 
-private:
-    RectangleShape m_rect;
-};
+    // F3 shows the profiler overlay and F4 writes the zones so far to the
+    // trace file; --profile keeps zones recording even with the overlay hidden
+    Profiler::SetEnabled(profile);
+    Profiler::Get().SetThreadName("main");
+    ProfilerOverlay overlay(window, font, "frame");
 
-class Ball
-{
-public:
-    Ball(const Vector2D startPosition, const float radius)
-        :
-        m_position(startPosition),
-        m_radius(radius),
-        m_velocity({ 0,0 })
-    {
-    }
+    if (!recordPath.empty())
+        pong.SetRecordPath(recordPath);
 
-    const Vector2D& GetPosition() const
+    // a replay starts straight into the match and returns to the menu at its end
+    ReplayReader replay;
+    if (!replayPath.empty())
     {
-        return m_position;
-    }
+        if (!replay.Load(replayPath))
+        {
+            std::cerr << "could not load replay " << replayPath << std::endl;
+            return 0;
+        }
+        pong.StartReplay(replay);
+        gameState = GAME_STATE::IN_GAME;
+
+        // played back one recorded tick per tick, so at the recorded rate
+        tickMilliseconds = replay.GetHeader().tickMilliseconds;
+        adaptiveTickRate = false;
+        pong.SetTickMilliseconds(tickMilliseconds);
+    }
+
+    // Online play against --net-peer HOST:PORT goes straight into a match and
+    // quits when it ends. On one machine, run two copies with swapped ports,
+    // e.g. --net-port 7001 --net-peer 127.0.0.1:7002 --net-player 1 and
+    // --net-port 7002 --net-peer 127.0.0.1:7001 --net-player 2.
+    std::unique_ptr<RollbackSession> session;
+    std::unique_ptr<UdpPeer> peer;
+    std::uint32_t lingerTicks = 0;
+    if (!netPeer.empty())
+    {
+        const std::size_t colon = netPeer.rfind(':');
+        if (colon == std::string::npos)
+        {
+            std::cerr << "--net-peer needs HOST:PORT" << std::endl;
+            return 0;
+        }
+        const sf::IpAddress remoteAddress(netPeer.substr(0, colon));
+        const unsigned short remotePort = static_cast<unsigned short>(std::atoi(netPeer.c_str() + colon + 1));
 
-    const float& GetRadius() const
-    {
-        return m_radius;
+        peer.reset(new UdpPeer(remoteAddress, remotePort, LinkConditioner(netLatency, netJitter, netLoss, netPort)));
+        if (!peer->Bind(netPort))
+        {
+            std::cerr << "could not bind UDP port " << netPort << std::endl;
+            return 0;
+        }
+        session.reset(new RollbackSession(3, netPlayer, pong.GetPhysics()));
+        gameState = GAME_STATE::IN_GAME;
     }
 
-    const Vector2D& GetVelocity() const
+    // --multiball N starts a local match with N balls in play at once; it
+    // runs until the window is closed
+    std::unique_ptr<MultiBallGame> party;
+    if (multiBalls > 0 && MultiBallGame::FitRadius(multiBalls) < MultiBallSimulation::MIN_RADIUS)
     {
-        return m_velocity;
+        std::cerr << "--multiball " << multiBalls << " is too many balls to fit the court" << std::endl;
+        return 1;
     }
-
-    void SetPosition(const Vector2D newPosition)
+    if (multiBalls > 0 && session == nullptr && replayPath.empty())
     {
-        m_position = newPosition;
+        party.reset(new MultiBallGame(multiBalls, window, scoreFont));
+        gameState = GAME_STATE::IN_GAME;
     }
 
-    void SetVelocity(const Vector2D newVelocity)
+    // --spectate-port PORT streams the matches played here to anyone running
+    // --watch HOST:PORT; a watcher only draws what the stream shows it
+    std::unique_ptr<sf::UdpSocket> spectateSocket;
+    std::unique_ptr<SpectatorBroadcast> broadcast;
+    std::unique_ptr<SpectatorView> view;
+    sf::IpAddress watchAddress;
+    unsigned short watchPort = 0;
+    if (spectatePort != 0 || !watchHost.empty())
     {
-        m_velocity = newVelocity;
+        spectateSocket.reset(new sf::UdpSocket());
+        if (spectateSocket->bind(watchHost.empty() ? spectatePort : static_cast<unsigned short>(sf::Socket::AnyPort)) != sf::Socket::Done)
+        {
+            std::cerr << "could not bind a UDP port for spectators" << std::endl;
+            return 0;
+        }
+        spectateSocket->setBlocking(false);
     }
-
-private:
-    Vector2D m_position;
-    float m_radius;
-    Vector2D m_velocity;
-};
-
-class GameRenderer
-{
-public:
-
-    static bool Init(sf::RenderTarget* target, sf::Font* font)
+    if (!watchHost.empty())
     {
-        m_target = target;
-        m_font = font;
+        const std::size_t colon = watchHost.rfind(':');
+        if (colon == std::string::npos)
+        {
+            std::cerr << "--watch needs HOST:PORT" << std::endl;
+            return 0;
+        }
+        watchAddress = sf::IpAddress(watchHost.substr(0, colon));
+        watchPort = static_cast<unsigned short>(std::atoi(watchHost.c_str() + colon + 1));
+        view.reset(new SpectatorView());
+        gameState = GAME_STATE::IN_GAME;
     }
-
-    static void Render(const float& elapsedMilliseconds,
-        const Paddle& playerOne,
-        const Paddle& playerTwo,
-        const Ball& ball,
-        const Court& court,
-        const std::uint_fast8_t& p1Score,
-        const std::uint_fast8_t& p2Score)
+    else if (spectatePort != 0)
+        broadcast.reset(new SpectatorBroadcast());
+    PongSimulation watched = pong.GetSimulation();
+    auto spectatorMilliseconds = [&]()
     {
-        sf::RectangleShape courtShape;
-        const RectangleShape& cShape = court.GetDimensions();
-        courtShape.setPosition({ cShape.x,cShape.y });
-        courtShape.setSize({ cShape.width,cShape.height });
-        courtShape.setFillColor(sf::Color::Transparent);
-        courtShape.setOutlineColor(sf::Color::White);
-        courtShape.setOutlineThickness(-COURT_OUTLINE_WIDTH);
-
-        m_target->draw(courtShape);
-
-        courtShape.setPosition({ WINDOW_WIDTH / 2 - COURT_OUTLINE_WIDTH / 2,COURT_MARGIN });
-        courtShape.setSize({ COURT_OUTLINE_WIDTH,WINDOW_HEIGHT - COURT_MARGIN * 2 });
-        m_target->draw(courtShape);
-
-        sf::RectangleShape paddleShape;
-
-        const RectangleShape& p1Shape = playerOne.GetPositionSize();
-        paddleShape.setPosition({ p1Shape.x,p1Shape.y });
-        paddleShape.setSize({ p1Shape.width,p1Shape.height });
-        paddleShape.setFillColor(sf::Color::White);
-        m_target->draw(paddleShape);
-
-        const RectangleShape& p2Shape = playerTwo.GetPositionSize();
-        paddleShape.setPosition({ p2Shape.x,p2Shape.y });
-        paddleShape.setSize({ p2Shape.width,p2Shape.height });
-        paddleShape.setFillColor(sf::Color::White);
-        m_target->draw(paddleShape);
-
-        sf::CircleShape ballShape;
-        const Vector2D& ballPosition = ball.GetPosition();
-        const float& ballRadius = ball.GetRadius();
-        ballShape.setPosition({ ballPosition.x - BALL_RADIUS,ballPosition.y - BALL_RADIUS });
-        ballShape.setRadius(ballRadius);
-        ballShape.setFillColor(sf::Color::White);
-        m_target->draw(ballShape);
-
-        sf::Text score(std::to_string(p1Score) + "   " + std::to_string(p2Score), *m_font, 40);
-        sf::FloatRect bounds = score.getLocalBounds();
-        score.setPosition({ WINDOW_WIDTH / 2 - bounds.width / 2,COURT_MARGIN + COURT_OUTLINE_WIDTH + 5 });
-        m_target->draw(score);
-    }
-
-private:
-    static sf::RenderTarget* m_target;
-    static sf::Font* m_font;
-};
+        return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - launchTime).count());
+    };
 
-sf::RenderTarget* GameRenderer::m_target = nullptr;
-sf::Font* GameRenderer::m_font = nullptr;
+    window.setKeyRepeatEnabled(false);
 
-class PongGame
-{
-public:
-    PongGame(const std::uint_fast8_t scoreToWin, sf::RenderTarget& target, sf::Font& font)
-        :
-        m_playerOneScore(0),
-        m_playerTwoScore(0),
-        m_maxScore(scoreToWin),
-        m_court({
-            COURT_MARGIN,
-            COURT_MARGIN,
-            WINDOW_WIDTH - COURT_MARGIN * 2,
-            WINDOW_HEIGHT - COURT_MARGIN * 2
-            }),
-        m_ball({
-                WINDOW_WIDTH / 2,
-                WINDOW_HEIGHT / 2
-            },
-            BALL_RADIUS
-        ),
-        m_playerOne({
-            COURT_MARGIN + PADDLE_PADDING,
-            WINDOW_HEIGHT / 2 - (PADDLE_LENGTH / 2),
-            PADDLE_WIDTH,
-            PADDLE_LENGTH
-            }),
-        m_playerTwo({
-            WINDOW_WIDTH - COURT_MARGIN - PADDLE_PADDING - PADDLE_WIDTH,
-            WINDOW_HEIGHT / 2 - (PADDLE_LENGTH / 2),
-            PADDLE_WIDTH,
-            PADDLE_LENGTH
-            }),
-        m_playState(PLAY_STATE::SERVE_PLAYER_ONE)
+    // online matches tick in lockstep with the peer at UPDATE_MS
+    if (session)
     {
-        GameRenderer::Init(&target, &font);
+        tickMilliseconds = UPDATE_MS;
+        adaptiveTickRate = false;
     }
+    FramePacer pacer(tickMilliseconds, targetFps);
+    TickRateGovernor governor(tickMilliseconds, adaptiveTickRate);
+    InputQueue inputs;
 
-    GAME_STATE Update(const float elapsedMilliseconds)
-    {
-        float timeMultiplier = elapsedMilliseconds / 1000.0f;
-
-        const RectangleShape& paddle1 = m_playerOne.GetPositionSize();
-        const RectangleShape& paddle2 = m_playerTwo.GetPositionSize();
+    // Local matches tick on their own thread and this one draws the newest
+    // snapshot, unless --single-thread asks for the old interleaved loop.
+    // Online and multi-ball matches always run here.
+    const bool useSimulationThread = !singleThread && !session && !party && !view;
+    SimulationThread simulation(pong, inputs);
+    simulation.SetTickRate(tickMilliseconds, adaptiveTickRate);
+    GameRenderer matchRenderer(window, scoreFont, pong.GetSimulation().GetCourt());
+    if (useSimulationThread && gameState == GAME_STATE::IN_GAME)
+        simulation.Start();
 
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Q))
-            m_playerOne.SetPosition({ paddle1.x,paddle1.y - PADDLE_SPEED * timeMultiplier });
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Z))
-            m_playerOne.SetPosition({ paddle1.x,paddle1.y + PADDLE_SPEED * timeMultiplier });
+    // frames that toggle or write the profiler are not steady
+    FrameAllocations frameAllocations;
+    bool profilerTouched = false;
 
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::P))
-            m_playerTwo.SetPosition({ paddle2.x,paddle2.y - PADDLE_SPEED * timeMultiplier });
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Period))
-            m_playerTwo.SetPosition({ paddle2.x,paddle2.y + PADDLE_SPEED * timeMultiplier });
-
-        switch (m_playState)
+    auto handleEvent = [&](const sf::Event& event)
+    {
+        if (event.type == sf::Event::Closed)
+            window.close();
+        else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3)
         {
-        case PLAY_STATE::SERVE_PLAYER_ONE:
+            profilerTouched = true;
+            overlay.Toggle();
+            Profiler::SetEnabled(profile || overlay.IsVisible());
+        }
+        else if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F4)
         {
-            m_ball.SetVelocity({ 0,0 });
-            const RectangleShape& paddle = m_playerOne.GetPositionSize();
-            m_ball.SetPosition({ paddle.x + PADDLE_WIDTH,paddle.y + PADDLE_LENGTH / 2 });
-
-            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Space))
-            {
-                m_ball.SetVelocity({ BALL_VELOCITY,0 });
-                m_playState = PLAY_STATE::TOWARD_PLAYER_TWO;
-            }
-            break;
+            profilerTouched = true;
+            if (Profiler::Get().WriteChromeTrace(tracePath))
+                std::cout << "wrote trace " << tracePath << std::endl;
+            else
+                std::cerr << "could not write trace " << tracePath << std::endl;
         }
-        case PLAY_STATE::SERVE_PLAYER_TWO:
+        else if (simulation.IsRunning())
+            simulation.PushEvent(event, InputQueue::Clock::now());
+        else
+            inputs.HandleEvent(event, InputQueue::Clock::now());
+    };
+    auto pollEvents = [&]()
+    {
+        sf::Event event;
+        while (window.pollEvent(event))
+            handleEvent(event);
+        if (peer)
+            peer->Flush(InputQueue::Clock::now());
+        if (spectateSocket)
         {
-            m_ball.SetVelocity({ 0,0 });
-            const RectangleShape& paddle = m_playerTwo.GetPositionSize();
-            m_ball.SetPosition({ paddle.x - BALL_RADIUS,paddle.y + PADDLE_LENGTH / 2 });
-
-            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Space))
+            std::uint8_t buffer[256];
+            std::size_t received = 0;
+            sf::IpAddress sender;
+            unsigned short senderPort = 0;
+            const std::uint32_t milliseconds = spectatorMilliseconds();
+            while (spectateSocket->receive(buffer, sizeof(buffer), received, sender, senderPort) == sf::Socket::Done)
             {
-                m_ball.SetVelocity({ -BALL_VELOCITY,0 });
-                m_playState = PLAY_STATE::TOWARD_PLAYER_ONE;
+                if (broadcast)
+                    broadcast->HandlePacket(buffer, received, sender.toInteger(), senderPort, milliseconds);
+                else if (view)
+                    view->HandlePacket(buffer, received, milliseconds);
             }
-            break;
-        }
-        default:
-            break;
         }
+        audio.Update();
+    };
 
-        Vector2D ballPos = m_ball.GetPosition();
-        Vector2D ballVelocity = m_ball.GetVelocity();
-        const RectangleShape& courtShape = m_court.GetDimensions();
-
-        ballPos.x += ballVelocity.x * timeMultiplier;
-        ballPos.y += ballVelocity.y * timeMultiplier;
+    while (window.isOpen() && gameState != GAME_STATE::EXIT)
+    {
+        const GAME_STATE frameState = gameState;
+        profilerTouched = false;
+        frameAllocations.BeginFrame();
 
-        m_ball.SetPosition(ballPos);
+        overlay.Collect();
+        ProfileZone frameZone("frame");
 
-        switch (m_playState)
-        {
-        case PLAY_STATE::TOWARD_PLAYER_ONE:
+        if (gameState == GAME_STATE::MENU && menu.IsIdle())
         {
-            if (ballPos.x - BALL_RADIUS > paddle1.x + PADDLE_WIDTH)
-                break; // ball hasn't reached player 1
+            ProfileZone zone("idle");
 
-            if (ballPos.y + BALL_RADIUS >= paddle1.y && ballPos.y - BALL_RADIUS <= paddle1.y + PADDLE_LENGTH)
-            {
-                m_ball.SetPosition({ paddle1.x + PADDLE_WIDTH + BALL_RADIUS + 1, ballPos.y });
+            // sleep until the mouse or window does something instead of spinning
+            sf::Event event;
+            if (window.waitEvent(event))
+                handleEvent(event);
 
-                ballVelocity.x = -ballVelocity.x;
-
-                if (ballPos.y + BALL_RADIUS <= paddle1.y + PADDLE_LENGTH / 3)
-                    ballVelocity.y -= BALL_VELOCITY / 2;
-                else if (ballPos.y - BALL_RADIUS >= paddle1.y + PADDLE_LENGTH / 3 * 2)
-                    ballVelocity.y += BALL_VELOCITY / 2;
-
-                if (ballVelocity.x > 0)
-                    ballVelocity.x += BALL_VEL_INCR;
-                else
-                    ballVelocity.x -= BALL_VEL_INCR;
+            // the idle time is not simulated; update once straight away for the event
+            pacer.Resync();
+        }
 
-                if (ballVelocity.y > 0)
-                    ballVelocity.y += BALL_VEL_INCR;
-                else
-                    ballVelocity.y -= BALL_VEL_INCR;
+        {
+            ProfileZone zone("events");
+            pollEvents();
+        }
 
-                m_ball.SetVelocity(ballVelocity);
-                m_playState = PLAY_STATE::TOWARD_PLAYER_TWO;
+        const std::uint32_t steps = pacer.BeginFrame();
+        const float stepMilliseconds = governor.GetTickMilliseconds();
 
-                break;
+        {
+            ProfileZone zone("update");
+            if (simulation.IsRunning() && simulation.GetSnapshot().gameState != GAME_STATE::IN_GAME)
+            {
+                // the match ended on the simulation thread
+                simulation.Stop();
+                gameState = GAME_STATE::MENU;
+                menu.Reset();
+                pong.Reset();
             }
 
-            if (ballPos.x + BALL_RADIUS < paddle1.x)
+            for (std::uint32_t step = 0; step < steps && !simulation.IsRunning() && !view; ++step)
             {
-                ++m_playerTwoScore;
-                m_playState = PLAY_STATE::SERVE_PLAYER_ONE;
+                const TickRateGovernor::Clock::time_point tickStart = TickRateGovernor::Clock::now();
+                if (gameState == GAME_STATE::MENU)
+                {
+                    ProfileZone stepZone("menu.Update");
+                    gameState = menu.Update(stepMilliseconds, inputs.GetMousePosition(), inputs.TakeMouseState());
+                    if (gameState == GAME_STATE::IN_GAME)
+                    {
+                        inputs.Flush();
+                        if (useSimulationThread)
+                            simulation.Start();
+                    }
+                }
+                else if (party)
+                {
+                    ProfileZone stepZone("multiball.Update");
+                    gameState = party->Update(stepMilliseconds, inputs, pacer.GetStepEnd(step, steps));
+                }
+                else if (session)
+                {
+                    ProfileZone stepZone("pong.UpdateNetplay");
+                    peer->Receive(*session);
+                    gameState = pong.UpdateNetplay(*session, inputs, pacer.GetStepEnd(step, steps));
+                    peer->Send(*session, InputQueue::Clock::now());
+
+                    // keep confirming inputs for a moment so the other side can finish too
+                    if (gameState == GAME_STATE::MENU)
+                        gameState = ++lingerTicks < NETPLAY_LINGER_TICKS ? GAME_STATE::IN_GAME : GAME_STATE::EXIT;
+                }
+                else
+                {
+                    ProfileZone stepZone("pong.Update");
+                    gameState = pong.Update(stepMilliseconds, inputs, pacer.GetStepEnd(step, steps));
+                    if (gameState == GAME_STATE::MENU)
+                    {
+                        menu.Reset();
+                        pong.Reset();
+                    }
+                }
+                governor.RecordTick(TickRateGovernor::Clock::now() - tickStart);
             }
 
-            break;
+            // the simulation thread owns pong and runs its own governor, so
+            // this one only judges the frames that ticked here
+            if (simulation.IsRunning())
+                governor.Resync(pacer.GetStats().droppedSteps);
+            else if (governor.Adjust(pacer.GetStats().droppedSteps))
+            {
+                pacer.SetUpdateMilliseconds(governor.GetTickMilliseconds());
+                pong.SetTickMilliseconds(governor.GetTickMilliseconds());
+                std::cout << "tick rate now " << 1000 / governor.GetTickMilliseconds() << " Hz" << std::endl;
+            }
         }
-        case PLAY_STATE::TOWARD_PLAYER_TWO:
+
+        const PongSnapshot* drawn = nullptr;
         {
-            if (ballPos.x + BALL_RADIUS < paddle2.x)
-                break;
+            ProfileZone zone("render");
+            window.clear();
 
-            if (ballPos.y + BALL_RADIUS >= paddle2.y && ballPos.y - BALL_RADIUS <= paddle2.y + PADDLE_LENGTH)
+            if (gameState == GAME_STATE::MENU)
+                menu.Render(pacer.GetFrameMilliseconds());
+            else if (simulation.IsRunning())
             {
-                m_ball.SetPosition({ paddle2.x - BALL_RADIUS - 1, ballPos.y });
-
-                ballVelocity.x = -ballVelocity.x;
-
-                if (ballPos.y + BALL_RADIUS <= paddle2.y + PADDLE_LENGTH / 3)
-                    ballVelocity.y -= BALL_VELOCITY / 2;
-                else if (ballPos.y - BALL_RADIUS >= paddle2.y + PADDLE_LENGTH / 3 * 2)
-                    ballVelocity.y += BALL_VELOCITY / 2;
-
-                if (ballVelocity.x > 0)
-                    ballVelocity.x += BALL_VEL_INCR;
-                else
-                    ballVelocity.x -= BALL_VEL_INCR;
-
-                if (ballVelocity.y > 0)
-                    ballVelocity.y += BALL_VEL_INCR;
-                else
-                    ballVelocity.y -= BALL_VEL_INCR;
-
-                m_ball.SetVelocity(ballVelocity);
-                m_playState = PLAY_STATE::TOWARD_PLAYER_ONE;
-
-                break;
+                drawn = &simulation.GetSnapshot();
+                const float interpolation = SimulationThread::GetInterpolation(*drawn, InputQueue::Clock::now());
+                matchRenderer.Render(pacer.GetFrameMilliseconds(), drawn->previous, drawn->current, interpolation);
             }
-
-            if (ballPos.x - BALL_RADIUS > paddle2.x + PADDLE_WIDTH)
+            else if (party)
+                party->Render();
+            else if (view)
             {
-                ++m_playerOneScore;
-                m_playState = PLAY_STATE::SERVE_PLAYER_TWO;
+                // moved on from the newest frame to now, so nothing to interpolate
+                if (view->HasFrame())
+                    watched.Restore(view->GetFrame(spectatorMilliseconds()).ToState());
+                matchRenderer.Render(pacer.GetFrameMilliseconds(), watched, watched, 1);
             }
+            else
+                matchRenderer.Render(pacer.GetFrameMilliseconds(), pong.GetPrevious(), pong.GetSimulation(), pacer.GetLagMilliseconds() / pacer.GetUpdateMilliseconds());
 
-            break;
-        }
-        default:
-            break;
+            overlay.Render();
         }
 
-        if (ballPos.y <= courtShape.y)
         {
-            m_ball.SetPosition({ ballPos.x,courtShape.y });
-            m_ball.SetVelocity({ ballVelocity.x,-ballVelocity.y });
+            // blocks here on vsync
+            ProfileZone zone("display");
+            window.display();
         }
-        else if (ballPos.y >= courtShape.y + courtShape.height)
+        if (drawn != nullptr)
+            simulation.RecordDisplayed(*drawn, InputQueue::Clock::now());
+        else
+            inputs.RecordDisplayed(InputQueue::Clock::now());
+
+        if (spectateSocket)
         {
-            m_ball.SetPosition({ ballPos.x,courtShape.y + courtShape.height });
-            m_ball.SetVelocity({ ballVelocity.x,-ballVelocity.y });
+            ProfileZone zone("spectators");
+            const std::uint32_t milliseconds = spectatorMilliseconds();
+            if (view)
+            {
+                std::uint8_t watch[SpectatorProtocol::WATCH_SIZE];
+                if (view->WriteWatch(watch, milliseconds) > 0)
+                    spectateSocket->send(watch, sizeof(watch), watchAddress, watchPort);
+            }
+            else
+            {
+                // the newest tick, from whichever thread ran it
+                if (drawn != nullptr)
+                    broadcast->Update(drawn->previous, drawn->current, drawn->tickMilliseconds, milliseconds);
+                else if (gameState == GAME_STATE::IN_GAME && !party)
+                    broadcast->Update(pong.GetPrevious(), pong.GetSimulation(), pacer.GetUpdateMilliseconds(), milliseconds);
+                broadcast->ForEachOutgoing(milliseconds, [&](const std::uint32_t address, const std::uint16_t port, const std::uint8_t* data, const std::size_t size)
+                {
+                    spectateSocket->send(data, size, sf::IpAddress(address), port);
+                });
+            }
         }
 
-        if (m_playerOneScore >= m_maxScore || m_playerTwoScore >= m_maxScore)
-            return GAME_STATE::MENU;
-
-        return GAME_STATE::IN_GAME;
-    }
-
-    void Render(const float elapsedMilliseconds) const
-    {
-        GameRenderer::Render(elapsedMilliseconds, m_playerOne, m_playerTwo, m_ball, m_court, m_playerOneScore, m_playerTwoScore);
-    }
-
-private:
-    std::uint_fast8_t m_playerOneScore;
-    std::uint_fast8_t m_playerTwoScore;
-    std::uint_fast8_t m_maxScore;
-    const Court m_court;
-    Ball m_ball;
-    Paddle m_playerOne;
-    Paddle m_playerTwo;
-    PLAY_STATE m_playState;
-};
-
-class Button
-{
-public:
-    typedef std::function<void(void)> CallbackFunc;
-
-    enum class STATE : std::uint_fast8_t
-    {
-        UP,
-        DOWN,
-        HOVER
-    };
-
-    Button(const std::string text, const RectangleShape positionAndSize)
-        :
-        m_text(text),
-        m_positionAndSize(positionAndSize),
-        m_colorUp(sf::Color::Black),
-        m_colorDown(sf::Color::Red),
-        m_colorHover(sf::Color::Yellow),
-        m_callback([]() {}),
-        m_state(STATE::UP)
-    {
-    }
-
-    const RectangleShape& GetPositionAndSize() const
-    {
-        return m_positionAndSize;
-    }
-
-    void SetPositionAndSize(const RectangleShape newPositionAndSize)
-    {
-        m_positionAndSize = newPositionAndSize;
-    }
-
-    void SetPosition(const Vector2D newPosition)
-    {
-        m_positionAndSize.x = newPosition.x;
-        m_positionAndSize.y = newPosition.y;
-    }
-
-    void SetSize(const Vector2D newSize)
-    {
-        m_positionAndSize.width = newSize.x;
-        m_positionAndSize.height = newSize.y;
-    }
-
-    bool HandleInput(const Vector2D& mousePosition, const MOUSE_STATE& mouseState)
-    {
-        if (mousePosition.x >= m_positionAndSize.x &&
-            mousePosition.x <= m_positionAndSize.x + m_positionAndSize.width &&
-            mousePosition.y >= m_positionAndSize.y &&
-            mousePosition.y <= m_positionAndSize.y + m_positionAndSize.height)
+        if (pacer.GetStats().frames == 1)
         {
-            m_state = STATE::HOVER;
+            const std::chrono::steady_clock::time_point firstFrameTime = std::chrono::steady_clock::now();
+            std::cout << "first frame " << std::chrono::duration<double, std::milli>(firstFrameTime - launchTime).count()
+                << " ms after launch, assets " << std::chrono::duration<double, std::milli>(assetsEnd - assetsStart).count()
+                << " ms " << (fromPack ? "from " + packPath : std::string("rasterised from the font file")) << std::endl;
+            if (quitAfterFirstFrame)
+                break;
         }
-        else
-            m_state = STATE::UP;
 
-        if (mouseState == MOUSE_STATE::DOWN && m_state == STATE::HOVER)
         {
-            m_state = STATE::DOWN;
-            m_callback();
-            return true;
+            // keep draining events while waiting so their timestamps stay accurate
+            ProfileZone zone("wait");
+            pacer.WaitForNextFrame(pollEvents);
         }
 
-        return false;
-    }
-
-    void SetColors(const sf::Color upColor, const sf::Color downColor, const sf::Color hoverColor)
-    {
-        m_colorUp = upColor;
-        m_colorHover = downColor;
-        m_colorHover = hoverColor;
-    }
-
-    void SetCallback(const CallbackFunc callback)
-    {
-        m_callback = callback;
-    }
-
-    const Button::STATE& GetState() const
-    {
-        return m_state;
-    }
-
-    void SetState(const Button::STATE newState)
-    {
-        m_state = newState;
-    }
-
-    void Render(sf::RenderTarget& target, const sf::Font& font) const
-    {
-        sf::Text buttonText(m_text, font, 60);
-        buttonText.setColor(m_colorUp);
-        if (m_state == STATE::DOWN)
-            buttonText.setColor(m_colorDown);
-        else if (m_state == STATE::HOVER)
-            buttonText.setColor(m_colorHover);
-
-        buttonText.setPosition({ m_positionAndSize.x,m_positionAndSize.y });
-
-        sf::RectangleShape bg;
-        bg.setPosition({ m_positionAndSize.x,m_positionAndSize.y });
-        bg.setSize({ m_positionAndSize.width,m_positionAndSize.height });
-        bg.setFillColor(sf::Color::White);
-
-        target.draw(bg);
-        target.draw(buttonText);
+        // the overlay formats its table every frame it is shown
+        const bool settled = gameState == frameState && !profilerTouched && !overlay.IsVisible();
+        frameAllocations.EndFrame(settled);
+        if (checkAllocationFrames > 0 && pacer.GetStats().frames >= checkAllocationFrames)
+            break;
     }
 
-private:
+    simulation.Stop();
 
-    std::string m_text;
-    RectangleShape m_positionAndSize;
-    sf::Color m_colorUp;
-    sf::Color m_colorDown;
-    sf::Color m_colorHover;
-    CallbackFunc m_callback;
-    STATE m_state;
-};
+    const FrameStats stats = pacer.GetStats();
+    std::cout << "frames: " << stats.frames
+        << "  frame ms mean " << stats.meanMilliseconds
+        << " stddev " << stats.stdDevMilliseconds
+        << " min " << stats.minMilliseconds
+        << " max " << stats.maxMilliseconds
+        << "  late frames: " << stats.lateFrames
+        << "  dropped steps: " << stats.droppedSteps << std::endl;
 
-class PongMenu
-{
-public:
-    PongMenu(sf::RenderTarget& target, sf::Font& font)
-        :
-        m_target(target),
-        m_font(font),
-        m_playButton("PLAY", { WINDOW_WIDTH / 2,WINDOW_HEIGHT / 2,140,65 }),
-        m_exitButton("EXIT", { WINDOW_WIDTH / 2,WINDOW_HEIGHT / 2 + 100,130,65 }),
-        m_shouldExit(false),
-        m_shouldStart(false)
+    if (useSimulationThread)
     {
-        m_playButton.SetCallback([this]() {m_shouldStart = true; });
-        m_exitButton.SetCallback([this]() {m_shouldExit = true; });
+        const FrameStats& ticks = simulation.GetTickStats();
+        std::cout << "simulation ticks: " << ticks.frames
+            << "  tick ms mean " << ticks.meanMilliseconds
+            << " stddev " << ticks.stdDevMilliseconds
+            << " max " << ticks.maxMilliseconds
+            << "  late ticks: " << ticks.lateFrames
+            << "  dropped steps: " << ticks.droppedSteps
+            << "  dropped events: " << simulation.GetDroppedEvents() << std::endl;
     }
 
-    GAME_STATE Update(const float elapsedMilliseconds, const Vector2D& mousePos)
-    {
-        MOUSE_STATE state = MOUSE_STATE::UP;
-        if (sf::Mouse::isButtonPressed(sf::Mouse::Left) ||
-            sf::Mouse::isButtonPressed(sf::Mouse::Middle) ||
-            sf::Mouse::isButtonPressed(sf::Mouse::Right))
-            state = MOUSE_STATE::DOWN;
-
-        m_playButton.HandleInput(mousePos, state);
-        m_exitButton.HandleInput(mousePos, state);
-
-        if (m_shouldExit)
-            return GAME_STATE::EXIT;
-        if (m_shouldStart)
-            return GAME_STATE::IN_GAME;
-        return GAME_STATE::MENU;
-    }
+    // the simulation thread ran the local matches, this loop everything else
+    const TickRateStats tickRateStats = useSimulationThread ? simulation.GetTickRateStats() : governor.GetStats();
+    std::cout << "tick rate Hz: requested " << tickRateStats.requestedHz
+        << " last " << tickRateStats.currentHz
+        << " lowest " << tickRateStats.lowestHz
+        << " (" << tickRateStats.changes << " changes)"
+        << "  tick us mean " << tickRateStats.meanMicroseconds
+        << " max " << tickRateStats.maxMicroseconds
+        << "  ticking used " << tickRateStats.load * 100 << "% of a core" << std::endl;
 
-    void Render(const float elapsedMilliseconds) const
-    {
-        m_playButton.Render(m_target, m_font);
-        m_exitButton.Render(m_target, m_font);
-    }
+    const LatencyStats& latency = useSimulationThread ? simulation.GetLatency() : inputs.GetLatency();
+    std::cout << "input to display ms: mean " << latency.meanMilliseconds
+        << " max " << latency.maxMilliseconds
+        << " over " << latency.samples << " frames" << std::endl;
 
-    void Reset()
+    if (session)
     {
-        m_shouldExit = false;
-        m_shouldStart = false;
+        const RollbackStats& net = session->GetStats();
+        std::cout << "netplay frames: " << net.frames
+            << "  stalls: " << net.stalls
+            << "  rollbacks: " << net.rollbacks
+            << " (max " << net.maxRollbackFrames << " frames, " << net.maxRollbackMicroseconds << " us)"
+            << "  packets received: " << net.packetsReceived
+            << "  dropped by shim: " << peer->GetConditioner().GetDropped() << std::endl;
     }
 
-private:
-
-    sf::RenderTarget& m_target;
-    sf::Font& m_font;
-
-    Button m_playButton;
-    Button m_exitButton;
-
-    bool m_shouldExit;
-    bool m_shouldStart;
-};
-
-int main()
-{
-    sf::RenderWindow window(sf::VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "Pong");
-
-    sf::Font font;
-    if (!font.loadFromFile("SourceSansPro-Regular.otf"))
+    if (AllocationTracker::IsEnabled())
     {
-        std::cerr << "could not load font " << std::endl;
-        return 0;
+        const AllocationStats& allocations = frameAllocations.GetStats();
+        std::cout << "steady frames: " << allocations.steadyFrames
+            << "  allocating: " << allocations.allocatingFrames
+            << "  allocations: " << allocations.allocations
+            << " (max " << allocations.maxPerFrame << " in a frame)";
+        if (allocations.allocatingFrames > 0)
+            std::cout << "  first at frame " << allocations.firstAllocatingFrame;
+        std::cout << std::endl;
     }
 
-    GAME_STATE gameState = GAME_STATE::MENU;
-
-    PongGame pong(3, window, font);
-    PongMenu menu(window, font);
-
-    std::chrono::system_clock::time_point lastTime = std::chrono::system_clock::now();
-    float frameLag = 0;
-
-    while (window.isOpen() && gameState != GAME_STATE::EXIT)
-    {
-        sf::Event event;
-        while (window.pollEvent(event))
-        {
-            if (event.type == sf::Event::Closed)
-                window.close();
-        }
-
-        std::chrono::system_clock::time_point currentTime = std::chrono::system_clock::now();
-        std::chrono::milliseconds elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - lastTime);
-        lastTime = currentTime;
-        frameLag += elapsedTime.count();
-
-        sf::Vector2i mousePos = sf::Mouse::getPosition(window);
-
-        while (frameLag >= UPDATE_MS)
-        {
-            frameLag -= UPDATE_MS;
-            if (gameState == GAME_STATE::MENU)
-                gameState = menu.Update(UPDATE_MS, { mousePos.x,mousePos.y });
-            else
-            {
-                gameState = pong.Update(UPDATE_MS);
-                if (gameState == GAME_STATE::MENU)
-                    menu.Reset();
-            }
-        }
-
-        window.clear();
-
-        if (gameState == GAME_STATE::MENU)
-            menu.Render(elapsedTime.count());
-        else
-            pong.Render(elapsedTime.count());
-
-        window.display();
-    }
+    if (profile && !Profiler::Get().WriteChromeTrace(tracePath))
+        std::cerr << "could not write trace " << tracePath << std::endl;
 
     window.close();
 
-    return 0;
+    return checkAllocationFrames > 0 && frameAllocations.GetStats().allocatingFrames > 0 ? 1 : 0;
 }
 
@@ -0,0 +1,391 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include "baked_font.h"
+#include "pong_core.h"
+#include "pong_game.h"
+
+// Retained-mode game drawing. The court outline and center line are built
+// once at the front of a single triangle array; the paddles and ball behind
+// them are rewritten in place each frame, so the whole scene is one draw
+// call plus the score text, which is only rebuilt when a score changes.
+// The score is drawn from a pre-rasterised atlas of the 40 px font.
+class GameRenderer
+{
+public:
+    static const unsigned SCORE_CHARACTER_SIZE = 40;
+
+    GameRenderer(sf::RenderTarget& target, const BakedAtlas& scoreFont, const Court& court)
+        :
+        m_target(target),
+        m_vertices(sf::Triangles, BALL_FIRST + BALL_SEGMENTS * 3),
+        m_score(scoreFont),
+        m_playerOneScore(0),
+        m_playerTwoScore(0),
+        m_scoreValid(false)
+    {
+        const RectangleShape& cShape = court.GetDimensions();
+
+        // outline drawn inside the court rectangle, as a negative sf::Shape outline would be
+        SetRectangle(COURT_FIRST, { cShape.x,cShape.y,cShape.width,COURT_OUTLINE_WIDTH });
+        SetRectangle(COURT_FIRST + 6, { cShape.x,cShape.y + cShape.height - COURT_OUTLINE_WIDTH,cShape.width,COURT_OUTLINE_WIDTH });
+        SetRectangle(COURT_FIRST + 12, { cShape.x,cShape.y,COURT_OUTLINE_WIDTH,cShape.height });
+        SetRectangle(COURT_FIRST + 18, { cShape.x + cShape.width - COURT_OUTLINE_WIDTH,cShape.y,COURT_OUTLINE_WIDTH,cShape.height });
+        SetRectangle(CENTER_LINE_FIRST, { WINDOW_WIDTH / 2 - COURT_OUTLINE_WIDTH / 2,COURT_MARGIN,COURT_OUTLINE_WIDTH,WINDOW_HEIGHT - COURT_MARGIN * 2 });
+
+        for (std::size_t i = 0; i < BALL_SEGMENTS; ++i)
+        {
+            const float angle = i * 2 * 3.14159265f / BALL_SEGMENTS;
+            m_circle[i] = { std::cos(angle),std::sin(angle) };
+        }
+
+        for (std::size_t i = 0; i < m_vertices.getVertexCount(); ++i)
+            m_vertices[i].color = sf::Color::White;
+    }
+
+    void Render(const float& elapsedMilliseconds,
+        const Paddle& playerOne,
+        const Paddle& playerTwo,
+        const Ball& ball,
+        const std::uint_fast8_t& p1Score,
+        const std::uint_fast8_t& p2Score)
+    {
+        SetRectangle(PLAYER_ONE_FIRST, playerOne.GetPositionSize());
+        SetRectangle(PLAYER_TWO_FIRST, playerTwo.GetPositionSize());
+
+        const Vector2D& ballPosition = ball.GetPosition();
+        const float& ballRadius = ball.GetRadius();
+        for (std::size_t i = 0; i < BALL_SEGMENTS; ++i)
+        {
+            const sf::Vector2f& from = m_circle[i];
+            const sf::Vector2f& to = m_circle[(i + 1) % BALL_SEGMENTS];
+            m_vertices[BALL_FIRST + i * 3].position = { ballPosition.x,ballPosition.y };
+            m_vertices[BALL_FIRST + i * 3 + 1].position = { ballPosition.x + from.x * ballRadius,ballPosition.y + from.y * ballRadius };
+            m_vertices[BALL_FIRST + i * 3 + 2].position = { ballPosition.x + to.x * ballRadius,ballPosition.y + to.y * ballRadius };
+        }
+
+        m_target.draw(m_vertices);
+
+        if (!m_scoreValid || p1Score != m_playerOneScore || p2Score != m_playerTwoScore)
+        {
+            m_playerOneScore = p1Score;
+            m_playerTwoScore = p2Score;
+            m_scoreValid = true;
+
+            char text[16];
+            std::snprintf(text, sizeof(text), "%u   %u", static_cast<unsigned>(p1Score), static_cast<unsigned>(p2Score));
+            m_score.SetString(text);
+            m_score.SetPosition({ WINDOW_WIDTH / 2 - m_score.GetWidth() / 2,COURT_MARGIN + COURT_OUTLINE_WIDTH + 5 });
+        }
+
+        m_score.Draw(m_target);
+    }
+
+    // draws the match interpolation (0..1) of the way from previous to current
+    void Render(const float elapsedMilliseconds, const PongSimulation& previous, const PongSimulation& current, const float interpolation)
+    {
+        const Paddle playerOne = Lerp(previous.GetPlayerOne(), current.GetPlayerOne(), interpolation);
+        const Paddle playerTwo = Lerp(previous.GetPlayerTwo(), current.GetPlayerTwo(), interpolation);
+
+        // don't slide the ball back from the goal to the serving paddle
+        Ball ball = current.GetBall();
+        if (previous.GetPlayerOneScore() == current.GetPlayerOneScore() &&
+            previous.GetPlayerTwoScore() == current.GetPlayerTwoScore())
+        {
+            const Vector2D& from = previous.GetBall().GetPosition();
+            const Vector2D& to = current.GetBall().GetPosition();
+            ball.SetPosition({ Lerp(from.x, to.x, interpolation),Lerp(from.y, to.y, interpolation) });
+        }
+
+        Render(elapsedMilliseconds,
+            playerOne,
+            playerTwo,
+            ball,
+            current.GetPlayerOneScore(),
+            current.GetPlayerTwoScore());
+    }
+
+private:
+    static const std::size_t BALL_SEGMENTS = 30;
+
+    // vertex ranges in m_vertices, six vertices per rectangle
+    static const std::size_t COURT_FIRST = 0;
+    static const std::size_t CENTER_LINE_FIRST = COURT_FIRST + 4 * 6;
+    static const std::size_t PLAYER_ONE_FIRST = CENTER_LINE_FIRST + 6;
+    static const std::size_t PLAYER_TWO_FIRST = PLAYER_ONE_FIRST + 6;
+    static const std::size_t BALL_FIRST = PLAYER_TWO_FIRST + 6;
+
+    static float Lerp(const float from, const float to, const float t)
+    {
+        return from + (to - from) * t;
+    }
+
+    static Paddle Lerp(const Paddle& from, const Paddle& to, const float t)
+    {
+        Paddle paddle = to;
+        paddle.SetPosition({ to.GetPositionSize().x,Lerp(from.GetPositionSize().y, to.GetPositionSize().y, t) });
+        return paddle;
+    }
+
+    void SetRectangle(const std::size_t first, const RectangleShape& rect)
+    {
+        const sf::Vector2f topLeft(rect.x, rect.y);
+        const sf::Vector2f topRight(rect.x + rect.width, rect.y);
+        const sf::Vector2f bottomLeft(rect.x, rect.y + rect.height);
+        const sf::Vector2f bottomRight(rect.x + rect.width, rect.y + rect.height);
+
+        m_vertices[first].position = topLeft;
+        m_vertices[first + 1].position = topRight;
+        m_vertices[first + 2].position = bottomRight;
+        m_vertices[first + 3].position = topLeft;
+        m_vertices[first + 4].position = bottomRight;
+        m_vertices[first + 5].position = bottomLeft;
+    }
+
+    sf::RenderTarget& m_target;
+    sf::VertexArray m_vertices;
+    sf::Vector2f m_circle[BALL_SEGMENTS];
+    BakedText m_score;
+    std::uint_fast8_t m_playerOneScore;
+    std::uint_fast8_t m_playerTwoScore;
+    bool m_scoreValid;
+};
+
+// The label and the callback are held as plain pointers, so a button never
+// copies a string or wraps a closure; the label must outlive the button.
+class Button
+{
+public:
+    typedef void (*CallbackFunc)(void* context);
+
+    enum class STATE : std::uint_fast8_t
+    {
+        UP,
+        DOWN,
+        HOVER
+    };
+
+    Button(const char* text, const RectangleShape positionAndSize)
+        :
+        m_text(text),
+        m_positionAndSize(positionAndSize),
+        m_colorUp(sf::Color::Black),
+        m_colorDown(sf::Color::Red),
+        m_colorHover(sf::Color::Yellow),
+        m_callback(nullptr),
+        m_callbackContext(nullptr),
+        m_state(STATE::UP)
+    {
+        m_background.setFillColor(sf::Color::White);
+        UpdateBackground();
+    }
+
+    const RectangleShape& GetPositionAndSize() const
+    {
+        return m_positionAndSize;
+    }
+
+    void SetPositionAndSize(const RectangleShape newPositionAndSize)
+    {
+        m_positionAndSize = newPositionAndSize;
+        UpdateBackground();
+    }
+
+    void SetPosition(const Vector2D newPosition)
+    {
+        m_positionAndSize.x = newPosition.x;
+        m_positionAndSize.y = newPosition.y;
+        UpdateBackground();
+    }
+
+    void SetSize(const Vector2D newSize)
+    {
+        m_positionAndSize.width = newSize.x;
+        m_positionAndSize.height = newSize.y;
+        UpdateBackground();
+    }
+
+    bool HandleInput(const Vector2D& mousePosition, const MOUSE_STATE& mouseState)
+    {
+        if (mousePosition.x >= m_positionAndSize.x &&
+            mousePosition.x <= m_positionAndSize.x + m_positionAndSize.width &&
+            mousePosition.y >= m_positionAndSize.y &&
+            mousePosition.y <= m_positionAndSize.y + m_positionAndSize.height)
+        {
+            m_state = STATE::HOVER;
+        }
+        else
+            m_state = STATE::UP;
+
+        if (mouseState == MOUSE_STATE::DOWN && m_state == STATE::HOVER)
+        {
+            m_state = STATE::DOWN;
+            if (m_callback != nullptr)
+                m_callback(m_callbackContext);
+            return true;
+        }
+
+        return false;
+    }
+
+    void SetColors(const sf::Color upColor, const sf::Color downColor, const sf::Color hoverColor)
+    {
+        m_colorUp = upColor;
+        m_colorHover = downColor;
+        m_colorHover = hoverColor;
+    }
+
+    // callback(context) runs when the button is pressed
+    void SetCallback(const CallbackFunc callback, void* context)
+    {
+        m_callback = callback;
+        m_callbackContext = context;
+    }
+
+    const Button::STATE& GetState() const
+    {
+        return m_state;
+    }
+
+    void SetState(const Button::STATE newState)
+    {
+        m_state = newState;
+    }
+
+    // font is the 60 px atlas
+    void Render(sf::RenderTarget& target, const BakedAtlas& font) const
+    {
+        BakedText buttonText(font);
+        buttonText.SetColor(m_colorUp);
+        if (m_state == STATE::DOWN)
+            buttonText.SetColor(m_colorDown);
+        else if (m_state == STATE::HOVER)
+            buttonText.SetColor(m_colorHover);
+
+        buttonText.SetPosition({ m_positionAndSize.x,m_positionAndSize.y });
+        buttonText.SetString(m_text);
+
+        target.draw(m_background);
+        buttonText.Draw(target);
+    }
+
+private:
+    // a shape's vertices are allocated when it is first given a size, so it is kept
+    void UpdateBackground()
+    {
+        m_background.setPosition({ m_positionAndSize.x,m_positionAndSize.y });
+        m_background.setSize({ m_positionAndSize.width,m_positionAndSize.height });
+    }
+
+    const char* m_text;
+    RectangleShape m_positionAndSize;
+    sf::RectangleShape m_background;
+    sf::Color m_colorUp;
+    sf::Color m_colorDown;
+    sf::Color m_colorHover;
+    CallbackFunc m_callback;
+    void* m_callbackContext;
+    STATE m_state;
+};
+
+// The buttons are drawn into an offscreen texture that is only redrawn when a
+// button changes state; every other frame just blits it.
+class PongMenu
+{
+public:
+    static const unsigned BUTTON_CHARACTER_SIZE = 60;
+
+    PongMenu(sf::RenderTarget& target, const BakedAtlas& font)
+        :
+        m_target(target),
+        m_font(font),
+        m_playButton("PLAY", { WINDOW_WIDTH / 2,WINDOW_HEIGHT / 2,140,65 }),
+        m_exitButton("EXIT", { WINDOW_WIDTH / 2,WINDOW_HEIGHT / 2 + 100,130,65 }),
+        m_shouldExit(false),
+        m_shouldStart(false),
+        m_dirty(true)
+    {
+        m_playButton.SetCallback([](void* menu) {static_cast<PongMenu*>(menu)->m_shouldStart = true; }, this);
+        m_exitButton.SetCallback([](void* menu) {static_cast<PongMenu*>(menu)->m_shouldExit = true; }, this);
+
+        // without render-texture support the buttons are drawn directly every frame
+        m_cacheAvailable = m_cache.create(WINDOW_WIDTH, WINDOW_HEIGHT);
+        if (m_cacheAvailable)
+            m_cacheSprite.setTexture(m_cache.getTexture(), true);
+    }
+
+    GAME_STATE Update(const float elapsedMilliseconds, const Vector2D& mousePos, const MOUSE_STATE state)
+    {
+        const Button::STATE playState = m_playButton.GetState();
+        const Button::STATE exitState = m_exitButton.GetState();
+
+        m_playButton.HandleInput(mousePos, state);
+        m_exitButton.HandleInput(mousePos, state);
+
+        if (m_playButton.GetState() != playState || m_exitButton.GetState() != exitState)
+            m_dirty = true;
+
+        if (m_shouldExit)
+            return GAME_STATE::EXIT;
+        if (m_shouldStart)
+            return GAME_STATE::IN_GAME;
+        return GAME_STATE::MENU;
+    }
+
+    void Render(const float elapsedMilliseconds)
+    {
+        if (!m_cacheAvailable)
+        {
+            m_playButton.Render(m_target, m_font);
+            m_exitButton.Render(m_target, m_font);
+            m_dirty = false;
+            return;
+        }
+
+        if (m_dirty)
+        {
+            m_cache.clear(sf::Color::Transparent);
+            m_playButton.Render(m_cache, m_font);
+            m_exitButton.Render(m_cache, m_font);
+            m_cache.display();
+            m_dirty = false;
+        }
+
+        m_target.draw(m_cacheSprite);
+    }
+
+    // true once the last change has been drawn; nothing will change again
+    // until the window receives an event
+    bool IsIdle() const
+    {
+        return !m_dirty && !m_shouldExit && !m_shouldStart;
+    }
+
+    void Reset()
+    {
+        m_shouldExit = false;
+        m_shouldStart = false;
+        m_dirty = true;
+    }
+
+private:
+
+    sf::RenderTarget& m_target;
+    const BakedAtlas& m_font;
+
+    Button m_playButton;
+    Button m_exitButton;
+
+    bool m_shouldExit;
+    bool m_shouldStart;
+
+    sf::RenderTexture m_cache;
+    sf::Sprite m_cacheSprite;
+    bool m_cacheAvailable;
+    bool m_dirty;
+};
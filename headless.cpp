@@ -0,0 +1,344 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "pong_ai.h"
+#include "pong_bots.h"
+#include "pong_core.h"
+#include "replay.h"
+
+// longest jump taken in --events mode while no paddle is moving
+const float EVENT_HORIZON_MS = 1000;
+
+// fixed input sequence read from a file, one "<ticks> <keys>" run per line;
+// keys use the game bindings q/z/p/. plus s for serve, or - for nothing held
+class InputScript
+{
+public:
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+            return false;
+
+        std::uint32_t ticks;
+        std::string keys;
+        while (file >> ticks >> keys)
+        {
+            PongInput input;
+            input.playerOneUp = keys.find('q') != std::string::npos;
+            input.playerOneDown = keys.find('z') != std::string::npos;
+            input.playerTwoUp = keys.find('p') != std::string::npos;
+            input.playerTwoDown = keys.find('.') != std::string::npos;
+            input.serve = keys.find('s') != std::string::npos;
+            m_runs.push_back({ ticks,input });
+            m_length += ticks;
+        }
+
+        return m_length > 0;
+    }
+
+    // the script loops once it runs out
+    PongInput Get(std::uint64_t tick) const
+    {
+        tick %= m_length;
+        for (const Run& run : m_runs)
+        {
+            if (tick < run.ticks)
+                return run.input;
+            tick -= run.ticks;
+        }
+        return {};
+    }
+
+private:
+    struct Run
+    {
+        std::uint64_t ticks;
+        PongInput input;
+    };
+
+    std::vector<Run> m_runs;
+    std::uint64_t m_length = 0;
+};
+
+static bool ParsePolicy(const char* name, POLICY& policy)
+{
+    if (std::strcmp(name, "idle") == 0)
+        policy = POLICY::IDLE;
+    else if (std::strcmp(name, "track") == 0)
+        policy = POLICY::TRACK;
+    else if (std::strcmp(name, "random") == 0)
+        policy = POLICY::RANDOM;
+    else if (std::strcmp(name, "cpu") == 0)
+        policy = POLICY::CPU;
+    else
+        return false;
+    return true;
+}
+
+static bool ParseDifficulty(const char* name, CpuSettings& settings)
+{
+    if (std::strcmp(name, "easy") == 0)
+        settings = CpuSettings::Easy();
+    else if (std::strcmp(name, "normal") == 0)
+        settings = CpuSettings::Normal();
+    else if (std::strcmp(name, "hard") == 0)
+        settings = CpuSettings::Hard();
+    else
+        return false;
+    return true;
+}
+
+static void PrintUsage()
+{
+    std::cerr << "usage: pong_headless [--matches N] [--score N] [--seed N] [--max-ticks N]\n"
+                 "                     [--p1 idle|track|random|cpu] [--p2 idle|track|random|cpu]\n"
+                 "                     [--cpu easy|normal|hard] [--cpu-reaction TICKS] [--cpu-error PX]\n"
+                 "                     [--script FILE] [--events | --fixed-point] [--verbose]\n"
+                 "                     [--record FILE]\n"
+                 "       pong_headless --replay FILE [--matches N]" << std::endl;
+}
+
+// Re-simulates a recorded match as fast as possible, repeats times over, and
+// checks the result against the state stored at the end of the recording.
+static int RunReplay(const std::string& path, const std::uint64_t repeats)
+{
+    ReplayReader reader;
+    if (!reader.Load(path))
+    {
+        std::cerr << "could not load replay " << path << std::endl;
+        return 1;
+    }
+
+    const ReplayHeader header = reader.GetHeader();
+    const PHYSICS physics = header.GetPhysics();
+
+    PongSimulation simulation(header.maxScore);
+    ReplayStep steps[REPLAY_MAX_STEPS_PER_TICK];
+    std::uint64_t ticks = 0;
+    bool matches = true;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::uint64_t repeat = 0; repeat < repeats; ++repeat)
+    {
+        reader.Rewind();
+        simulation.Reset();
+
+        std::size_t count;
+        while (reader.NextTick(steps, count))
+        {
+            for (std::size_t i = 0; i < count; ++i)
+                simulation.Step(physics, steps[i].milliseconds, steps[i].input);
+            ++ticks;
+        }
+        matches = matches && reader.Verify(simulation);
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "replay: " << static_cast<int>(simulation.GetPlayerOneScore()) << "-"
+        << static_cast<int>(simulation.GetPlayerTwoScore())
+        << (matches ? "  final state matches recording" : "  DESYNC: final state differs from recording") << "\n"
+        << "ticks: " << ticks
+        << "  seconds: " << elapsed.count()
+        << "  ticks/s: " << (elapsed.count() > 0 ? ticks / elapsed.count() : 0.0) << std::endl;
+
+    return matches ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    std::uint64_t matches = 1000;
+    std::uint64_t maxTicks = 1000000;
+    std::uint32_t seed = 1;
+    int scoreToWin = 3;
+    POLICY playerOnePolicy = POLICY::TRACK;
+    POLICY playerTwoPolicy = POLICY::TRACK;
+    CpuSettings cpuSettings;
+    std::string scriptPath;
+    std::string recordPath;
+    std::string replayPath;
+    bool matchesGiven = false;
+    bool verbose = false;
+    bool events = false;
+    bool fixedPoint = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--matches") == 0 && hasValue)
+        {
+            matches = std::strtoull(argv[++i], nullptr, 10);
+            matchesGiven = true;
+        }
+        else if (std::strcmp(argv[i], "--score") == 0 && hasValue)
+            scoreToWin = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--max-ticks") == 0 && hasValue)
+            maxTicks = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--p1") == 0 && hasValue && ParsePolicy(argv[i + 1], playerOnePolicy))
+            ++i;
+        else if (std::strcmp(argv[i], "--p2") == 0 && hasValue && ParsePolicy(argv[i + 1], playerTwoPolicy))
+            ++i;
+        else if (std::strcmp(argv[i], "--cpu") == 0 && hasValue && ParseDifficulty(argv[i + 1], cpuSettings))
+            ++i;
+        else if (std::strcmp(argv[i], "--cpu-reaction") == 0 && hasValue)
+            cpuSettings.reactionTicks = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--cpu-error") == 0 && hasValue)
+            cpuSettings.errorPixels = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--script") == 0 && hasValue)
+            scriptPath = argv[++i];
+        else if (std::strcmp(argv[i], "--record") == 0 && hasValue)
+            recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && hasValue)
+            replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--verbose") == 0)
+            verbose = true;
+        else if (std::strcmp(argv[i], "--events") == 0)
+            events = true;
+        else if (std::strcmp(argv[i], "--fixed-point") == 0)
+            fixedPoint = true;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (!replayPath.empty())
+        return RunReplay(replayPath, matchesGiven ? matches : 1);
+
+    if (!recordPath.empty() && events)
+    {
+        std::cerr << "--record needs fixed ticks and can't be combined with --events" << std::endl;
+        return 1;
+    }
+
+    if (fixedPoint && events)
+    {
+        std::cerr << "--events steps float physics and can't be combined with --fixed-point" << std::endl;
+        return 1;
+    }
+    const PHYSICS physics = fixedPoint ? PHYSICS::FIXED_POINT : PHYSICS::TICK;
+
+    if (scoreToWin < 1 || scoreToWin > 255)
+    {
+        std::cerr << "score to win must be between 1 and 255" << std::endl;
+        return 1;
+    }
+
+    if (!(cpuSettings.errorPixels >= 0))
+    {
+        std::cerr << "--cpu-error must be 0 or more pixels" << std::endl;
+        return 1;
+    }
+
+    InputScript script;
+    if (!scriptPath.empty() && !script.Load(scriptPath))
+    {
+        std::cerr << "could not load input script " << scriptPath << std::endl;
+        return 1;
+    }
+
+    std::uint64_t playerOneWins = 0;
+    std::uint64_t playerTwoWins = 0;
+    std::uint64_t unfinished = 0;
+    std::uint64_t totalTicks = 0;
+    double simulatedMilliseconds = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // --record keeps the first match
+    ReplayRecorder recorder;
+    ReplayHeader header;
+    header.maxScore = static_cast<std::uint8_t>(scoreToWin);
+    header.seed = seed;
+    header.SetPhysics(physics);
+    recorder.Begin(header);
+
+    PongSimulation simulation(static_cast<std::uint_fast8_t>(scoreToWin));
+    for (std::uint64_t match = 0; match < matches; ++match)
+    {
+        simulation.Reset();
+        PaddleController playerOne(playerOnePolicy, true, seed + static_cast<std::uint32_t>(match) * 2, cpuSettings);
+        PaddleController playerTwo(playerTwoPolicy, false, seed + static_cast<std::uint32_t>(match) * 2 + 1, cpuSettings);
+
+        std::uint64_t tick = 0;
+        GAME_STATE gameState = GAME_STATE::IN_GAME;
+        while (gameState == GAME_STATE::IN_GAME && tick < maxTicks)
+        {
+            PongInput input;
+            if (!scriptPath.empty())
+                input = script.Get(tick);
+            else
+            {
+                const PaddleCommand commandOne = playerOne.Decide(simulation);
+                const PaddleCommand commandTwo = playerTwo.Decide(simulation);
+                input = PaddleController::Combine(simulation, commandOne, commandTwo);
+            }
+
+            if (events)
+            {
+                // with the paddles still, jump straight to the next collision
+                const bool moving = input.playerOneUp || input.playerOneDown || input.playerTwoUp || input.playerTwoDown;
+                float step = moving ? UPDATE_MS : EVENT_HORIZON_MS;
+                gameState = simulation.Advance(step, input);
+                simulatedMilliseconds += step;
+            }
+            else
+            {
+                gameState = simulation.Step(physics, UPDATE_MS, input);
+                simulatedMilliseconds += UPDATE_MS;
+
+                if (match == 0 && !recordPath.empty())
+                {
+                    recorder.BeginTick();
+                    recorder.RecordStep(UPDATE_MS, input);
+                    recorder.EndTick();
+                }
+            }
+            ++tick;
+        }
+
+        totalTicks += tick;
+
+        if (match == 0 && !recordPath.empty())
+        {
+            if (!recorder.Save(recordPath, simulation))
+                std::cerr << "could not write replay " << recordPath << std::endl;
+            else if (verbose)
+                std::cout << "recorded match 0 to " << recordPath << std::endl;
+        }
+        if (gameState == GAME_STATE::IN_GAME)
+            ++unfinished;
+        else if (simulation.GetPlayerOneScore() >= simulation.GetMaxScore())
+            ++playerOneWins;
+        else
+            ++playerTwoWins;
+
+        if (verbose)
+            std::cout << "match " << match << ": "
+                << static_cast<int>(simulation.GetPlayerOneScore()) << "-"
+                << static_cast<int>(simulation.GetPlayerTwoScore())
+                << " in " << tick << (events ? " steps" : " ticks") << std::endl;
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "matches: " << matches
+        << "  p1 wins: " << playerOneWins
+        << "  p2 wins: " << playerTwoWins
+        << "  unfinished: " << unfinished << "\n"
+        << (events ? "steps: " : "ticks: ") << totalTicks
+        << "  game seconds: " << simulatedMilliseconds / 1000
+        << "  seconds: " << elapsed.count()
+        << (events ? "  steps/s: " : "  ticks/s: ") << (elapsed.count() > 0 ? totalTicks / elapsed.count() : 0.0) << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <SFML/Window.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "pong_core.h"
+
+enum class MOUSE_STATE : std::uint_fast8_t
+{
+    UP,
+    DOWN
+};
+
+// control state from the moment it took effect
+struct TimedInput
+{
+    std::chrono::steady_clock::time_point time;
+    PongInput input;
+};
+
+struct LatencyStats
+{
+    std::uint64_t samples = 0;
+    double lastMilliseconds = 0;
+    double meanMilliseconds = 0;
+    double maxMilliseconds = 0;
+
+    void Record(const double milliseconds)
+    {
+        lastMilliseconds = milliseconds;
+        meanMilliseconds += (milliseconds - meanMilliseconds) / ++samples;
+        if (milliseconds > maxMilliseconds)
+            maxMilliseconds = milliseconds;
+    }
+};
+
+// Turns window events into a queue of timestamped control changes so the
+// game can apply each press at the point inside a tick where it happened,
+// and taps shorter than a tick still move the paddle. Keyboard and the first
+// two joysticks drive the paddles; mouse events drive the menu.
+class InputQueue
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    InputQueue()
+        :
+        m_first(0),
+        m_count(0),
+        m_mouseDown(false),
+        m_mousePressed(false),
+        m_mousePosition({ 0,0 }),
+        m_hasUnreported(false)
+    {
+        m_keys.fill(false);
+        m_joystickUp.fill(false);
+        m_joystickDown.fill(false);
+        m_joystickButtons.fill(0);
+    }
+
+    void HandleEvent(const sf::Event& event, const Clock::time_point time)
+    {
+        switch (event.type)
+        {
+        case sf::Event::KeyPressed:
+        case sf::Event::KeyReleased:
+        {
+            const int key = KeyIndex(event.key.code);
+            if (key < 0)
+                return;
+            m_keys[key] = event.type == sf::Event::KeyPressed;
+            break;
+        }
+        case sf::Event::JoystickMoved:
+        {
+            const unsigned player = event.joystickMove.joystickId;
+            if (player >= PLAYER_COUNT ||
+                (event.joystickMove.axis != sf::Joystick::Y && event.joystickMove.axis != sf::Joystick::PovY))
+                return;
+            m_joystickUp[player] = event.joystickMove.position < -JOYSTICK_DEAD_ZONE;
+            m_joystickDown[player] = event.joystickMove.position > JOYSTICK_DEAD_ZONE;
+            break;
+        }
+        case sf::Event::JoystickButtonPressed:
+        case sf::Event::JoystickButtonReleased:
+        {
+            const unsigned player = event.joystickButton.joystickId;
+            if (player >= PLAYER_COUNT || event.joystickButton.button >= 32)
+                return;
+            const std::uint32_t bit = 1u << event.joystickButton.button;
+            if (event.type == sf::Event::JoystickButtonPressed)
+                m_joystickButtons[player] |= bit;
+            else
+                m_joystickButtons[player] &= ~bit;
+            break;
+        }
+        case sf::Event::JoystickDisconnected:
+        {
+            const unsigned player = event.joystickConnect.joystickId;
+            if (player >= PLAYER_COUNT)
+                return;
+            m_joystickUp[player] = false;
+            m_joystickDown[player] = false;
+            m_joystickButtons[player] = 0;
+            break;
+        }
+        case sf::Event::LostFocus:
+            // key releases are not delivered while unfocused
+            m_keys.fill(false);
+            break;
+        case sf::Event::MouseButtonPressed:
+            m_mouseDown = true;
+            m_mousePressed = true;
+            m_mousePosition = { static_cast<float>(event.mouseButton.x),static_cast<float>(event.mouseButton.y) };
+            return;
+        case sf::Event::MouseButtonReleased:
+            m_mouseDown = false;
+            m_mousePosition = { static_cast<float>(event.mouseButton.x),static_cast<float>(event.mouseButton.y) };
+            return;
+        case sf::Event::MouseMoved:
+            m_mousePosition = { static_cast<float>(event.mouseMove.x),static_cast<float>(event.mouseMove.y) };
+            return;
+        default:
+            return;
+        }
+
+        Push({ time,CurrentInput() });
+    }
+
+    // Takes the oldest control change that happened before until. The game
+    // applies it from that time on; the change also counts toward latency.
+    bool Pop(const Clock::time_point until, TimedInput& change)
+    {
+        if (m_count == 0 || m_queue[m_first].time >= until)
+            return false;
+
+        change = m_queue[m_first];
+        m_first = (m_first + 1) % QUEUE_SIZE;
+        --m_count;
+        m_applied = change.input;
+
+        if (!m_hasUnreported || change.time < m_oldestUnreported)
+            m_oldestUnreported = change.time;
+        m_hasUnreported = true;
+        return true;
+    }
+
+    // applies everything queued without counting it toward latency, e.g.
+    // for keys pressed on the menu before a match starts
+    void Flush()
+    {
+        while (m_count > 0)
+        {
+            m_applied = m_queue[m_first].input;
+            m_first = (m_first + 1) % QUEUE_SIZE;
+            --m_count;
+        }
+    }
+
+    // controls as of the last change popped
+    const PongInput& GetApplied() const
+    {
+        return m_applied;
+    }
+
+    // DOWN if a button is held or was clicked since the last call, so short
+    // clicks between menu updates are not lost
+    MOUSE_STATE TakeMouseState()
+    {
+        const bool down = m_mouseDown || m_mousePressed;
+        m_mousePressed = false;
+        return down ? MOUSE_STATE::DOWN : MOUSE_STATE::UP;
+    }
+
+    const Vector2D& GetMousePosition() const
+    {
+        return m_mousePosition;
+    }
+
+    // call right after the frame is presented: records how long ago the
+    // oldest input applied since the last frame happened
+    void RecordDisplayed(const Clock::time_point displayTime)
+    {
+        Clock::time_point oldest;
+        if (TakeUnreported(oldest))
+            m_latency.Record(std::chrono::duration<double, std::milli>(displayTime - oldest).count());
+    }
+
+    // when the oldest input applied since the last call happened, for
+    // callers that present frames somewhere else than where inputs are popped
+    bool TakeUnreported(Clock::time_point& oldest)
+    {
+        if (!m_hasUnreported)
+            return false;
+        m_hasUnreported = false;
+        oldest = m_oldestUnreported;
+        return true;
+    }
+
+    const LatencyStats& GetLatency() const
+    {
+        return m_latency;
+    }
+
+private:
+    static const std::size_t QUEUE_SIZE = 64;
+    static const unsigned PLAYER_COUNT = 2;
+    static constexpr float JOYSTICK_DEAD_ZONE = 50;
+
+    enum KEY
+    {
+        KEY_PLAYER_ONE_UP,
+        KEY_PLAYER_ONE_DOWN,
+        KEY_PLAYER_TWO_UP,
+        KEY_PLAYER_TWO_DOWN,
+        KEY_SERVE,
+        KEY_COUNT
+    };
+
+    static int KeyIndex(const sf::Keyboard::Key key)
+    {
+        switch (key)
+        {
+        case sf::Keyboard::Q: return KEY_PLAYER_ONE_UP;
+        case sf::Keyboard::Z: return KEY_PLAYER_ONE_DOWN;
+        case sf::Keyboard::P: return KEY_PLAYER_TWO_UP;
+        case sf::Keyboard::Period: return KEY_PLAYER_TWO_DOWN;
+        case sf::Keyboard::Space: return KEY_SERVE;
+        default: return -1;
+        }
+    }
+
+    PongInput CurrentInput() const
+    {
+        PongInput input;
+        input.playerOneUp = m_keys[KEY_PLAYER_ONE_UP] || m_joystickUp[0];
+        input.playerOneDown = m_keys[KEY_PLAYER_ONE_DOWN] || m_joystickDown[0];
+        input.playerTwoUp = m_keys[KEY_PLAYER_TWO_UP] || m_joystickUp[1];
+        input.playerTwoDown = m_keys[KEY_PLAYER_TWO_DOWN] || m_joystickDown[1];
+        input.serve = m_keys[KEY_SERVE] || m_joystickButtons[0] != 0 || m_joystickButtons[1] != 0;
+        return input;
+    }
+
+    void Push(const TimedInput& change)
+    {
+        const PongInput& latest = m_count > 0 ? m_queue[(m_first + m_count - 1) % QUEUE_SIZE].input : m_applied;
+        if (change.input.ToBits() == latest.ToBits())
+            return;
+
+        // a full queue folds its oldest change into the applied state
+        if (m_count == QUEUE_SIZE)
+        {
+            m_applied = m_queue[m_first].input;
+            m_first = (m_first + 1) % QUEUE_SIZE;
+            --m_count;
+        }
+
+        m_queue[(m_first + m_count) % QUEUE_SIZE] = change;
+        ++m_count;
+    }
+
+    std::array<TimedInput, QUEUE_SIZE> m_queue;
+    std::size_t m_first;
+    std::size_t m_count;
+    PongInput m_applied;
+
+    std::array<bool, KEY_COUNT> m_keys;
+    std::array<bool, PLAYER_COUNT> m_joystickUp;
+    std::array<bool, PLAYER_COUNT> m_joystickDown;
+    std::array<std::uint32_t, PLAYER_COUNT> m_joystickButtons;
+
+    bool m_mouseDown;
+    bool m_mousePressed;
+    Vector2D m_mousePosition;
+
+    bool m_hasUnreported;
+    Clock::time_point m_oldestUnreported;
+    LatencyStats m_latency;
+};
@@ -0,0 +1,220 @@
+#include <SFML/Network.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "match_server.h"
+#include "pong_core.h"
+#include "rollback.h"
+
+// Load generator for pong_server: runs thousands of bot players that join,
+// chase the ball and rejoin when their match ends, spread over a few
+// sockets with a client id per bot, and reports how well the server keeps up.
+
+typedef std::chrono::steady_clock Clock;
+
+const std::size_t BOTS_PER_SOCKET = 4096;
+const Clock::duration JOIN_RETRY = std::chrono::seconds(1);
+
+struct Bot
+{
+    std::uint16_t id = 0;
+    std::size_t socket = 0;
+    bool playing = false;
+    Clock::time_point lastJoin;
+    std::uint32_t match = 0;
+    std::uint8_t player = 0;
+
+    std::uint32_t lastTick = 0;
+    float ballY = WINDOW_HEIGHT / 2;
+    float paddleY = WINDOW_HEIGHT / 2;
+    std::uint8_t playState = 0;
+
+    // follow the ball with the paddle center and serve straight away
+    std::uint8_t Decide() const
+    {
+        const float center = paddleY + PADDLE_LENGTH / 2;
+        std::uint8_t bits = 0;
+        if (ballY < center - PADDLE_LENGTH / 4)
+            bits |= RollbackSession::UP;
+        else if (ballY > center + PADDLE_LENGTH / 4)
+            bits |= RollbackSession::DOWN;
+        if (playState == static_cast<std::uint8_t>(player == 0 ? PLAY_STATE::SERVE_PLAYER_ONE : PLAY_STATE::SERVE_PLAYER_TWO))
+            bits |= RollbackSession::SERVE;
+        return bits;
+    }
+};
+
+struct LoadStats
+{
+    std::uint64_t states = 0;
+    std::uint64_t lostStates = 0;
+    std::uint64_t matches = 0;
+    std::uint64_t joins = 0;
+};
+
+int main(int argc, char** argv)
+{
+    std::string server = "127.0.0.1:7777";
+    std::size_t botCount = 2000;
+    double seconds = 30;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--server") == 0 && hasValue)
+            server = argv[++i];
+        else if (std::strcmp(argv[i], "--bots") == 0 && hasValue)
+            botCount = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--seconds") == 0 && hasValue)
+            seconds = std::strtod(argv[++i], nullptr);
+        else
+        {
+            std::cerr << "usage: pong_loadgen [--server HOST:PORT] [--bots N] [--seconds S]" << std::endl;
+            return 1;
+        }
+    }
+
+    const std::size_t colon = server.rfind(':');
+    if (colon == std::string::npos)
+    {
+        std::cerr << "--server needs HOST:PORT" << std::endl;
+        return 1;
+    }
+    const sf::IpAddress serverAddress(server.substr(0, colon));
+    const unsigned short serverPort = static_cast<unsigned short>(std::atoi(server.c_str() + colon + 1));
+
+    std::vector<std::unique_ptr<sf::UdpSocket>> sockets((botCount + BOTS_PER_SOCKET - 1) / BOTS_PER_SOCKET);
+    for (std::unique_ptr<sf::UdpSocket>& socket : sockets)
+    {
+        socket.reset(new sf::UdpSocket());
+        if (socket->bind(sf::Socket::AnyPort) != sf::Socket::Done)
+        {
+            std::cerr << "could not bind a UDP socket" << std::endl;
+            return 1;
+        }
+        socket->setBlocking(false);
+    }
+
+    std::vector<Bot> bots(botCount);
+    for (std::size_t i = 0; i < botCount; ++i)
+    {
+        bots[i].id = static_cast<std::uint16_t>(i % BOTS_PER_SOCKET);
+        bots[i].socket = i / BOTS_PER_SOCKET;
+    }
+
+    // seat (match * 2 + player) to bot, to route state packets
+    std::unordered_map<std::uint64_t, std::size_t> seats;
+    LoadStats stats;
+
+    const Clock::duration tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(UPDATE_MS));
+    const Clock::time_point start = Clock::now();
+    Clock::time_point nextInput = start;
+    std::uint8_t buffer[64];
+
+    while (Clock::now() - start < std::chrono::duration<double>(seconds))
+    {
+        for (std::size_t s = 0; s < sockets.size(); ++s)
+        {
+            std::size_t received;
+            sf::IpAddress sender;
+            unsigned short senderPort;
+            while (sockets[s]->receive(buffer, sizeof(buffer), received, sender, senderPort) == sf::Socket::Done)
+            {
+                using namespace ServerProtocol;
+                if (received >= WELCOME_SIZE && buffer[0] == 'P' && buffer[1] == 'W')
+                {
+                    const std::size_t index = s * BOTS_PER_SOCKET + GetU16(buffer + 2);
+                    if (index >= bots.size() || bots[index].playing)
+                        continue;
+                    Bot& bot = bots[index];
+                    bot.playing = true;
+                    bot.match = GetU32(buffer + 4);
+                    bot.player = buffer[8];
+                    bot.lastTick = 0;
+                    seats[static_cast<std::uint64_t>(bot.match) * 2 + bot.player] = index;
+                }
+                else if (received >= STATE_SIZE && buffer[0] == 'P' && buffer[1] == 'S')
+                {
+                    const std::uint64_t seat = static_cast<std::uint64_t>(GetU32(buffer + 2)) * 2 + buffer[PLAYER_OFFSET];
+                    const std::unordered_map<std::uint64_t, std::size_t>::const_iterator found = seats.find(seat);
+                    if (found == seats.end())
+                        continue;
+                    Bot& bot = bots[found->second];
+
+                    const std::uint32_t stateTick = GetU32(buffer + 8);
+                    if (stateTick <= bot.lastTick)
+                        continue;
+                    ++stats.states;
+                    if (bot.lastTick > 0)
+                        stats.lostStates += stateTick - bot.lastTick - 1;
+                    bot.lastTick = stateTick;
+                    bot.ballY = GetF32(buffer + 16);
+                    bot.paddleY = GetF32(buffer + (bot.player == 0 ? 20 : 24));
+                    bot.playState = buffer[30];
+
+                    if ((buffer[7] & FINISHED) != 0)
+                    {
+                        ++stats.matches;
+                        bot.playing = false;
+                        bot.lastJoin = Clock::time_point();
+                        seats.erase(found);
+                    }
+                }
+            }
+        }
+
+        const Clock::time_point now = Clock::now();
+        if (now >= nextInput)
+        {
+            nextInput += tick;
+            for (Bot& bot : bots)
+            {
+                using namespace ServerProtocol;
+                std::uint8_t packet[INPUT_SIZE];
+                if (bot.playing)
+                {
+                    packet[0] = 'P';
+                    packet[1] = 'I';
+                    PutU16(packet + 2, bot.id);
+                    PutU32(packet + 4, bot.match);
+                    packet[8] = bot.player;
+                    packet[9] = bot.Decide();
+                    sockets[bot.socket]->send(packet, INPUT_SIZE, serverAddress, serverPort);
+                }
+                else if (now - bot.lastJoin >= JOIN_RETRY)
+                {
+                    packet[0] = 'P';
+                    packet[1] = 'J';
+                    PutU16(packet + 2, bot.id);
+                    sockets[bot.socket]->send(packet, JOIN_SIZE, serverAddress, serverPort);
+                    bot.lastJoin = now;
+                    ++stats.joins;
+                }
+            }
+        }
+        else
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+
+    std::size_t playing = 0;
+    for (const Bot& bot : bots)
+        playing += bot.playing ? 1 : 0;
+
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    const double expected = static_cast<double>(stats.states + stats.lostStates);
+    std::cout << "bots: " << botCount << "  playing: " << playing
+        << "  matches finished: " << stats.matches
+        << "  join requests: " << stats.joins << "\n"
+        << "states/s: " << stats.states / elapsed
+        << "  lost states: " << (expected > 0 ? 100 * stats.lostStates / expected : 0.0) << "%" << std::endl;
+    return 0;
+}
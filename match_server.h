@@ -0,0 +1,320 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "pong_core.h"
+#include "rollback.h"
+#include "thread_pool.h"
+
+// Wire format between pong_server and its clients, little-endian. A client
+// is its address and port plus a 16-bit id, so one socket can carry many
+// players (the load generator runs thousands of bots on one).
+//
+//   join     'P','J', client id (u16)
+//   input    'P','I', client id (u16), match (u32), player (u8), bits (u8)
+//            bits are RollbackSession::BIT for the sender's own paddle
+//   welcome  'P','W', client id (u16), match (u32), player (u8)
+//   state    'P','S', match (u32), player (u8), flags (u8), tick (u32),
+//            ball x, ball y, paddle one y, paddle two y (f32),
+//            score one, score two, play state (u8)
+namespace ServerProtocol
+{
+    const std::size_t JOIN_SIZE = 4;
+    const std::size_t INPUT_SIZE = 10;
+    const std::size_t WELCOME_SIZE = 9;
+    const std::size_t STATE_SIZE = 31;
+    const std::size_t PLAYER_OFFSET = 6;
+
+    enum STATE_FLAG : std::uint8_t
+    {
+        FINISHED = 1 << 0
+    };
+
+    inline void PutU16(std::uint8_t* buffer, const std::uint16_t value)
+    {
+        buffer[0] = static_cast<std::uint8_t>(value);
+        buffer[1] = static_cast<std::uint8_t>(value >> 8);
+    }
+
+    inline void PutU32(std::uint8_t* buffer, const std::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            buffer[i] = static_cast<std::uint8_t>(value >> (i * 8));
+    }
+
+    inline void PutF32(std::uint8_t* buffer, const float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        PutU32(buffer, bits);
+    }
+
+    inline std::uint16_t GetU16(const std::uint8_t* data)
+    {
+        return static_cast<std::uint16_t>(data[0] | data[1] << 8);
+    }
+
+    inline std::uint32_t GetU32(const std::uint8_t* data)
+    {
+        return data[0] | data[1] << 8 | data[2] << 16 | static_cast<std::uint32_t>(data[3]) << 24;
+    }
+
+    inline float GetF32(const std::uint8_t* data)
+    {
+        const std::uint32_t bits = GetU32(data);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+struct ServerStats
+{
+    std::uint64_t liveMatches = 0;
+    std::uint64_t waitingPlayers = 0;
+    std::uint64_t finishedMatches = 0;
+    std::uint64_t abandonedMatches = 0;
+    std::uint64_t rejectedPackets = 0;
+};
+
+// Hosts any number of matches without a window or a socket: the caller
+// feeds it datagrams, calls Tick once per UPDATE_MS and sends what it
+// hands back. Tick steps every live match on the thread pool.
+class MatchServer
+{
+public:
+    // a client that sends nothing for this many ticks forfeits its match
+    static const std::uint32_t TIMEOUT_TICKS = 150;
+
+    MatchServer(ThreadPool& pool, const std::uint_fast8_t scoreToWin)
+        :
+        m_pool(pool),
+        m_scoreToWin(scoreToWin),
+        m_waiting(NO_MATCH),
+        m_tick(0)
+    {
+    }
+
+    // Handles one datagram from client address/port. Returns the size of a
+    // reply to send straight back, written to reply, or 0.
+    std::size_t HandlePacket(const std::uint8_t* data, const std::size_t size, const std::uint32_t address, const std::uint16_t port, std::uint8_t* reply)
+    {
+        using namespace ServerProtocol;
+
+        if (size >= JOIN_SIZE && data[0] == 'P' && data[1] == 'J')
+            return Join(ClientKey(address, port, GetU16(data + 2)), GetU16(data + 2), reply);
+
+        if (size >= INPUT_SIZE && data[0] == 'P' && data[1] == 'I')
+        {
+            const std::uint64_t client = ClientKey(address, port, GetU16(data + 2));
+            const std::uint32_t match = GetU32(data + 4);
+            const std::uint8_t player = data[8];
+            if (match < m_matches.size() && player < 2 && m_matches[match].live && m_matches[match].clients[player] == client)
+            {
+                m_matches[match].inputs[player] = data[9];
+                m_matches[match].lastHeard[player] = m_tick;
+                return 0;
+            }
+        }
+
+        ++m_stats.rejectedPackets;
+        return 0;
+    }
+
+    // steps every live match one tick and prepares its state packet
+    void Tick()
+    {
+        ++m_tick;
+        m_pool.ParallelFor(m_matches.size(), MATCHES_PER_TASK, m_stepRange);
+        m_stats.liveMatches = 0;
+        for (std::size_t i = 0; i < m_matches.size(); ++i)
+        {
+            HostedMatch& match = m_matches[i];
+            if (match.live)
+                ++m_stats.liveMatches;
+            if (!match.ended)
+                continue;
+            if (match.abandoned)
+                ++m_stats.abandonedMatches;
+            else
+                ++m_stats.finishedMatches;
+            Close(static_cast<std::uint32_t>(i));
+        }
+    }
+
+    // calls send(address, port, data, size) for every state packet of the tick
+    template <class Send>
+    void ForEachOutgoing(Send send)
+    {
+        for (HostedMatch& match : m_matches)
+        {
+            if (!match.sendState)
+                continue;
+            match.sendState = false;
+            for (std::uint8_t player = 0; player < 2; ++player)
+            {
+                match.packet[ServerProtocol::PLAYER_OFFSET] = player;
+                send(static_cast<std::uint32_t>(match.clients[player] >> 32),
+                    static_cast<std::uint16_t>(match.clients[player] >> 16),
+                    match.packet,
+                    ServerProtocol::STATE_SIZE);
+            }
+        }
+    }
+
+    std::uint32_t GetTick() const
+    {
+        return m_tick;
+    }
+
+    const ServerStats& GetStats() const
+    {
+        return m_stats;
+    }
+
+private:
+    static const std::uint32_t NO_MATCH = 0xffffffff;
+    static const std::size_t MATCHES_PER_TASK = 64;
+
+    struct HostedMatch
+    {
+        HostedMatch(const std::uint_fast8_t scoreToWin)
+            :
+            simulation(scoreToWin)
+        {
+        }
+
+        PongSimulation simulation;
+        std::uint64_t clients[2] = {};
+        std::uint8_t inputs[2] = {};
+        std::uint32_t lastHeard[2] = {};
+        std::uint32_t tick = 0;
+        bool live = false;
+        bool ended = false;
+        bool abandoned = false;
+        bool sendState = false;
+        std::uint8_t packet[ServerProtocol::STATE_SIZE] = {};
+    };
+
+    struct StepRange
+    {
+        MatchServer& server;
+
+        void operator()(const std::size_t begin, const std::size_t end) const
+        {
+            for (std::size_t i = begin; i < end; ++i)
+                server.Step(server.m_matches[i]);
+        }
+    };
+
+    static std::uint64_t ClientKey(const std::uint32_t address, const std::uint16_t port, const std::uint16_t id)
+    {
+        return static_cast<std::uint64_t>(address) << 32 | static_cast<std::uint64_t>(port) << 16 | id;
+    }
+
+    std::size_t Join(const std::uint64_t client, const std::uint16_t clientId, std::uint8_t* reply)
+    {
+        // a repeated join, e.g. after a lost welcome, gets the same answer
+        std::unordered_map<std::uint64_t, std::uint32_t>::const_iterator found = m_clients.find(client);
+        std::uint32_t seat;
+        if (found != m_clients.end())
+            seat = found->second;
+        else if (m_waiting != NO_MATCH)
+        {
+            seat = m_waiting * 2 + 1;
+            HostedMatch& match = m_matches[m_waiting];
+            match.clients[1] = client;
+            match.lastHeard[0] = m_tick;
+            match.lastHeard[1] = m_tick;
+            match.live = true;
+            m_waiting = NO_MATCH;
+            m_clients[client] = seat;
+            m_stats.waitingPlayers = 0;
+        }
+        else
+        {
+            const std::uint32_t index = Allocate();
+            HostedMatch& match = m_matches[index];
+            match.clients[0] = client;
+            m_waiting = index;
+            seat = index * 2;
+            m_clients[client] = seat;
+            m_stats.waitingPlayers = 1;
+        }
+
+        reply[0] = 'P';
+        reply[1] = 'W';
+        ServerProtocol::PutU16(reply + 2, clientId);
+        ServerProtocol::PutU32(reply + 4, seat / 2);
+        reply[8] = static_cast<std::uint8_t>(seat % 2);
+        return ServerProtocol::WELCOME_SIZE;
+    }
+
+    std::uint32_t Allocate()
+    {
+        if (!m_free.empty())
+        {
+            const std::uint32_t index = m_free.back();
+            m_free.pop_back();
+            m_matches[index] = HostedMatch(m_scoreToWin);
+            return index;
+        }
+        m_matches.emplace_back(m_scoreToWin);
+        return static_cast<std::uint32_t>(m_matches.size() - 1);
+    }
+
+    void Close(const std::uint32_t index)
+    {
+        HostedMatch& match = m_matches[index];
+        m_clients.erase(match.clients[0]);
+        m_clients.erase(match.clients[1]);
+        match.live = false;
+        match.ended = false;
+        m_free.push_back(index);
+    }
+
+    // runs on a pool thread; touches nothing but its own match
+    void Step(HostedMatch& match)
+    {
+        if (!match.live)
+            return;
+
+        const bool timedOut = m_tick - match.lastHeard[0] > TIMEOUT_TICKS || m_tick - match.lastHeard[1] > TIMEOUT_TICKS;
+        const PongInput input = RollbackSession::CombineInputs(match.simulation, match.inputs[0], match.inputs[1]);
+        const bool finished = timedOut || match.simulation.Update(UPDATE_MS, input) != GAME_STATE::IN_GAME;
+        ++match.tick;
+
+        using namespace ServerProtocol;
+        const Ball& ball = match.simulation.GetBall();
+        std::uint8_t* packet = match.packet;
+        packet[0] = 'P';
+        packet[1] = 'S';
+        PutU32(packet + 2, static_cast<std::uint32_t>(&match - m_matches.data()));
+        packet[7] = finished ? FINISHED : 0;
+        PutU32(packet + 8, match.tick);
+        PutF32(packet + 12, ball.GetPosition().x);
+        PutF32(packet + 16, ball.GetPosition().y);
+        PutF32(packet + 20, match.simulation.GetPlayerOne().GetPositionSize().y);
+        PutF32(packet + 24, match.simulation.GetPlayerTwo().GetPositionSize().y);
+        packet[28] = static_cast<std::uint8_t>(match.simulation.GetPlayerOneScore());
+        packet[29] = static_cast<std::uint8_t>(match.simulation.GetPlayerTwoScore());
+        packet[30] = static_cast<std::uint8_t>(match.simulation.GetPlayState());
+
+        match.sendState = true;
+        match.ended = finished;
+        match.abandoned = timedOut;
+    }
+
+    ThreadPool& m_pool;
+    std::uint_fast8_t m_scoreToWin;
+    std::vector<HostedMatch> m_matches;
+    std::vector<std::uint32_t> m_free;
+    std::unordered_map<std::uint64_t, std::uint32_t> m_clients;
+    std::uint32_t m_waiting;
+    std::uint32_t m_tick;
+    StepRange m_stepRange{ *this };
+    ServerStats m_stats;
+};
@@ -0,0 +1,405 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "pong_core.h"
+#include "thread_pool.h"
+
+// Party and stress mode: a pool of balls bouncing off each other, the walls
+// and both paddles, with a goal for every ball that gets past a paddle.
+//
+// The broadphase is a uniform grid over the court with cells one ball wide,
+// rebuilt every step with a counting sort. The balls themselves are stored in
+// grid order, so a ball only tests the 3x3 cells around it and those balls
+// sit next to it in memory. A ball's new state is computed from the old
+// state of its neighbours alone, so the narrowphase runs on a ThreadPool
+// without locks and gives the same result for any number of threads.
+class MultiBallSimulation
+{
+public:
+    static const std::size_t BALLS_PER_TASK = 4096;
+    // the grid has a cell per ball width, so smaller balls make it huge
+    static constexpr float MIN_RADIUS = 0.5f;
+
+    MultiBallSimulation(const std::size_t count, const float radius, const std::uint32_t seed)
+        :
+        m_court({ COURT_MARGIN,COURT_MARGIN,WINDOW_WIDTH - COURT_MARGIN * 2,WINDOW_HEIGHT - COURT_MARGIN * 2 }),
+        m_playerOne({ COURT_MARGIN + PADDLE_PADDING,WINDOW_HEIGHT / 2 - PADDLE_LENGTH / 2,PADDLE_WIDTH,PADDLE_LENGTH }),
+        m_playerTwo({ WINDOW_WIDTH - COURT_MARGIN - PADDLE_PADDING - PADDLE_WIDTH,WINDOW_HEIGHT / 2 - PADDLE_LENGTH / 2,PADDLE_WIDTH,PADDLE_LENGTH }),
+        m_radius(radius),
+        m_cellSize(radius * 2),
+        m_tick(0),
+        m_playerOneScore(0),
+        m_playerTwoScore(0),
+        m_contacts(0),
+        m_collideRange{ *this }
+    {
+        const RectangleShape& courtShape = m_court.GetDimensions();
+        m_columns = static_cast<std::uint32_t>(std::ceil(courtShape.width / m_cellSize));
+        m_rows = static_cast<std::uint32_t>(std::ceil(courtShape.height / m_cellSize));
+        m_cellStart.resize(static_cast<std::size_t>(m_columns) * m_rows + 1);
+
+        for (std::vector<float>* field : { &m_x,&m_y,&m_velocityX,&m_velocityY,&m_sortedX,&m_sortedY,&m_sortedVelocityX,&m_sortedVelocityY })
+            field->resize(count);
+        m_cell.resize(count);
+
+        // scattered over the court; overlaps push apart over the first steps
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const std::uint32_t a = Hash32(seed, static_cast<std::uint32_t>(i * 2));
+            const std::uint32_t b = Hash32(seed, static_cast<std::uint32_t>(i * 2 + 1));
+            m_x[i] = courtShape.x + radius + (courtShape.width - radius * 2) * (a >> 8) / 16777216.0f;
+            m_y[i] = courtShape.y + radius + (courtShape.height - radius * 2) * (b >> 8) / 16777216.0f;
+            Launch(Hash32(seed ^ 0x9e3779b9u, static_cast<std::uint32_t>(i)), m_velocityX[i], m_velocityY[i]);
+        }
+    }
+
+    // One step for every ball. With a pool the grid lookups and collisions
+    // are split across its threads; without one they run on the caller.
+    void Update(const float elapsedMilliseconds, const PongInput& input, ThreadPool* pool)
+    {
+        const float seconds = elapsedMilliseconds / 1000.0f;
+        MovePaddle(m_playerOne, input.playerOneUp, input.playerOneDown, seconds);
+        MovePaddle(m_playerTwo, input.playerTwoUp, input.playerTwoDown, seconds);
+
+        BuildGrid();
+
+        m_seconds = seconds;
+        m_stepGoalsOne.store(0, std::memory_order_relaxed);
+        m_stepGoalsTwo.store(0, std::memory_order_relaxed);
+        m_stepContacts.store(0, std::memory_order_relaxed);
+        if (pool != nullptr)
+            pool->ParallelFor(m_x.size(), BALLS_PER_TASK, m_collideRange);
+        else
+            m_collideRange(0, m_x.size());
+
+        m_playerOneScore += m_stepGoalsOne.load(std::memory_order_relaxed);
+        m_playerTwoScore += m_stepGoalsTwo.load(std::memory_order_relaxed);
+        // every contact is seen from both balls
+        m_contacts = m_stepContacts.load(std::memory_order_relaxed) / 2;
+        ++m_tick;
+    }
+
+    std::size_t GetCount() const
+    {
+        return m_x.size();
+    }
+
+    float GetRadius() const
+    {
+        return m_radius;
+    }
+
+    const std::vector<float>& GetX() const
+    {
+        return m_x;
+    }
+
+    const std::vector<float>& GetY() const
+    {
+        return m_y;
+    }
+
+    const Court& GetCourt() const
+    {
+        return m_court;
+    }
+
+    const Paddle& GetPlayerOne() const
+    {
+        return m_playerOne;
+    }
+
+    const Paddle& GetPlayerTwo() const
+    {
+        return m_playerTwo;
+    }
+
+    std::uint64_t GetPlayerOneScore() const
+    {
+        return m_playerOneScore;
+    }
+
+    std::uint64_t GetPlayerTwoScore() const
+    {
+        return m_playerTwoScore;
+    }
+
+    // ball-ball contacts resolved in the last step
+    std::uint64_t GetContacts() const
+    {
+        return m_contacts;
+    }
+
+    // FNV-1a over every ball, to check that thread counts agree
+    std::uint64_t Hash() const
+    {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const std::vector<float>* field : { &m_x,&m_y,&m_velocityX,&m_velocityY })
+        {
+            for (const float value : *field)
+            {
+                std::uint32_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                hash ^= bits;
+                hash *= 1099511628211ull;
+            }
+        }
+        return hash;
+    }
+
+private:
+    struct CollideRange
+    {
+        MultiBallSimulation& simulation;
+
+        void operator()(const std::size_t begin, const std::size_t end) const
+        {
+            simulation.Collide(begin, end);
+        }
+    };
+
+    static std::uint32_t Hash32(std::uint32_t seed, std::uint32_t value)
+    {
+        value ^= seed * 0x85ebca6bu;
+        value ^= value >> 16;
+        value *= 0x7feb352du;
+        value ^= value >> 15;
+        value *= 0x846ca68bu;
+        value ^= value >> 16;
+        return value;
+    }
+
+    // serve speed, at most 60 degrees off horizontal, either way
+    static void Launch(const std::uint32_t random, float& velocityX, float& velocityY)
+    {
+        const float angle = ((random & 0xffff) / 65536.0f - 0.5f) * 2.0944f;
+        velocityX = std::cos(angle) * BALL_VELOCITY * ((random & 0x10000) != 0 ? 1 : -1);
+        velocityY = std::sin(angle) * BALL_VELOCITY;
+    }
+
+    static void MovePaddle(Paddle& paddle, const bool up, const bool down, const float seconds)
+    {
+        const RectangleShape& rect = paddle.GetPositionSize();
+        if (up)
+            paddle.SetPosition({ rect.x,rect.y - PADDLE_SPEED * seconds });
+        if (down)
+            paddle.SetPosition({ rect.x,rect.y + PADDLE_SPEED * seconds });
+    }
+
+    std::uint32_t CellOf(const float x, const float y) const
+    {
+        const RectangleShape& courtShape = m_court.GetDimensions();
+        const float column = (x - courtShape.x) / m_cellSize;
+        const float row = (y - courtShape.y) / m_cellSize;
+        const std::uint32_t c = column <= 0 ? 0 : column >= m_columns - 1 ? m_columns - 1 : static_cast<std::uint32_t>(column);
+        const std::uint32_t r = row <= 0 ? 0 : row >= m_rows - 1 ? m_rows - 1 : static_cast<std::uint32_t>(row);
+        return r * m_columns + c;
+    }
+
+    // counting sort of the balls into grid order
+    void BuildGrid()
+    {
+        const std::size_t count = m_x.size();
+        std::fill(m_cellStart.begin(), m_cellStart.end(), 0);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            m_cell[i] = CellOf(m_x[i], m_y[i]);
+            ++m_cellStart[m_cell[i] + 1];
+        }
+        for (std::size_t cell = 1; cell < m_cellStart.size(); ++cell)
+            m_cellStart[cell] += m_cellStart[cell - 1];
+
+        // the balls are still in last step's grid order, so this mostly streams
+        m_fill.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const std::uint32_t slot = m_fill[m_cell[i]]++;
+            m_sortedX[slot] = m_x[i];
+            m_sortedY[slot] = m_y[i];
+            m_sortedVelocityX[slot] = m_velocityX[i];
+            m_sortedVelocityY[slot] = m_velocityY[i];
+        }
+    }
+
+    // Reads the sorted state and writes balls [begin, end) of the next one.
+    // A ball touching others is pushed apart by half of each overlap and
+    // turned by the sum of the elastic impulses it would take from them, then
+    // sped back up to its old speed, so contacts turn balls but never speed
+    // them up. Balls move up to a few radii per tick, so a fast pair can pass
+    // through each other.
+    void Collide(const std::size_t begin, const std::size_t end)
+    {
+        const RectangleShape& courtShape = m_court.GetDimensions();
+        const RectangleShape& paddleOne = m_playerOne.GetPositionSize();
+        const RectangleShape& paddleTwo = m_playerTwo.GetPositionSize();
+        const float diameter = m_radius * 2;
+        const float diameterSquared = diameter * diameter;
+
+        std::uint64_t contacts = 0;
+        std::uint64_t goalsOne = 0;
+        std::uint64_t goalsTwo = 0;
+
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            float x = m_sortedX[i];
+            float y = m_sortedY[i];
+            float velocityX = m_sortedVelocityX[i];
+            float velocityY = m_sortedVelocityY[i];
+            float pushX = 0;
+            float pushY = 0;
+            float impulseX = 0;
+            float impulseY = 0;
+            bool bounced = false;
+
+            const std::uint32_t cell = CellOf(x, y);
+            const std::uint32_t column = cell % m_columns;
+            const std::uint32_t row = cell / m_columns;
+            const std::uint32_t firstRow = row > 0 ? row - 1 : 0;
+            const std::uint32_t lastRow = row + 1 < m_rows ? row + 1 : row;
+            const std::uint32_t firstColumn = column > 0 ? column - 1 : 0;
+            const std::uint32_t lastColumn = column + 1 < m_columns ? column + 1 : column;
+
+            for (std::uint32_t r = firstRow; r <= lastRow; ++r)
+            {
+                // the neighbouring cells of one row are contiguous in grid order
+                const std::uint32_t from = m_cellStart[r * m_columns + firstColumn];
+                const std::uint32_t to = m_cellStart[r * m_columns + lastColumn + 1];
+                for (std::uint32_t j = from; j < to; ++j)
+                {
+                    const float dx = x - m_sortedX[j];
+                    const float dy = y - m_sortedY[j];
+                    const float distanceSquared = dx * dx + dy * dy;
+                    if (distanceSquared >= diameterSquared || j == i)
+                        continue;
+
+                    ++contacts;
+                    // coincident balls split sideways, the lower index to the left
+                    const float distance = std::sqrt(distanceSquared);
+                    const float normalX = distanceSquared > 0 ? dx / distance : i < j ? -1.0f : 1.0f;
+                    const float normalY = distanceSquared > 0 ? dy / distance : 0.0f;
+                    const float overlap = (diameter - distance) / 2;
+                    pushX += normalX * overlap;
+                    pushY += normalY * overlap;
+
+                    const float approach = (velocityX - m_sortedVelocityX[j]) * normalX + (velocityY - m_sortedVelocityY[j]) * normalY;
+                    if (approach < 0)
+                    {
+                        impulseX -= approach * normalX;
+                        impulseY -= approach * normalY;
+                        bounced = true;
+                    }
+                }
+            }
+
+            // Bounces only turn a ball, as in the one-ball game: a ball hit from
+            // several sides at once would otherwise gain energy every tick.
+            if (bounced)
+            {
+                const float speed = std::sqrt(velocityX * velocityX + velocityY * velocityY);
+                const float turnedX = velocityX + impulseX;
+                const float turnedY = velocityY + impulseY;
+                const float turnedSpeed = std::sqrt(turnedX * turnedX + turnedY * turnedY);
+                if (turnedSpeed > 0)
+                {
+                    velocityX = turnedX * speed / turnedSpeed;
+                    velocityY = turnedY * speed / turnedSpeed;
+                }
+                else
+                {
+                    velocityX = -velocityX;
+                    velocityY = -velocityY;
+                }
+            }
+
+            x += pushX + velocityX * m_seconds;
+            y += pushY + velocityY * m_seconds;
+
+            if (y - m_radius < courtShape.y)
+            {
+                y = courtShape.y + m_radius;
+                velocityY = std::fabs(velocityY);
+            }
+            else if (y + m_radius > courtShape.y + courtShape.height)
+            {
+                y = courtShape.y + courtShape.height - m_radius;
+                velocityY = -std::fabs(velocityY);
+            }
+
+            if (x - m_radius <= paddleOne.x + PADDLE_WIDTH && x + m_radius >= paddleOne.x &&
+                y + m_radius >= paddleOne.y && y - m_radius <= paddleOne.y + PADDLE_LENGTH && velocityX < 0)
+            {
+                x = paddleOne.x + PADDLE_WIDTH + m_radius;
+                velocityX = -velocityX;
+            }
+            else if (x + m_radius >= paddleTwo.x && x - m_radius <= paddleTwo.x + PADDLE_WIDTH &&
+                y + m_radius >= paddleTwo.y && y - m_radius <= paddleTwo.y + PADDLE_LENGTH && velocityX > 0)
+            {
+                x = paddleTwo.x - m_radius;
+                velocityX = -velocityX;
+            }
+
+            // a ball out past either end is a goal and comes back from a random
+            // point on the centre line, so goals in one tick don't stack up
+            if (x < courtShape.x || x > courtShape.x + courtShape.width)
+            {
+                if (x < courtShape.x)
+                    ++goalsTwo;
+                else
+                    ++goalsOne;
+                const std::uint32_t random = Hash32(static_cast<std::uint32_t>(m_tick), static_cast<std::uint32_t>(i));
+                x = courtShape.x + courtShape.width / 2;
+                y = courtShape.y + m_radius + (courtShape.height - m_radius * 2) * (random >> 8) / 16777216.0f;
+                Launch(Hash32(random, static_cast<std::uint32_t>(i)), velocityX, velocityY);
+            }
+
+            m_x[i] = x;
+            m_y[i] = y;
+            m_velocityX[i] = velocityX;
+            m_velocityY[i] = velocityY;
+        }
+
+        m_stepContacts.fetch_add(contacts, std::memory_order_relaxed);
+        m_stepGoalsOne.fetch_add(goalsOne, std::memory_order_relaxed);
+        m_stepGoalsTwo.fetch_add(goalsTwo, std::memory_order_relaxed);
+    }
+
+    Court m_court;
+    Paddle m_playerOne;
+    Paddle m_playerTwo;
+    float m_radius;
+    float m_cellSize;
+    std::uint32_t m_columns;
+    std::uint32_t m_rows;
+
+    // one array per field, in the grid order of the last step
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_velocityX;
+    std::vector<float> m_velocityY;
+
+    // the same, sorted into the current grid
+    std::vector<float> m_sortedX;
+    std::vector<float> m_sortedY;
+    std::vector<float> m_sortedVelocityX;
+    std::vector<float> m_sortedVelocityY;
+    std::vector<std::uint32_t> m_cell;
+    // first sorted ball of each cell, plus the total at the end
+    std::vector<std::uint32_t> m_cellStart;
+    std::vector<std::uint32_t> m_fill;
+
+    std::uint64_t m_tick;
+    float m_seconds = 0;
+    std::uint64_t m_playerOneScore;
+    std::uint64_t m_playerTwoScore;
+    std::uint64_t m_contacts;
+    std::atomic<std::uint64_t> m_stepContacts{ 0 };
+    std::atomic<std::uint64_t> m_stepGoalsOne{ 0 };
+    std::atomic<std::uint64_t> m_stepGoalsTwo{ 0 };
+    CollideRange m_collideRange;
+};
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "multiball.h"
+#include "pong_core.h"
+#include "thread_pool.h"
+
+// Steps the same multi-ball field on one thread and then on pools of 1, 2,
+// 4... up to all cores, and checks that every run ends in the same state.
+
+struct RunResult
+{
+    double seconds;
+    std::uint64_t contacts;
+    std::uint64_t goals;
+    std::uint64_t hash;
+};
+
+// paddles sweep up and down so both ends see returns
+static PongInput InputAt(const std::uint64_t tick)
+{
+    PongInput input;
+    const bool up = tick / 120 % 2 == 0;
+    input.playerOneUp = up;
+    input.playerOneDown = !up;
+    input.playerTwoUp = !up;
+    input.playerTwoDown = up;
+    return input;
+}
+
+static RunResult Run(const std::size_t balls, const float radius, const std::uint64_t ticks, ThreadPool* pool)
+{
+    MultiBallSimulation simulation(balls, radius, 1);
+    std::uint64_t contacts = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::uint64_t tick = 0; tick < ticks; ++tick)
+    {
+        simulation.Update(UPDATE_MS, InputAt(tick), pool);
+        contacts += simulation.GetContacts();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return { elapsed.count(),contacts,simulation.GetPlayerOneScore() + simulation.GetPlayerTwoScore(),simulation.Hash() };
+}
+
+static void Report(const char* name, const unsigned threads, const RunResult& result, const std::size_t balls, const std::uint64_t ticks, const double baseline)
+{
+    std::cout << name << threads
+        << "  ms/tick: " << result.seconds * 1000 / ticks
+        << "  ball ticks/s: " << static_cast<double>(balls) * ticks / result.seconds
+        << "  contacts/tick: " << result.contacts / ticks
+        << "  goals: " << result.goals
+        << "  speedup: " << baseline / result.seconds << "x" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t balls = 100000;
+    float radius = 1.5f;
+    std::uint64_t ticks = 200;
+    unsigned maxThreads = std::thread::hardware_concurrency();
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--balls") == 0 && hasValue)
+            balls = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--radius") == 0 && hasValue)
+            radius = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--ticks") == 0 && hasValue)
+            ticks = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+            maxThreads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else
+        {
+            std::cerr << "usage: pong_multiball_bench [--balls N] [--radius R] [--ticks N] [--threads N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (balls == 0 || balls > UINT32_MAX || ticks == 0 || !(radius >= MultiBallSimulation::MIN_RADIUS && radius <= BALL_RADIUS))
+    {
+        std::cerr << "need at least one ball and one tick, and a radius between " << MultiBallSimulation::MIN_RADIUS << " and " << BALL_RADIUS << std::endl;
+        return 1;
+    }
+    if (maxThreads == 0)
+        maxThreads = 1;
+
+    std::cout << balls << " balls of radius " << radius << " x " << ticks << " ticks" << std::endl;
+
+    const RunResult serial = Run(balls, radius, ticks, nullptr);
+    Report("no pool     ", 1, serial, balls, ticks, serial.seconds);
+
+    bool agree = true;
+    for (unsigned threads = 1; ; threads = threads * 2 < maxThreads ? threads * 2 : maxThreads)
+    {
+        ThreadPool pool(threads);
+        const RunResult pooled = Run(balls, radius, ticks, &pool);
+        Report("pool threads ", threads, pooled, balls, ticks, serial.seconds);
+        agree = agree && pooled.hash == serial.hash;
+        if (threads == maxThreads)
+            break;
+    }
+
+    std::cout << (agree ? "all runs agree" : "runs disagree") << std::endl;
+    return agree ? 0 : 1;
+}
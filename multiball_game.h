@@ -0,0 +1,189 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "baked_font.h"
+#include "input_queue.h"
+#include "multiball.h"
+#include "pong_core.h"
+#include "thread_pool.h"
+
+// Draws a MultiBallSimulation as one textured triangle array: a quad per
+// ball over a small anti-aliased circle texture, with the court and paddles
+// in front using a solid texel of the same texture, so the whole field is
+// one draw call however many balls there are. The ball quads are refilled
+// on the pool every frame.
+class MultiBallRenderer
+{
+public:
+    static const std::size_t BALLS_PER_TASK = 8192;
+
+    MultiBallRenderer(sf::RenderTarget& target, const BakedAtlas& scoreFont, const MultiBallSimulation& simulation)
+        :
+        m_target(target),
+        m_vertices(sf::Triangles, BALL_FIRST + simulation.GetCount() * 6),
+        m_score(scoreFont),
+        m_playerOneScore(0),
+        m_playerTwoScore(0),
+        m_scoreValid(false),
+        m_fillRange{ *this,nullptr }
+    {
+        // white disc whose edge fades out over one texel
+        sf::Image image;
+        image.create(TEXTURE_SIZE, TEXTURE_SIZE, sf::Color::Transparent);
+        const float center = TEXTURE_SIZE / 2.0f;
+        for (unsigned y = 0; y < TEXTURE_SIZE; ++y)
+        {
+            for (unsigned x = 0; x < TEXTURE_SIZE; ++x)
+            {
+                const float distance = std::hypot(x + 0.5f - center, y + 0.5f - center);
+                const float coverage = std::min(1.0f, std::max(0.0f, center - distance));
+                image.setPixel(x, y, sf::Color(255, 255, 255, static_cast<sf::Uint8>(coverage * 255)));
+            }
+        }
+        m_texture.loadFromImage(image);
+        m_texture.setSmooth(true);
+
+        const RectangleShape& cShape = simulation.GetCourt().GetDimensions();
+        SetRectangle(COURT_FIRST, { cShape.x,cShape.y,cShape.width,COURT_OUTLINE_WIDTH });
+        SetRectangle(COURT_FIRST + 6, { cShape.x,cShape.y + cShape.height - COURT_OUTLINE_WIDTH,cShape.width,COURT_OUTLINE_WIDTH });
+        SetRectangle(COURT_FIRST + 12, { cShape.x,cShape.y,COURT_OUTLINE_WIDTH,cShape.height });
+        SetRectangle(COURT_FIRST + 18, { cShape.x + cShape.width - COURT_OUTLINE_WIDTH,cShape.y,COURT_OUTLINE_WIDTH,cShape.height });
+
+        // texture coordinates and colour never change
+        for (std::size_t i = 0; i < BALL_FIRST; ++i)
+            m_vertices[i].texCoords = { center,center };
+        const sf::Vector2f corners[6] = { { 0,0 },{ TEXTURE_SIZE,0 },{ TEXTURE_SIZE,TEXTURE_SIZE },{ 0,0 },{ TEXTURE_SIZE,TEXTURE_SIZE },{ 0,TEXTURE_SIZE } };
+        for (std::size_t i = BALL_FIRST; i < m_vertices.getVertexCount(); ++i)
+            m_vertices[i].texCoords = corners[(i - BALL_FIRST) % 6];
+        for (std::size_t i = 0; i < m_vertices.getVertexCount(); ++i)
+            m_vertices[i].color = sf::Color::White;
+    }
+
+    void Render(const MultiBallSimulation& simulation, ThreadPool& pool)
+    {
+        SetRectangle(PLAYER_ONE_FIRST, simulation.GetPlayerOne().GetPositionSize());
+        SetRectangle(PLAYER_TWO_FIRST, simulation.GetPlayerTwo().GetPositionSize());
+
+        m_fillRange.simulation = &simulation;
+        pool.ParallelFor(simulation.GetCount(), BALLS_PER_TASK, m_fillRange);
+
+        m_target.draw(m_vertices, sf::RenderStates(&m_texture));
+
+        if (!m_scoreValid || simulation.GetPlayerOneScore() != m_playerOneScore || simulation.GetPlayerTwoScore() != m_playerTwoScore)
+        {
+            m_playerOneScore = simulation.GetPlayerOneScore();
+            m_playerTwoScore = simulation.GetPlayerTwoScore();
+            m_scoreValid = true;
+
+            char text[48];
+            std::snprintf(text, sizeof(text), "%llu   %llu", static_cast<unsigned long long>(m_playerOneScore), static_cast<unsigned long long>(m_playerTwoScore));
+            m_score.SetString(text);
+            m_score.SetPosition({ WINDOW_WIDTH / 2 - m_score.GetWidth() / 2,COURT_MARGIN + COURT_OUTLINE_WIDTH + 5 });
+        }
+
+        m_score.Draw(m_target);
+    }
+
+private:
+    static const unsigned TEXTURE_SIZE = 16;
+
+    // vertex ranges in m_vertices, six vertices per rectangle
+    static const std::size_t COURT_FIRST = 0;
+    static const std::size_t PLAYER_ONE_FIRST = COURT_FIRST + 4 * 6;
+    static const std::size_t PLAYER_TWO_FIRST = PLAYER_ONE_FIRST + 6;
+    static const std::size_t BALL_FIRST = PLAYER_TWO_FIRST + 6;
+
+    struct FillRange
+    {
+        MultiBallRenderer& renderer;
+        const MultiBallSimulation* simulation;
+
+        void operator()(const std::size_t begin, const std::size_t end) const
+        {
+            renderer.FillBalls(*simulation, begin, end);
+        }
+    };
+
+    void FillBalls(const MultiBallSimulation& simulation, const std::size_t begin, const std::size_t end)
+    {
+        const float radius = simulation.GetRadius();
+        const std::vector<float>& x = simulation.GetX();
+        const std::vector<float>& y = simulation.GetY();
+        for (std::size_t i = begin; i < end; ++i)
+            SetRectangle(BALL_FIRST + i * 6, { x[i] - radius,y[i] - radius,radius * 2,radius * 2 });
+    }
+
+    void SetRectangle(const std::size_t first, const RectangleShape& rect)
+    {
+        const sf::Vector2f topLeft(rect.x, rect.y);
+        const sf::Vector2f topRight(rect.x + rect.width, rect.y);
+        const sf::Vector2f bottomLeft(rect.x, rect.y + rect.height);
+        const sf::Vector2f bottomRight(rect.x + rect.width, rect.y + rect.height);
+
+        m_vertices[first].position = topLeft;
+        m_vertices[first + 1].position = topRight;
+        m_vertices[first + 2].position = bottomRight;
+        m_vertices[first + 3].position = topLeft;
+        m_vertices[first + 4].position = bottomRight;
+        m_vertices[first + 5].position = bottomLeft;
+    }
+
+    sf::RenderTarget& m_target;
+    sf::VertexArray m_vertices;
+    sf::Texture m_texture;
+    BakedText m_score;
+    std::uint64_t m_playerOneScore;
+    std::uint64_t m_playerTwoScore;
+    bool m_scoreValid;
+    FillRange m_fillRange;
+};
+
+// The multi-ball party mode: both players on the keyboard against a court
+// full of balls, stepped and drawn on a pool with a thread per core.
+class MultiBallGame
+{
+public:
+    MultiBallGame(const std::size_t balls, sf::RenderTarget& target, const BakedAtlas& scoreFont)
+        :
+        m_pool(0),
+        m_simulation(balls, FitRadius(balls), 1),
+        m_renderer(target, scoreFont, m_simulation)
+    {
+    }
+
+    GAME_STATE Update(const float elapsedMilliseconds, InputQueue& inputs, const InputQueue::Clock::time_point tickEnd)
+    {
+        // one step per tick; changes within the tick take effect at its end
+        TimedInput change;
+        while (inputs.Pop(tickEnd, change))
+        {
+        }
+        m_simulation.Update(elapsedMilliseconds, inputs.GetApplied(), &m_pool);
+        return GAME_STATE::IN_GAME;
+    }
+
+    void Render()
+    {
+        m_renderer.Render(m_simulation, m_pool);
+    }
+
+    // the game's ball radius, shrunk so the balls cover at most a third of
+    // the court; too many balls fit only below MultiBallSimulation::MIN_RADIUS
+    static float FitRadius(const std::size_t balls)
+    {
+        const float courtArea = (WINDOW_WIDTH - COURT_MARGIN * 2) * (WINDOW_HEIGHT - COURT_MARGIN * 2);
+        return std::min(BALL_RADIUS, std::sqrt(courtArea / 3 / (3.14159265f * balls)));
+    }
+
+private:
+    ThreadPool m_pool;
+    MultiBallSimulation m_simulation;
+    MultiBallRenderer m_renderer;
+};
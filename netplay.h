@@ -0,0 +1,74 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "rollback.h"
+
+// Carries a RollbackSession's packets to the other player over UDP. Outgoing
+// packets go through a LinkConditioner first, so latency and loss can be
+// added when both players run on one machine over loopback.
+class UdpPeer
+{
+public:
+    typedef LinkConditioner::Clock Clock;
+
+    UdpPeer(const sf::IpAddress& remoteAddress, const unsigned short remotePort, const LinkConditioner& conditioner)
+        :
+        m_remoteAddress(remoteAddress),
+        m_remotePort(remotePort),
+        m_conditioner(conditioner)
+    {
+    }
+
+    bool Bind(const unsigned short localPort)
+    {
+        if (m_socket.bind(localPort) != sf::Socket::Done)
+            return false;
+        m_socket.setBlocking(false);
+        return true;
+    }
+
+    // queues the session's current packet; Flush puts it on the wire when due
+    void Send(const RollbackSession& session, const Clock::time_point now)
+    {
+        std::uint8_t buffer[RollbackSession::MAX_PACKET_SIZE];
+        m_conditioner.Send(buffer, session.WritePacket(buffer), now);
+        Flush(now);
+    }
+
+    void Flush(const Clock::time_point now)
+    {
+        while (m_conditioner.Receive(now, m_packet))
+            m_socket.send(m_packet.data(), m_packet.size(), m_remoteAddress, m_remotePort);
+    }
+
+    // hands every waiting datagram from the other player to the session
+    void Receive(RollbackSession& session)
+    {
+        std::uint8_t buffer[RollbackSession::MAX_PACKET_SIZE];
+        std::size_t received;
+        sf::IpAddress sender;
+        unsigned short senderPort;
+        while (m_socket.receive(buffer, sizeof(buffer), received, sender, senderPort) == sf::Socket::Done)
+        {
+            if (sender == m_remoteAddress && senderPort == m_remotePort)
+                session.ReadPacket(buffer, received);
+        }
+    }
+
+    const LinkConditioner& GetConditioner() const
+    {
+        return m_conditioner;
+    }
+
+private:
+    sf::UdpSocket m_socket;
+    sf::IpAddress m_remoteAddress;
+    unsigned short m_remotePort;
+    LinkConditioner m_conditioner;
+    std::vector<std::uint8_t> m_packet;
+};
@@ -0,0 +1,194 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "pong_core.h"
+#include "rollback.h"
+
+// Plays matches between two rollback sessions joined by conditioned links on
+// a simulated clock, then checks that both sides ended on the same state as
+// a plain simulation of the inputs each side actually sent.
+
+struct Peer
+{
+    Peer(const std::uint_fast8_t scoreToWin, const std::uint8_t player, const PHYSICS physics, const std::uint32_t seed)
+        :
+        session(scoreToWin, player, physics),
+        random(seed),
+        held(0)
+    {
+    }
+
+    // holds a direction for a while, then picks another; always ready to serve
+    std::uint8_t NextInput()
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        if ((random & 7) == 0)
+        {
+            switch ((random >> 3) % 3)
+            {
+            case 0: held = RollbackSession::UP; break;
+            case 1: held = RollbackSession::DOWN; break;
+            default: held = 0; break;
+            }
+        }
+        return held | RollbackSession::SERVE;
+    }
+
+    RollbackSession session;
+    std::uint32_t random;
+    std::uint8_t held;
+    std::vector<std::uint8_t> sent;
+};
+
+static void Tick(Peer& peer, LinkConditioner& in, LinkConditioner& out, const LinkConditioner::Clock::time_point now)
+{
+    std::vector<std::uint8_t> packet;
+    while (in.Receive(now, packet))
+        peer.session.ReadPacket(packet.data(), packet.size());
+
+    if (!peer.session.ShouldWait())
+    {
+        const std::uint8_t bits = peer.NextInput();
+        if (peer.session.AdvanceFrame(bits))
+            peer.sent.push_back(bits);
+    }
+
+    std::uint8_t buffer[RollbackSession::MAX_PACKET_SIZE];
+    out.Send(buffer, peer.session.WritePacket(buffer), now);
+}
+
+static PongSimulation Reference(const std::uint_fast8_t scoreToWin, const PHYSICS physics, const Peer& one, const Peer& two)
+{
+    PongSimulation simulation(scoreToWin);
+    for (std::size_t frame = 0; frame < one.sent.size() && frame < two.sent.size(); ++frame)
+    {
+        const PongInput input = RollbackSession::CombineInputs(simulation, one.sent[frame], two.sent[frame]);
+        const GAME_STATE gameState = simulation.Step(physics, UPDATE_MS, input);
+        if (gameState != GAME_STATE::IN_GAME)
+            break;
+    }
+    return simulation;
+}
+
+int main(int argc, char** argv)
+{
+    std::uint64_t matches = 20;
+    int scoreToWin = 3;
+    float latency = 60;
+    float jitter = 20;
+    float loss = 5;
+    std::uint64_t offset = 3;
+    std::uint32_t seed = 1;
+    PHYSICS physics = PHYSICS::TICK;
+    const std::uint64_t maxTicks = 200000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--matches") == 0 && hasValue)
+            matches = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--score") == 0 && hasValue)
+            scoreToWin = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--latency") == 0 && hasValue)
+            latency = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--jitter") == 0 && hasValue)
+            jitter = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--loss") == 0 && hasValue)
+            loss = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--offset") == 0 && hasValue)
+            offset = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--exact-physics") == 0)
+            physics = PHYSICS::EXACT;
+        else if (std::strcmp(argv[i], "--fixed-point") == 0)
+            physics = PHYSICS::FIXED_POINT;
+        else
+        {
+            std::cerr << "usage: pong_netplay_sim [--matches N] [--score N] [--latency MS] [--jitter MS]\n"
+                         "                        [--loss PERCENT] [--offset TICKS] [--seed N]\n"
+                         "                        [--exact-physics | --fixed-point]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (scoreToWin < 1 || scoreToWin > 255)
+    {
+        std::cerr << "score to win must be between 1 and 255" << std::endl;
+        return 1;
+    }
+    const std::uint_fast8_t maxScore = static_cast<std::uint_fast8_t>(scoreToWin);
+
+    std::uint64_t desyncs = 0;
+    std::uint64_t unfinished = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t stalls = 0;
+    std::uint64_t rollbacks = 0;
+    std::uint64_t resimulated = 0;
+    std::uint32_t maxRollback = 0;
+    double maxRollbackMicroseconds = 0;
+    std::uint64_t dropped = 0;
+
+    for (std::uint64_t match = 0; match < matches; ++match)
+    {
+        const std::uint32_t matchSeed = seed + static_cast<std::uint32_t>(match) * 4;
+        Peer one(maxScore, 0, physics, matchSeed | 1);
+        Peer two(maxScore, 1, physics, (matchSeed + 2) | 1);
+        LinkConditioner oneToTwo(latency, jitter, loss, matchSeed);
+        LinkConditioner twoToOne(latency, jitter, loss, matchSeed + 1);
+
+        // the second player starts a few ticks late, as a real peer would
+        LinkConditioner::Clock::time_point now;
+        std::uint64_t tick = 0;
+        for (; tick < maxTicks && !(one.session.IsFinished() && two.session.IsFinished()); ++tick)
+        {
+            now += std::chrono::duration_cast<LinkConditioner::Clock::duration>(std::chrono::duration<float, std::milli>(UPDATE_MS));
+            Tick(one, twoToOne, oneToTwo, now);
+            if (tick >= offset)
+                Tick(two, oneToTwo, twoToOne, now);
+        }
+
+        const PongSimulation reference = Reference(maxScore, physics, one, two);
+        const bool finished = one.session.IsFinished() && two.session.IsFinished();
+        const bool inSync = one.session.GetSimulation().Hash() == reference.Hash() &&
+            two.session.GetSimulation().Hash() == reference.Hash();
+        if (!finished)
+            ++unfinished;
+        if (!inSync)
+        {
+            ++desyncs;
+            std::cout << "match " << match << " desynced" << std::endl;
+        }
+
+        for (const Peer* peer : { &one,&two })
+        {
+            const RollbackStats& stats = peer->session.GetStats();
+            frames += stats.frames;
+            stalls += stats.stalls;
+            rollbacks += stats.rollbacks;
+            resimulated += stats.resimulatedFrames;
+            if (stats.maxRollbackFrames > maxRollback)
+                maxRollback = stats.maxRollbackFrames;
+            if (stats.maxRollbackMicroseconds > maxRollbackMicroseconds)
+                maxRollbackMicroseconds = stats.maxRollbackMicroseconds;
+        }
+        dropped += oneToTwo.GetDropped() + twoToOne.GetDropped();
+    }
+
+    std::cout << "matches: " << matches << "  desynced: " << desyncs << "  unfinished: " << unfinished << "\n"
+        << "frames: " << frames
+        << "  stalls: " << stalls
+        << "  packets dropped: " << dropped << "\n"
+        << "rollbacks: " << rollbacks
+        << "  mean frames: " << (rollbacks > 0 ? static_cast<double>(resimulated) / rollbacks : 0.0)
+        << "  max frames: " << maxRollback
+        << "  max microseconds: " << maxRollbackMicroseconds << std::endl;
+
+    return desyncs == 0 && unfinished == 0 ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+#include <SFML/Graphics.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+#include "baked_font.h"
+#include "game.h"
+#include "sound_cues.h"
+
+// Build step: packs the font, its glyph atlases at the sizes the game draws
+// text at, and the match sounds into one file the game maps at startup.
+
+int main(int argc, char** argv)
+{
+    std::string fontPath = "SourceSansPro-Regular.otf";
+    std::string outPath = "pong.pack";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--font") == 0 && hasValue)
+            fontPath = argv[++i];
+        else if (std::strcmp(argv[i], "--out") == 0 && hasValue)
+            outPath = argv[++i];
+        else
+        {
+            std::cerr << "usage: pong_pack [--font FILE] [--out FILE]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::ifstream fontFile(fontPath, std::ios::binary);
+    const std::vector<char> fontBytes((std::istreambuf_iterator<char>(fontFile)), std::istreambuf_iterator<char>());
+    sf::Font font;
+    if (fontBytes.empty() || !font.loadFromMemory(fontBytes.data(), fontBytes.size()))
+    {
+        std::cerr << "could not load font " << fontPath << std::endl;
+        return 1;
+    }
+
+    AssetPackWriter writer;
+    writer.Add("font", fontBytes.data(), fontBytes.size());
+
+    for (const unsigned characterSize : { GameRenderer::SCORE_CHARACTER_SIZE,PongMenu::BUTTON_CHARACTER_SIZE })
+    {
+        BakedAtlas atlas;
+        if (!atlas.Bake(font, characterSize))
+        {
+            std::cerr << "could not rasterise the font at " << characterSize << " px" << std::endl;
+            return 1;
+        }
+        atlas.AddTo(writer);
+        std::cout << BakedAtlas::GetEntryName(characterSize) << ": "
+            << atlas.GetTexture().getSize().x << "x" << atlas.GetTexture().getSize().y << std::endl;
+    }
+
+    std::vector<std::int16_t> samples;
+    for (std::size_t sound = 0; sound < static_cast<std::size_t>(SOUND::COUNT); ++sound)
+    {
+        SoundSynthesizer::Synthesize(static_cast<SOUND>(sound), samples);
+        writer.Add("sound." + std::to_string(sound), samples.data(), samples.size() * sizeof(std::int16_t));
+    }
+
+    if (!writer.Write(outPath))
+    {
+        std::cerr << "could not write " << outPath << std::endl;
+        return 1;
+    }
+    std::cout << "wrote " << outPath << std::endl;
+    return 0;
+}
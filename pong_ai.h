@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "pong_core.h"
+
+// where and when the ball centre next crosses a vertical line
+struct Interception
+{
+    bool valid = false;
+    float y = 0;
+    float seconds = 0;
+};
+
+// Closed-form ball path: the straight line to the target x is unfolded
+// across the walls and folded back into the court, so the cost does not
+// depend on how many bounces there are. Matches the simulation up to the
+// sub-tick slack of its per-tick wall clamp.
+class TrajectoryPredictor
+{
+public:
+    static Interception Predict(const Ball& ball, const Court& court, const float planeX)
+    {
+        Interception interception;
+        const Vector2D& position = ball.GetPosition();
+        const Vector2D& velocity = ball.GetVelocity();
+        if (velocity.x == 0 || (planeX - position.x) / velocity.x < 0)
+            return interception;
+
+        interception.valid = true;
+        interception.seconds = (planeX - position.x) / velocity.x;
+        interception.y = Fold(position.y + velocity.y * interception.seconds, court);
+        return interception;
+    }
+
+    // x the ball centre is at when it first touches the paddle face
+    static float PaddlePlane(const Paddle& paddle, const bool isPlayerOne)
+    {
+        const RectangleShape& rect = paddle.GetPositionSize();
+        return isPlayerOne ? rect.x + PADDLE_WIDTH + BALL_RADIUS : rect.x - BALL_RADIUS;
+    }
+
+    // the walls reflect the centre at the court's top and bottom edge
+    static float Fold(const float y, const Court& court)
+    {
+        const RectangleShape& courtShape = court.GetDimensions();
+        const float span = courtShape.height;
+        float offset = std::fmod(y - courtShape.y, 2 * span);
+        if (offset < 0)
+            offset += 2 * span;
+        return courtShape.y + (offset <= span ? offset : 2 * span - offset);
+    }
+};
+
+// how good the CPU player is
+struct CpuSettings
+{
+    // ticks of UPDATE_MS between the ball changing direction and the CPU
+    // reacting; the delay lasts as long at other tick rates
+    std::uint32_t reactionTicks = 4;
+    // the aim point is off by up to this much, drawn once per rally leg
+    float errorPixels = 20;
+
+    static CpuSettings Easy()
+    {
+        CpuSettings settings;
+        settings.reactionTicks = 8;
+        settings.errorPixels = 45;
+        return settings;
+    }
+
+    static CpuSettings Normal()
+    {
+        return CpuSettings();
+    }
+
+    static CpuSettings Hard()
+    {
+        CpuSettings settings;
+        settings.reactionTicks = 1;
+        settings.errorPixels = 5;
+        return settings;
+    }
+};
+
+// Computer player for one paddle. It re-aims only when the play state
+// changes (serve, return, goal), after its reaction delay, so a tick costs a
+// couple of compares plus one O(1) prediction per rally leg.
+class CpuOpponent
+{
+public:
+    CpuOpponent(const bool isPlayerOne, const CpuSettings& settings, const std::uint32_t seed)
+        :
+        m_isPlayerOne(isPlayerOne),
+        m_settings(settings),
+        m_random(seed),
+        m_seenState(PLAY_STATE::SERVE_PLAYER_ONE),
+        m_waitTicks(settings.reactionTicks),
+        m_target(WINDOW_HEIGHT / 2),
+        m_aimed(false),
+        m_tickMilliseconds(UPDATE_MS)
+    {
+    }
+
+    // the length of the ticks Drive is called for; a wait already under way
+    // is rescaled to the new ticks
+    void SetTickMilliseconds(const float milliseconds)
+    {
+        m_waitTicks = static_cast<std::uint32_t>(std::lround(m_waitTicks * m_tickMilliseconds / milliseconds));
+        m_tickMilliseconds = milliseconds;
+    }
+
+    // sets this paddle's controls, and the serve when it is this paddle's serve
+    void Drive(const PongSimulation& simulation, PongInput& input)
+    {
+        const PLAY_STATE playState = simulation.GetPlayState();
+        if (playState != m_seenState)
+        {
+            m_seenState = playState;
+            m_waitTicks = static_cast<std::uint32_t>(std::lround(m_settings.reactionTicks * UPDATE_MS / m_tickMilliseconds));
+            m_aimed = false;
+        }
+
+        const bool serving = playState == (m_isPlayerOne ? PLAY_STATE::SERVE_PLAYER_ONE : PLAY_STATE::SERVE_PLAYER_TWO);
+        const bool reacting = m_waitTicks == 0;
+        if (!reacting)
+            --m_waitTicks;
+        else if (!m_aimed)
+            Aim(simulation);
+
+        // within half a tick of paddle travel counts as there, so it doesn't jitter
+        const float deadZone = PADDLE_SPEED * m_tickMilliseconds / 1000 / 2;
+        const float center = (m_isPlayerOne ? simulation.GetPlayerOne() : simulation.GetPlayerTwo()).GetPositionSize().y + PADDLE_LENGTH / 2;
+        const bool up = reacting && !serving && center > m_target + deadZone;
+        const bool down = reacting && !serving && center < m_target - deadZone;
+        if (m_isPlayerOne)
+        {
+            input.playerOneUp = up;
+            input.playerOneDown = down;
+        }
+        else
+        {
+            input.playerTwoUp = up;
+            input.playerTwoDown = down;
+        }
+        if (serving)
+            input.serve = reacting;
+    }
+
+    float GetTarget() const
+    {
+        return m_target;
+    }
+
+private:
+    void Aim(const PongSimulation& simulation)
+    {
+        m_aimed = true;
+        const bool incoming = simulation.GetPlayState() == (m_isPlayerOne ? PLAY_STATE::TOWARD_PLAYER_ONE : PLAY_STATE::TOWARD_PLAYER_TWO);
+        const RectangleShape& courtShape = simulation.GetCourt().GetDimensions();
+
+        // wait mid-court for the return
+        m_target = courtShape.y + courtShape.height / 2;
+        if (!incoming)
+            return;
+
+        const Paddle& paddle = m_isPlayerOne ? simulation.GetPlayerOne() : simulation.GetPlayerTwo();
+        const Interception interception = TrajectoryPredictor::Predict(simulation.GetBall(), simulation.GetCourt(), TrajectoryPredictor::PaddlePlane(paddle, m_isPlayerOne));
+        if (!interception.valid)
+            return;
+
+        std::uniform_real_distribution<float> error(-m_settings.errorPixels, m_settings.errorPixels);
+        m_target = interception.y + error(m_random);
+    }
+
+    bool m_isPlayerOne;
+    CpuSettings m_settings;
+    std::minstd_rand m_random;
+    PLAY_STATE m_seenState;
+    std::uint32_t m_waitTicks;
+    float m_target;
+    bool m_aimed;
+    float m_tickMilliseconds;
+};
@@ -0,0 +1,414 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if !defined(PONG_BATCH_SCALAR)
+#if defined(__AVX512F__)
+#define PONG_BATCH_AVX512
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#define PONG_BATCH_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PONG_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+#include "pong_core.h"
+
+// Lane types used by PongBatch's kernel. Each one wraps a register of WIDTH
+// floats and the comparison mask type that goes with it, so the rules are
+// written once and compiled for every instruction set.
+
+struct ScalarLanes
+{
+    typedef float F;
+    typedef bool M;
+    static const std::size_t WIDTH = 1;
+
+    static F Load(const float* p) { return *p; }
+    static void Store(float* p, const F v) { *p = v; }
+    static F Set(const float v) { return v; }
+    static M InputMask(const std::uint8_t* p, const std::uint8_t bit) { return (*p & bit) != 0; }
+
+    static F Add(const F a, const F b) { return a + b; }
+    static F Sub(const F a, const F b) { return a - b; }
+    static F Mul(const F a, const F b) { return a * b; }
+    static F Neg(const F a) { return -a; }
+
+    static M Lt(const F a, const F b) { return a < b; }
+    static M Le(const F a, const F b) { return a <= b; }
+    static M Gt(const F a, const F b) { return a > b; }
+    static M Ge(const F a, const F b) { return a >= b; }
+    static M Eq(const F a, const F b) { return a == b; }
+
+    static M And(const M a, const M b) { return a && b; }
+    static M Or(const M a, const M b) { return a || b; }
+    static M AndNot(const M a, const M b) { return !a && b; }
+    static bool Any(const M m) { return m; }
+
+    static F Select(const M m, const F a, const F b) { return m ? a : b; }
+};
+
+#if defined(PONG_BATCH_SSE2)
+struct Sse2Lanes
+{
+    typedef __m128 F;
+    typedef __m128 M;
+    static const std::size_t WIDTH = 4;
+
+    static F Load(const float* p) { return _mm_loadu_ps(p); }
+    static void Store(float* p, const F v) { _mm_storeu_ps(p, v); }
+    static F Set(const float v) { return _mm_set1_ps(v); }
+    static M InputMask(const std::uint8_t* p, const std::uint8_t bit)
+    {
+        std::int32_t packed;
+        std::memcpy(&packed, p, sizeof(packed));
+        const __m128i zero = _mm_setzero_si128();
+        __m128i lanes = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+        lanes = _mm_unpacklo_epi16(lanes, zero);
+        const __m128i bits = _mm_set1_epi32(bit);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(lanes, bits), bits));
+    }
+
+    static F Add(const F a, const F b) { return _mm_add_ps(a, b); }
+    static F Sub(const F a, const F b) { return _mm_sub_ps(a, b); }
+    static F Mul(const F a, const F b) { return _mm_mul_ps(a, b); }
+    static F Neg(const F a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+
+    static M Lt(const F a, const F b) { return _mm_cmplt_ps(a, b); }
+    static M Le(const F a, const F b) { return _mm_cmple_ps(a, b); }
+    static M Gt(const F a, const F b) { return _mm_cmpgt_ps(a, b); }
+    static M Ge(const F a, const F b) { return _mm_cmpge_ps(a, b); }
+    static M Eq(const F a, const F b) { return _mm_cmpeq_ps(a, b); }
+
+    static M And(const M a, const M b) { return _mm_and_ps(a, b); }
+    static M Or(const M a, const M b) { return _mm_or_ps(a, b); }
+    static M AndNot(const M a, const M b) { return _mm_andnot_ps(a, b); }
+    static bool Any(const M m) { return _mm_movemask_ps(m) != 0; }
+
+    static F Select(const M m, const F a, const F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+};
+#endif
+
+#if defined(PONG_BATCH_AVX2)
+struct Avx2Lanes
+{
+    typedef __m256 F;
+    typedef __m256 M;
+    static const std::size_t WIDTH = 8;
+
+    static F Load(const float* p) { return _mm256_loadu_ps(p); }
+    static void Store(float* p, const F v) { _mm256_storeu_ps(p, v); }
+    static F Set(const float v) { return _mm256_set1_ps(v); }
+    static M InputMask(const std::uint8_t* p, const std::uint8_t bit)
+    {
+        const __m256i lanes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+        const __m256i bits = _mm256_set1_epi32(bit);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(lanes, bits), bits));
+    }
+
+    static F Add(const F a, const F b) { return _mm256_add_ps(a, b); }
+    static F Sub(const F a, const F b) { return _mm256_sub_ps(a, b); }
+    static F Mul(const F a, const F b) { return _mm256_mul_ps(a, b); }
+    static F Neg(const F a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+
+    static M Lt(const F a, const F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static M Le(const F a, const F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static M Gt(const F a, const F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+    static M Ge(const F a, const F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+    static M Eq(const F a, const F b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+
+    static M And(const M a, const M b) { return _mm256_and_ps(a, b); }
+    static M Or(const M a, const M b) { return _mm256_or_ps(a, b); }
+    static M AndNot(const M a, const M b) { return _mm256_andnot_ps(a, b); }
+    static bool Any(const M m) { return _mm256_movemask_ps(m) != 0; }
+
+    static F Select(const M m, const F a, const F b) { return _mm256_blendv_ps(b, a, m); }
+};
+#endif
+
+#if defined(PONG_BATCH_AVX512)
+struct Avx512Lanes
+{
+    typedef __m512 F;
+    typedef __mmask16 M;
+    static const std::size_t WIDTH = 16;
+
+    static F Load(const float* p) { return _mm512_loadu_ps(p); }
+    static void Store(float* p, const F v) { _mm512_storeu_ps(p, v); }
+    static F Set(const float v) { return _mm512_set1_ps(v); }
+    static M InputMask(const std::uint8_t* p, const std::uint8_t bit)
+    {
+        const __m512i lanes = _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+        return _mm512_test_epi32_mask(lanes, _mm512_set1_epi32(bit));
+    }
+
+    static F Add(const F a, const F b) { return _mm512_add_ps(a, b); }
+    static F Sub(const F a, const F b) { return _mm512_sub_ps(a, b); }
+    static F Mul(const F a, const F b) { return _mm512_mul_ps(a, b); }
+    static F Neg(const F a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_set1_epi32(static_cast<int>(0x80000000u)))); }
+
+    static M Lt(const F a, const F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static M Le(const F a, const F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+    static M Gt(const F a, const F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+    static M Ge(const F a, const F b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+    static M Eq(const F a, const F b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+
+    static M And(const M a, const M b) { return a & b; }
+    static M Or(const M a, const M b) { return a | b; }
+    static M AndNot(const M a, const M b) { return static_cast<M>(~a & b); }
+    static bool Any(const M m) { return m != 0; }
+
+    static F Select(const M m, const F a, const F b) { return _mm512_mask_blend_ps(m, b, a); }
+};
+#endif
+
+#if defined(PONG_BATCH_AVX512)
+typedef Avx512Lanes PongBatchLanes;
+#elif defined(PONG_BATCH_AVX2)
+typedef Avx2Lanes PongBatchLanes;
+#elif defined(PONG_BATCH_SSE2)
+typedef Sse2Lanes PongBatchLanes;
+#else
+typedef ScalarLanes PongBatchLanes;
+#endif
+
+// N independent matches stepped in lockstep, stored as one array per field.
+// Applies the same rules as PongSimulation::Update, with the branches turned
+// into lane masks; matches that reached the max score are frozen until reset.
+class PongBatch
+{
+public:
+    // play states as stored in the state array
+    static constexpr float SERVE_PLAYER_ONE = 0;
+    static constexpr float SERVE_PLAYER_TWO = 1;
+    static constexpr float TOWARD_PLAYER_ONE = 2;
+    static constexpr float TOWARD_PLAYER_TWO = 3;
+
+    PongBatch(const std::size_t matchCount, const std::uint_fast8_t scoreToWin)
+        :
+        m_matchCount(matchCount),
+        m_maxScore(scoreToWin)
+    {
+        // pad to a whole 16-lane block so kernels never need a tail loop
+        const std::size_t padded = (matchCount + 15) / 16 * 16;
+        for (std::vector<float>* field : { &m_ballX, &m_ballY, &m_ballDX, &m_ballDY,
+            &m_playerOneY, &m_playerTwoY, &m_playerOneScore, &m_playerTwoScore, &m_playState })
+            field->resize(padded);
+        m_inputs.resize(padded);
+
+        for (std::size_t i = 0; i < padded; ++i)
+            ResetMatch(i);
+    }
+
+    void ResetMatch(const std::size_t match)
+    {
+        m_ballX[match] = WINDOW_WIDTH / 2;
+        m_ballY[match] = WINDOW_HEIGHT / 2;
+        m_ballDX[match] = 0;
+        m_ballDY[match] = 0;
+        m_playerOneY[match] = WINDOW_HEIGHT / 2 - (PADDLE_LENGTH / 2);
+        m_playerTwoY[match] = WINDOW_HEIGHT / 2 - (PADDLE_LENGTH / 2);
+        m_playerOneScore[match] = 0;
+        m_playerTwoScore[match] = 0;
+        m_playState[match] = SERVE_PLAYER_ONE;
+        m_inputs[match] = 0;
+    }
+
+    // resets every match that has reached the max score, returns how many did
+    std::size_t ResetFinished()
+    {
+        if (!m_anyFinished)
+            return 0;
+        m_anyFinished = false;
+
+        std::size_t finished = 0;
+        for (std::size_t i = 0; i < m_matchCount; ++i)
+        {
+            if (IsFinished(i))
+            {
+                ResetMatch(i);
+                ++finished;
+            }
+        }
+        return finished;
+    }
+
+    bool IsFinished(const std::size_t match) const
+    {
+        return m_playerOneScore[match] >= m_maxScore || m_playerTwoScore[match] >= m_maxScore;
+    }
+
+    void SetInput(const std::size_t match, const PongInput& input)
+    {
+        m_inputs[match] = input.ToBits();
+    }
+
+    // PongInput::ToBits() per match, written by the caller before each Step
+    std::uint8_t* GetInputs()
+    {
+        return m_inputs.data();
+    }
+
+    void Step(const float elapsedMilliseconds)
+    {
+        StepWith<PongBatchLanes>(elapsedMilliseconds);
+    }
+
+    void StepScalar(const float elapsedMilliseconds)
+    {
+        StepWith<ScalarLanes>(elapsedMilliseconds);
+    }
+
+    std::size_t GetMatchCount() const { return m_matchCount; }
+    static std::size_t GetLaneWidth() { return PongBatchLanes::WIDTH; }
+
+    const float* GetBallX() const { return m_ballX.data(); }
+    const float* GetBallY() const { return m_ballY.data(); }
+    const float* GetBallDX() const { return m_ballDX.data(); }
+    const float* GetBallDY() const { return m_ballDY.data(); }
+    const float* GetPlayerOneY() const { return m_playerOneY.data(); }
+    const float* GetPlayerTwoY() const { return m_playerTwoY.data(); }
+    const float* GetPlayerOneScore() const { return m_playerOneScore.data(); }
+    const float* GetPlayerTwoScore() const { return m_playerTwoScore.data(); }
+    const float* GetPlayState() const { return m_playState.data(); }
+
+private:
+    template <class L>
+    void StepWith(const float elapsedMilliseconds)
+    {
+        typedef typename L::F F;
+        typedef typename L::M M;
+
+        const float playerOneX = COURT_MARGIN + PADDLE_PADDING;
+        const float playerTwoX = WINDOW_WIDTH - COURT_MARGIN - PADDLE_PADDING - PADDLE_WIDTH;
+        const float courtTop = COURT_MARGIN;
+        const float courtBottom = COURT_MARGIN + (WINDOW_HEIGHT - COURT_MARGIN * 2);
+
+        const F time = L::Set(elapsedMilliseconds / 1000.0f);
+        const F paddleStep = L::Mul(L::Set(PADDLE_SPEED), time);
+        const F zero = L::Set(0);
+        const F one = L::Set(1);
+        const F radius = L::Set(BALL_RADIUS);
+        const F maxScore = L::Set(m_maxScore);
+
+        for (std::size_t i = 0; i < m_matchCount; i += L::WIDTH)
+        {
+            const F scoreOne = L::Load(&m_playerOneScore[i]);
+            const F scoreTwo = L::Load(&m_playerTwoScore[i]);
+            const M active = L::And(L::Lt(scoreOne, maxScore), L::Lt(scoreTwo, maxScore));
+            if (!L::Any(active))
+                continue;
+
+            const std::uint8_t* inputs = &m_inputs[i];
+            F paddleOne = L::Load(&m_playerOneY[i]);
+            F paddleTwo = L::Load(&m_playerTwoY[i]);
+            paddleOne = L::Select(L::InputMask(inputs, PongInput::PLAYER_ONE_UP), L::Sub(paddleOne, paddleStep), paddleOne);
+            paddleOne = L::Select(L::InputMask(inputs, PongInput::PLAYER_ONE_DOWN), L::Add(paddleOne, paddleStep), paddleOne);
+            paddleTwo = L::Select(L::InputMask(inputs, PongInput::PLAYER_TWO_UP), L::Sub(paddleTwo, paddleStep), paddleTwo);
+            paddleTwo = L::Select(L::InputMask(inputs, PongInput::PLAYER_TWO_DOWN), L::Add(paddleTwo, paddleStep), paddleTwo);
+
+            F state = L::Load(&m_playState[i]);
+            F ballX = L::Load(&m_ballX[i]);
+            F ballY = L::Load(&m_ballY[i]);
+            F ballDX = L::Load(&m_ballDX[i]);
+            F ballDY = L::Load(&m_ballDY[i]);
+
+            // serving: ball sits on the server's paddle until serve is pressed
+            const M serveOne = L::Eq(state, L::Set(SERVE_PLAYER_ONE));
+            const M serveTwo = L::Eq(state, L::Set(SERVE_PLAYER_TWO));
+            const M serving = L::Or(serveOne, serveTwo);
+            const M served = L::And(serving, L::InputMask(inputs, PongInput::SERVE));
+            const F paddleCenter = L::Select(serveOne, paddleOne, paddleTwo);
+
+            ballX = L::Select(serveOne, L::Set(playerOneX + PADDLE_WIDTH), L::Select(serveTwo, L::Set(playerTwoX - BALL_RADIUS), ballX));
+            ballY = L::Select(serving, L::Add(paddleCenter, L::Set(PADDLE_LENGTH / 2)), ballY);
+            ballDX = L::Select(serving, zero, ballDX);
+            ballDY = L::Select(serving, zero, ballDY);
+            ballDX = L::Select(served, L::Select(serveOne, L::Set(BALL_VELOCITY), L::Set(-BALL_VELOCITY)), ballDX);
+            state = L::Select(served, L::Select(serveOne, L::Set(TOWARD_PLAYER_TWO), L::Set(TOWARD_PLAYER_ONE)), state);
+
+            ballX = L::Add(ballX, L::Mul(ballDX, time));
+            ballY = L::Add(ballY, L::Mul(ballDY, time));
+
+            // paddle hits and misses
+            const M towardOne = L::Eq(state, L::Set(TOWARD_PLAYER_ONE));
+            const M towardTwo = L::Eq(state, L::Set(TOWARD_PLAYER_TWO));
+            const F ballTop = L::Sub(ballY, radius);
+            const F ballBottom = L::Add(ballY, radius);
+
+            const M reachedOne = L::And(towardOne, L::Le(L::Sub(ballX, radius), L::Set(playerOneX + PADDLE_WIDTH)));
+            const M overlapOne = L::And(L::Ge(ballBottom, paddleOne), L::Le(ballTop, L::Add(paddleOne, L::Set(PADDLE_LENGTH))));
+            const M hitOne = L::And(reachedOne, overlapOne);
+            const M missOne = L::And(L::AndNot(overlapOne, reachedOne), L::Lt(L::Add(ballX, radius), L::Set(playerOneX)));
+
+            const M reachedTwo = L::And(towardTwo, L::Ge(L::Add(ballX, radius), L::Set(playerTwoX)));
+            const M overlapTwo = L::And(L::Ge(ballBottom, paddleTwo), L::Le(ballTop, L::Add(paddleTwo, L::Set(PADDLE_LENGTH))));
+            const M hitTwo = L::And(reachedTwo, overlapTwo);
+            const M missTwo = L::And(L::AndNot(overlapTwo, reachedTwo), L::Gt(L::Sub(ballX, radius), L::Set(playerTwoX + PADDLE_WIDTH)));
+
+            const M hit = L::Or(hitOne, hitTwo);
+            const F hitPaddle = L::Select(hitOne, paddleOne, paddleTwo);
+            const M upperThird = L::Le(ballBottom, L::Add(hitPaddle, L::Set(PADDLE_LENGTH / 3)));
+            const M lowerThird = L::Ge(ballTop, L::Add(hitPaddle, L::Set(PADDLE_LENGTH / 3 * 2)));
+
+            F hitDX = L::Neg(ballDX);
+            F hitDY = L::Select(upperThird, L::Sub(ballDY, L::Set(BALL_VELOCITY / 2)),
+                L::Select(lowerThird, L::Add(ballDY, L::Set(BALL_VELOCITY / 2)), ballDY));
+            hitDX = L::Select(L::Gt(hitDX, zero), L::Add(hitDX, L::Set(BALL_VEL_INCR)), L::Sub(hitDX, L::Set(BALL_VEL_INCR)));
+            hitDY = L::Select(L::Gt(hitDY, zero), L::Add(hitDY, L::Set(BALL_VEL_INCR)), L::Sub(hitDY, L::Set(BALL_VEL_INCR)));
+
+            ballDX = L::Select(hit, hitDX, ballDX);
+            ballDY = L::Select(hit, hitDY, ballDY);
+            F outX = L::Select(hitOne, L::Set(playerOneX + PADDLE_WIDTH + BALL_RADIUS + 1),
+                L::Select(hitTwo, L::Set(playerTwoX - BALL_RADIUS - 1), ballX));
+
+            state = L::Select(hitOne, L::Set(TOWARD_PLAYER_TWO), L::Select(hitTwo, L::Set(TOWARD_PLAYER_ONE), state));
+            state = L::Select(missOne, L::Set(SERVE_PLAYER_ONE), L::Select(missTwo, L::Set(SERVE_PLAYER_TWO), state));
+            const F newScoreOne = L::Select(missTwo, L::Add(scoreOne, one), scoreOne);
+            const F newScoreTwo = L::Select(missOne, L::Add(scoreTwo, one), scoreTwo);
+
+            // wall bounce; like Update it keeps the integrated x, dropping a paddle snap
+            const M wallTop = L::Le(ballY, L::Set(courtTop));
+            const M wallBottom = L::AndNot(wallTop, L::Ge(ballY, L::Set(courtBottom)));
+            const M wall = L::Or(wallTop, wallBottom);
+            outX = L::Select(wall, ballX, outX);
+            const F outY = L::Select(wallTop, L::Set(courtTop), L::Select(wallBottom, L::Set(courtBottom), ballY));
+            ballDY = L::Select(wall, L::Neg(ballDY), ballDY);
+
+            L::Store(&m_playerOneY[i], L::Select(active, paddleOne, L::Load(&m_playerOneY[i])));
+            L::Store(&m_playerTwoY[i], L::Select(active, paddleTwo, L::Load(&m_playerTwoY[i])));
+            L::Store(&m_ballX[i], L::Select(active, outX, L::Load(&m_ballX[i])));
+            L::Store(&m_ballY[i], L::Select(active, outY, L::Load(&m_ballY[i])));
+            L::Store(&m_ballDX[i], L::Select(active, ballDX, L::Load(&m_ballDX[i])));
+            L::Store(&m_ballDY[i], L::Select(active, ballDY, L::Load(&m_ballDY[i])));
+            L::Store(&m_playState[i], L::Select(active, state, L::Load(&m_playState[i])));
+            L::Store(&m_playerOneScore[i], L::Select(active, newScoreOne, scoreOne));
+            L::Store(&m_playerTwoScore[i], L::Select(active, newScoreTwo, scoreTwo));
+
+            const M stillActive = L::And(L::Lt(newScoreOne, maxScore), L::Lt(newScoreTwo, maxScore));
+            if (L::Any(L::AndNot(stillActive, active)))
+                m_anyFinished = true;
+        }
+    }
+
+    std::size_t m_matchCount;
+    std::uint_fast8_t m_maxScore;
+    bool m_anyFinished = false;
+
+    std::vector<float> m_ballX;
+    std::vector<float> m_ballY;
+    std::vector<float> m_ballDX;
+    std::vector<float> m_ballDY;
+    std::vector<float> m_playerOneY;
+    std::vector<float> m_playerTwoY;
+    std::vector<float> m_playerOneScore;
+    std::vector<float> m_playerTwoScore;
+    std::vector<float> m_playState;
+    std::vector<std::uint8_t> m_inputs;
+};
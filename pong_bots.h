@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "pong_ai.h"
+#include "pong_core.h"
+#include "replay.h"
+
+enum class POLICY : std::uint_fast8_t
+{
+    IDLE,
+    TRACK,
+    RANDOM,
+    CPU,
+    RECORDED
+};
+
+struct PaddleCommand
+{
+    bool up = false;
+    bool down = false;
+    bool serve = false;
+};
+
+// One player's keys from a recorded match, a command per tick, played back
+// open loop whichever side the bot is on; loops once it runs out.
+class RecordedPaddle
+{
+public:
+    bool Load(const std::string& path, const bool playerOne)
+    {
+        ReplayReader reader;
+        if (!reader.Load(path))
+            return false;
+
+        m_commands.clear();
+        ReplayStep steps[REPLAY_MAX_STEPS_PER_TICK];
+        std::size_t count;
+        while (reader.NextTick(steps, count))
+        {
+            // a tick split into steps counts as the keys it started with
+            PaddleCommand command;
+            if (count > 0)
+            {
+                const PongInput& input = steps[0].input;
+                command.up = playerOne ? input.playerOneUp : input.playerTwoUp;
+                command.down = playerOne ? input.playerOneDown : input.playerTwoDown;
+                command.serve = input.serve;
+            }
+            m_commands.push_back(command);
+        }
+        return !m_commands.empty();
+    }
+
+    const PaddleCommand& Get(const std::uint64_t tick) const
+    {
+        return m_commands[tick % m_commands.size()];
+    }
+
+private:
+    std::vector<PaddleCommand> m_commands;
+};
+
+// bot driving one paddle from the simulation state; a RECORDED bot needs a
+// recording that outlives it
+class PaddleController
+{
+public:
+    PaddleController(const POLICY policy, const bool isPlayerOne, const std::uint32_t seed, const CpuSettings& cpuSettings,
+        const RecordedPaddle* recording = nullptr)
+        :
+        m_policy(policy),
+        m_isPlayerOne(isPlayerOne),
+        m_random(seed),
+        m_cpu(isPlayerOne, cpuSettings, seed),
+        m_recording(recording),
+        m_tick(0)
+    {
+    }
+
+    // the tick Decide is called for, which sets the CPU's reaction time
+    void SetTickMilliseconds(const float milliseconds)
+    {
+        m_cpu.SetTickMilliseconds(milliseconds);
+    }
+
+    PaddleCommand Decide(const PongSimulation& simulation)
+    {
+        PaddleCommand command;
+
+        switch (m_policy)
+        {
+        case POLICY::TRACK:
+        {
+            const RectangleShape& paddle = m_isPlayerOne ?
+                simulation.GetPlayerOne().GetPositionSize() :
+                simulation.GetPlayerTwo().GetPositionSize();
+            const PLAY_STATE playState = simulation.GetPlayState();
+            const bool incoming = playState == (m_isPlayerOne ? PLAY_STATE::TOWARD_PLAYER_ONE : PLAY_STATE::TOWARD_PLAYER_TWO);
+
+            float target = WINDOW_HEIGHT / 2;
+            if (incoming)
+                target = simulation.GetBall().GetPosition().y;
+
+            const float center = paddle.y + PADDLE_LENGTH / 2;
+            if (center < target - PADDLE_LENGTH / 4)
+                command.down = true;
+            else if (center > target + PADDLE_LENGTH / 4)
+                command.up = true;
+
+            command.serve = playState == (m_isPlayerOne ? PLAY_STATE::SERVE_PLAYER_ONE : PLAY_STATE::SERVE_PLAYER_TWO);
+            break;
+        }
+        case POLICY::RANDOM:
+        {
+            const std::uint32_t roll = m_random() % 8;
+            command.up = roll == 0;
+            command.down = roll == 1;
+            command.serve = roll == 2;
+            break;
+        }
+        case POLICY::CPU:
+        {
+            PongInput input;
+            m_cpu.Drive(simulation, input);
+            command.up = m_isPlayerOne ? input.playerOneUp : input.playerTwoUp;
+            command.down = m_isPlayerOne ? input.playerOneDown : input.playerTwoDown;
+            command.serve = input.serve;
+            break;
+        }
+        case POLICY::RECORDED:
+            if (m_recording != nullptr)
+                command = m_recording->Get(m_tick);
+            break;
+        default:
+            break;
+        }
+
+        ++m_tick;
+        return command;
+    }
+
+    // both bots' commands as one tick's input; only the server's serve counts
+    static PongInput Combine(const PongSimulation& simulation, const PaddleCommand& playerOne, const PaddleCommand& playerTwo)
+    {
+        const PLAY_STATE playState = simulation.GetPlayState();
+        PongInput input;
+        input.playerOneUp = playerOne.up;
+        input.playerOneDown = playerOne.down;
+        input.playerTwoUp = playerTwo.up;
+        input.playerTwoDown = playerTwo.down;
+        input.serve = (playState == PLAY_STATE::SERVE_PLAYER_ONE && playerOne.serve) ||
+            (playState == PLAY_STATE::SERVE_PLAYER_TWO && playerTwo.serve);
+        return input;
+    }
+
+private:
+    POLICY m_policy;
+    bool m_isPlayerOne;
+    std::minstd_rand m_random;
+    CpuOpponent m_cpu;
+    const RecordedPaddle* m_recording;
+    std::uint64_t m_tick;
+};
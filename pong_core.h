@@ -0,0 +1,924 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+const std::uint16_t WINDOW_WIDTH = 1600;
+const std::uint16_t WINDOW_HEIGHT = 900;
+
+const float UPDATE_MS = 33;
+// the fastest tick --tick-rate allows, 1000 Hz
+const float MIN_UPDATE_MS = 1;
+
+const float BALL_RADIUS = 10;
+const float BALL_VELOCITY = 400;
+const float BALL_VEL_INCR = 60;
+
+const float PADDLE_WIDTH = 10;
+const float PADDLE_LENGTH = 50;
+const float PADDLE_PADDING = 20;
+const float PADDLE_SPEED = 400;
+
+const float COURT_MARGIN = 10;
+const float COURT_OUTLINE_WIDTH = 5;
+
+enum class GAME_STATE : std::uint_fast8_t
+{
+    MENU,
+    IN_GAME,
+    EXIT
+};
+
+// How PongSimulation advances a step: Update's per-tick float math, exact
+// collision times (UpdateExact), or integer math that gives bit-identical
+// results on every compiler and FPU (UpdateFixed).
+enum class PHYSICS : std::uint_fast8_t
+{
+    TICK,
+    EXACT,
+    FIXED_POINT
+};
+
+enum class PLAY_STATE : std::uint_fast8_t
+{
+    SERVE_PLAYER_ONE,
+    SERVE_PLAYER_TWO,
+    TOWARD_PLAYER_ONE,
+    TOWARD_PLAYER_TWO
+};
+
+// Everything about a match that changes while it is played, packed into
+// half a cache line and aligned so it never straddles one. Search code keeps
+// its tree of these: branching is a 32-byte copy, and PongSimulation's Fork
+// and Restore move one in and out of a simulation to step it.
+struct alignas(32) PongState
+{
+    float ballX;
+    float ballY;
+    float ballVelocityX;
+    float ballVelocityY;
+    float playerOneY;
+    float playerTwoY;
+    std::uint8_t playerOneScore;
+    std::uint8_t playerTwoScore;
+    std::uint8_t maxScore;
+    PLAY_STATE playState;
+};
+
+static_assert(std::is_trivially_copyable<PongState>::value && sizeof(PongState) == 32, "PongState must stay one trivially copied half line");
+
+struct Vector2D
+{
+    float x;
+    float y;
+};
+
+struct RectangleShape
+{
+    float x;
+    float y;
+    float width;
+    float height;
+};
+
+// controls held during one simulation tick
+struct PongInput
+{
+    bool playerOneUp = false;
+    bool playerOneDown = false;
+    bool playerTwoUp = false;
+    bool playerTwoDown = false;
+    bool serve = false;
+
+    enum BIT : std::uint8_t
+    {
+        PLAYER_ONE_UP = 1 << 0,
+        PLAYER_ONE_DOWN = 1 << 1,
+        PLAYER_TWO_UP = 1 << 2,
+        PLAYER_TWO_DOWN = 1 << 3,
+        SERVE = 1 << 4
+    };
+
+    std::uint8_t ToBits() const
+    {
+        return (playerOneUp ? PLAYER_ONE_UP : 0) |
+            (playerOneDown ? PLAYER_ONE_DOWN : 0) |
+            (playerTwoUp ? PLAYER_TWO_UP : 0) |
+            (playerTwoDown ? PLAYER_TWO_DOWN : 0) |
+            (serve ? SERVE : 0);
+    }
+
+    static PongInput FromBits(const std::uint8_t bits)
+    {
+        PongInput input;
+        input.playerOneUp = (bits & PLAYER_ONE_UP) != 0;
+        input.playerOneDown = (bits & PLAYER_ONE_DOWN) != 0;
+        input.playerTwoUp = (bits & PLAYER_TWO_UP) != 0;
+        input.playerTwoDown = (bits & PLAYER_TWO_DOWN) != 0;
+        input.serve = (bits & SERVE) != 0;
+        return input;
+    }
+};
+
+class Court
+{
+public:
+    Court(const RectangleShape dimensions)
+        :
+        m_dimensions(dimensions)
+    {
+
+    }
+
+    const RectangleShape& GetDimensions() const
+    {
+        return m_dimensions;
+    }
+
+private:
+    RectangleShape m_dimensions;
+};
+
+class Paddle
+{
+public:
+    Paddle(const RectangleShape startingPosition)
+        :
+        m_rect(startingPosition)
+    {
+    }
+
+    const RectangleShape& GetPositionSize() const
+    {
+        return m_rect;
+    }
+
+    void SetPositionSize(const RectangleShape newPositionSize)
+    {
+        m_rect = newPositionSize;
+    }
+
+    void SetPosition(const Vector2D newPosition)
+    {
+        m_rect.x = newPosition.x;
+        m_rect.y = newPosition.y;
+    }
+
+private:
+    RectangleShape m_rect;
+};
+
+class Ball
+{
+public:
+    Ball(const Vector2D startPosition, const float radius)
+        :
+        m_position(startPosition),
+        m_radius(radius),
+        m_velocity({ 0,0 })
+    {
+    }
+
+    const Vector2D& GetPosition() const
+    {
+        return m_position;
+    }
+
+    const float& GetRadius() const
+    {
+        return m_radius;
+    }
+
+    const Vector2D& GetVelocity() const
+    {
+        return m_velocity;
+    }
+
+    void SetPosition(const Vector2D newPosition)
+    {
+        m_position = newPosition;
+    }
+
+    void SetVelocity(const Vector2D newVelocity)
+    {
+        m_velocity = newVelocity;
+    }
+
+private:
+    Vector2D m_position;
+    float m_radius;
+    Vector2D m_velocity;
+};
+
+// window-free pong rules: paddles, ball, scoring and serve state
+class PongSimulation
+{
+public:
+    PongSimulation(const std::uint_fast8_t scoreToWin)
+        :
+        m_playerOneScore(0),
+        m_playerTwoScore(0),
+        m_maxScore(scoreToWin),
+        m_court({
+            COURT_MARGIN,
+            COURT_MARGIN,
+            WINDOW_WIDTH - COURT_MARGIN * 2,
+            WINDOW_HEIGHT - COURT_MARGIN * 2
+            }),
+        m_ball({
+                WINDOW_WIDTH / 2,
+                WINDOW_HEIGHT / 2
+            },
+            BALL_RADIUS
+        ),
+        m_playerOne({
+            COURT_MARGIN + PADDLE_PADDING,
+            WINDOW_HEIGHT / 2 - (PADDLE_LENGTH / 2),
+            PADDLE_WIDTH,
+            PADDLE_LENGTH
+            }),
+        m_playerTwo({
+            WINDOW_WIDTH - COURT_MARGIN - PADDLE_PADDING - PADDLE_WIDTH,
+            WINDOW_HEIGHT / 2 - (PADDLE_LENGTH / 2),
+            PADDLE_WIDTH,
+            PADDLE_LENGTH
+            }),
+        m_playState(PLAY_STATE::SERVE_PLAYER_ONE)
+    {
+    }
+
+    GAME_STATE Update(const float elapsedMilliseconds, const PongInput& input)
+    {
+        float timeMultiplier = elapsedMilliseconds / 1000.0f;
+
+        const RectangleShape& paddle1 = m_playerOne.GetPositionSize();
+        const RectangleShape& paddle2 = m_playerTwo.GetPositionSize();
+
+        if (input.playerOneUp)
+            m_playerOne.SetPosition({ paddle1.x,paddle1.y - PADDLE_SPEED * timeMultiplier });
+        if (input.playerOneDown)
+            m_playerOne.SetPosition({ paddle1.x,paddle1.y + PADDLE_SPEED * timeMultiplier });
+
+        if (input.playerTwoUp)
+            m_playerTwo.SetPosition({ paddle2.x,paddle2.y - PADDLE_SPEED * timeMultiplier });
+        if (input.playerTwoDown)
+            m_playerTwo.SetPosition({ paddle2.x,paddle2.y + PADDLE_SPEED * timeMultiplier });
+
+        switch (m_playState)
+        {
+        case PLAY_STATE::SERVE_PLAYER_ONE:
+        {
+            m_ball.SetVelocity({ 0,0 });
+            const RectangleShape& paddle = m_playerOne.GetPositionSize();
+            m_ball.SetPosition({ paddle.x + PADDLE_WIDTH,paddle.y + PADDLE_LENGTH / 2 });
+
+            if (input.serve)
+            {
+                m_ball.SetVelocity({ BALL_VELOCITY,0 });
+                m_playState = PLAY_STATE::TOWARD_PLAYER_TWO;
+            }
+            break;
+        }
+        case PLAY_STATE::SERVE_PLAYER_TWO:
+        {
+            m_ball.SetVelocity({ 0,0 });
+            const RectangleShape& paddle = m_playerTwo.GetPositionSize();
+            m_ball.SetPosition({ paddle.x - BALL_RADIUS,paddle.y + PADDLE_LENGTH / 2 });
+
+            if (input.serve)
+            {
+                m_ball.SetVelocity({ -BALL_VELOCITY,0 });
+                m_playState = PLAY_STATE::TOWARD_PLAYER_ONE;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        Vector2D ballPos = m_ball.GetPosition();
+        Vector2D ballVelocity = m_ball.GetVelocity();
+        const RectangleShape& courtShape = m_court.GetDimensions();
+
+        ballPos.x += ballVelocity.x * timeMultiplier;
+        ballPos.y += ballVelocity.y * timeMultiplier;
+
+        m_ball.SetPosition(ballPos);
+
+        switch (m_playState)
+        {
+        case PLAY_STATE::TOWARD_PLAYER_ONE:
+        {
+            if (ballPos.x - BALL_RADIUS > paddle1.x + PADDLE_WIDTH)
+                break; // ball hasn't reached player 1
+
+            if (ballPos.y + BALL_RADIUS >= paddle1.y && ballPos.y - BALL_RADIUS <= paddle1.y + PADDLE_LENGTH)
+            {
+                m_ball.SetPosition({ paddle1.x + PADDLE_WIDTH + BALL_RADIUS + 1, ballPos.y });
+
+                ballVelocity.x = -ballVelocity.x;
+
+                if (ballPos.y + BALL_RADIUS <= paddle1.y + PADDLE_LENGTH / 3)
+                    ballVelocity.y -= BALL_VELOCITY / 2;
+                else if (ballPos.y - BALL_RADIUS >= paddle1.y + PADDLE_LENGTH / 3 * 2)
+                    ballVelocity.y += BALL_VELOCITY / 2;
+
+                if (ballVelocity.x > 0)
+                    ballVelocity.x += BALL_VEL_INCR;
+                else
+                    ballVelocity.x -= BALL_VEL_INCR;
+
+                if (ballVelocity.y > 0)
+                    ballVelocity.y += BALL_VEL_INCR;
+                else
+                    ballVelocity.y -= BALL_VEL_INCR;
+
+                m_ball.SetVelocity(ballVelocity);
+                m_playState = PLAY_STATE::TOWARD_PLAYER_TWO;
+
+                break;
+            }
+
+            if (ballPos.x + BALL_RADIUS < paddle1.x)
+            {
+                ++m_playerTwoScore;
+                m_playState = PLAY_STATE::SERVE_PLAYER_ONE;
+            }
+
+            break;
+        }
+        case PLAY_STATE::TOWARD_PLAYER_TWO:
+        {
+            if (ballPos.x + BALL_RADIUS < paddle2.x)
+                break;
+
+            if (ballPos.y + BALL_RADIUS >= paddle2.y && ballPos.y - BALL_RADIUS <= paddle2.y + PADDLE_LENGTH)
+            {
+                m_ball.SetPosition({ paddle2.x - BALL_RADIUS - 1, ballPos.y });
+
+                ballVelocity.x = -ballVelocity.x;
+
+                if (ballPos.y + BALL_RADIUS <= paddle2.y + PADDLE_LENGTH / 3)
+                    ballVelocity.y -= BALL_VELOCITY / 2;
+                else if (ballPos.y - BALL_RADIUS >= paddle2.y + PADDLE_LENGTH / 3 * 2)
+                    ballVelocity.y += BALL_VELOCITY / 2;
+
+                if (ballVelocity.x > 0)
+                    ballVelocity.x += BALL_VEL_INCR;
+                else
+                    ballVelocity.x -= BALL_VEL_INCR;
+
+                if (ballVelocity.y > 0)
+                    ballVelocity.y += BALL_VEL_INCR;
+                else
+                    ballVelocity.y -= BALL_VEL_INCR;
+
+                m_ball.SetVelocity(ballVelocity);
+                m_playState = PLAY_STATE::TOWARD_PLAYER_ONE;
+
+                break;
+            }
+
+            if (ballPos.x - BALL_RADIUS > paddle2.x + PADDLE_WIDTH)
+            {
+                ++m_playerOneScore;
+                m_playState = PLAY_STATE::SERVE_PLAYER_TWO;
+            }
+
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (ballPos.y <= courtShape.y)
+        {
+            m_ball.SetPosition({ ballPos.x,courtShape.y });
+            m_ball.SetVelocity({ ballVelocity.x,-ballVelocity.y });
+        }
+        else if (ballPos.y >= courtShape.y + courtShape.height)
+        {
+            m_ball.SetPosition({ ballPos.x,courtShape.y + courtShape.height });
+            m_ball.SetVelocity({ ballVelocity.x,-ballVelocity.y });
+        }
+
+        if (m_playerOneScore >= m_maxScore || m_playerTwoScore >= m_maxScore)
+            return GAME_STATE::MENU;
+
+        return GAME_STATE::IN_GAME;
+    }
+
+    // Event-driven alternative to Update. Paddles and ball move along straight
+    // lines and the next wall, paddle or goal crossing is found analytically,
+    // so nothing can tunnel however fast the ball gets. Simulates up to
+    // milliseconds but stops right after the first event; milliseconds is set
+    // to the time actually simulated so the caller can sample new input.
+    GAME_STATE Advance(float& milliseconds, const PongInput& input)
+    {
+        const float maxSeconds = milliseconds / 1000.0f;
+        const float paddleOneSpeed = PaddleSpeed(input.playerOneUp, input.playerOneDown);
+        const float paddleTwoSpeed = PaddleSpeed(input.playerTwoUp, input.playerTwoDown);
+        const RectangleShape& paddle1 = m_playerOne.GetPositionSize();
+        const RectangleShape& paddle2 = m_playerTwo.GetPositionSize();
+
+        if (m_playState == PLAY_STATE::SERVE_PLAYER_ONE || m_playState == PLAY_STATE::SERVE_PLAYER_TWO)
+        {
+            const bool playerOneServes = m_playState == PLAY_STATE::SERVE_PLAYER_ONE;
+            if (!input.serve)
+            {
+                // nothing can happen until someone serves
+                MovePaddles(paddleOneSpeed, paddleTwoSpeed, maxSeconds);
+                const RectangleShape& paddle = playerOneServes ? paddle1 : paddle2;
+                m_ball.SetPosition({ playerOneServes ? paddle.x + PADDLE_WIDTH : paddle.x - BALL_RADIUS,paddle.y + PADDLE_LENGTH / 2 });
+                m_ball.SetVelocity({ 0,0 });
+                return GAME_STATE::IN_GAME;
+            }
+
+            const RectangleShape& paddle = playerOneServes ? paddle1 : paddle2;
+            m_ball.SetPosition({ playerOneServes ? paddle.x + PADDLE_WIDTH : paddle.x - BALL_RADIUS,paddle.y + PADDLE_LENGTH / 2 });
+            m_ball.SetVelocity({ playerOneServes ? BALL_VELOCITY : -BALL_VELOCITY,0 });
+            m_playState = playerOneServes ? PLAY_STATE::TOWARD_PLAYER_TWO : PLAY_STATE::TOWARD_PLAYER_ONE;
+        }
+
+        const Vector2D ballPos = m_ball.GetPosition();
+        const Vector2D ballVelocity = m_ball.GetVelocity();
+        const RectangleShape& courtShape = m_court.GetDimensions();
+
+        // a ball served from a paddle outside the court is pulled back in at once
+        float wallTime = NO_EVENT;
+        if (ballPos.y < courtShape.y || ballPos.y > courtShape.y + courtShape.height)
+            wallTime = 0;
+        else if (ballVelocity.y < 0)
+            wallTime = TimeUntil(courtShape.y - ballPos.y, ballVelocity.y);
+        else if (ballVelocity.y > 0)
+            wallTime = TimeUntil(courtShape.y + courtShape.height - ballPos.y, ballVelocity.y);
+
+        const bool towardOne = m_playState == PLAY_STATE::TOWARD_PLAYER_ONE;
+        const RectangleShape& paddle = towardOne ? paddle1 : paddle2;
+        const float paddleSpeed = towardOne ? paddleOneSpeed : paddleTwoSpeed;
+
+        // the ball can touch the paddle from the moment its edge crosses the
+        // paddle face until it is fully behind the paddle, which is a goal
+        const float faceX = towardOne ? paddle.x + PADDLE_WIDTH + BALL_RADIUS : paddle.x - BALL_RADIUS;
+        const float goalX = towardOne ? paddle.x - BALL_RADIUS : paddle.x + PADDLE_WIDTH + BALL_RADIUS;
+        const float faceTime = TimeUntil(faceX - ballPos.x, ballVelocity.x);
+        const float goalTime = TimeUntil(goalX - ballPos.x, ballVelocity.x);
+        const float hitTime = ContactTime(ballPos.y - paddle.y, ballVelocity.y - paddleSpeed, faceTime, goalTime);
+
+        float eventTime = maxSeconds;
+        if (wallTime < eventTime)
+            eventTime = wallTime;
+        if (hitTime < eventTime)
+            eventTime = hitTime;
+        if (goalTime < eventTime)
+            eventTime = goalTime;
+
+        MovePaddles(paddleOneSpeed, paddleTwoSpeed, eventTime);
+        Vector2D newPos = { ballPos.x + ballVelocity.x * eventTime,ballPos.y + ballVelocity.y * eventTime };
+        Vector2D newVelocity = ballVelocity;
+
+        if (hitTime == eventTime)
+        {
+            newVelocity = Deflect(ballVelocity, newPos.y, paddle.y);
+            newPos.x = towardOne ? paddle.x + PADDLE_WIDTH + BALL_RADIUS + 1 : paddle.x - BALL_RADIUS - 1;
+            m_playState = towardOne ? PLAY_STATE::TOWARD_PLAYER_TWO : PLAY_STATE::TOWARD_PLAYER_ONE;
+        }
+        else if (goalTime == eventTime)
+        {
+            if (towardOne)
+            {
+                ++m_playerTwoScore;
+                m_playState = PLAY_STATE::SERVE_PLAYER_ONE;
+            }
+            else
+            {
+                ++m_playerOneScore;
+                m_playState = PLAY_STATE::SERVE_PLAYER_TWO;
+            }
+        }
+
+        if (wallTime == eventTime)
+        {
+            // bounce off whichever wall was reached, always back into the court
+            const bool topWall = newPos.y <= courtShape.y + courtShape.height / 2;
+            newPos.y = topWall ? courtShape.y : courtShape.y + courtShape.height;
+            newVelocity.y = topWall ? std::fabs(newVelocity.y) : -std::fabs(newVelocity.y);
+        }
+
+        m_ball.SetPosition(newPos);
+        m_ball.SetVelocity(newVelocity);
+        milliseconds = eventTime * 1000.0f;
+
+        if (m_playerOneScore >= m_maxScore || m_playerTwoScore >= m_maxScore)
+            return GAME_STATE::MENU;
+
+        return GAME_STATE::IN_GAME;
+    }
+
+    // drop-in for Update that resolves every event inside the step exactly
+    GAME_STATE UpdateExact(const float elapsedMilliseconds, const PongInput& input)
+    {
+        float remaining = elapsedMilliseconds;
+        PongInput stepInput = input;
+        while (true)
+        {
+            float step = remaining;
+            const GAME_STATE gameState = Advance(step, stepInput);
+            remaining -= step;
+            if (gameState != GAME_STATE::IN_GAME || remaining <= 0)
+                return gameState;
+
+            // a serve is a press, not a hold; don't relaunch after a goal
+            stepInput.serve = false;
+        }
+    }
+
+    // Update in integer arithmetic. Positions and velocities are whole
+    // numbers of 1/FIXED_SCALE pixels (per second); they are kept in the float
+    // fields, which hold such values exactly, so floating point only ever
+    // stores results and never computes them. The rules are Update's.
+    GAME_STATE UpdateFixed(const float elapsedMilliseconds, const PongInput& input)
+    {
+        const std::int64_t time = ToFixed(elapsedMilliseconds);
+        const std::int32_t paddleStep = Travel(ToFixed(PADDLE_SPEED), time);
+
+        const std::int32_t paddleOneX = ToFixed(m_playerOne.GetPositionSize().x);
+        const std::int32_t paddleTwoX = ToFixed(m_playerTwo.GetPositionSize().x);
+        std::int32_t paddleOneY = ToFixed(m_playerOne.GetPositionSize().y);
+        std::int32_t paddleTwoY = ToFixed(m_playerTwo.GetPositionSize().y);
+        if (input.playerOneUp)
+            paddleOneY = ClampFixed(paddleOneY - static_cast<std::int64_t>(paddleStep));
+        if (input.playerOneDown)
+            paddleOneY = ClampFixed(paddleOneY + static_cast<std::int64_t>(paddleStep));
+        if (input.playerTwoUp)
+            paddleTwoY = ClampFixed(paddleTwoY - static_cast<std::int64_t>(paddleStep));
+        if (input.playerTwoDown)
+            paddleTwoY = ClampFixed(paddleTwoY + static_cast<std::int64_t>(paddleStep));
+        m_playerOne.SetPosition({ FromFixed(paddleOneX),FromFixed(paddleOneY) });
+        m_playerTwo.SetPosition({ FromFixed(paddleTwoX),FromFixed(paddleTwoY) });
+
+        const std::int32_t radius = ToFixed(BALL_RADIUS);
+        const std::int32_t width = ToFixed(PADDLE_WIDTH);
+        const std::int32_t length = ToFixed(PADDLE_LENGTH);
+
+        std::int32_t x = ToFixed(m_ball.GetPosition().x);
+        std::int32_t y = ToFixed(m_ball.GetPosition().y);
+        std::int32_t velocityX = ToFixed(m_ball.GetVelocity().x);
+        std::int32_t velocityY = ToFixed(m_ball.GetVelocity().y);
+
+        switch (m_playState)
+        {
+        case PLAY_STATE::SERVE_PLAYER_ONE:
+            velocityX = 0;
+            velocityY = 0;
+            x = paddleOneX + width;
+            y = paddleOneY + length / 2;
+            if (input.serve)
+            {
+                velocityX = ToFixed(BALL_VELOCITY);
+                m_playState = PLAY_STATE::TOWARD_PLAYER_TWO;
+            }
+            break;
+        case PLAY_STATE::SERVE_PLAYER_TWO:
+            velocityX = 0;
+            velocityY = 0;
+            x = paddleTwoX - radius;
+            y = paddleTwoY + length / 2;
+            if (input.serve)
+            {
+                velocityX = -ToFixed(BALL_VELOCITY);
+                m_playState = PLAY_STATE::TOWARD_PLAYER_ONE;
+            }
+            break;
+        default:
+            break;
+        }
+
+        x = ClampFixed(x + static_cast<std::int64_t>(Travel(velocityX, time)));
+        y = ClampFixed(y + static_cast<std::int64_t>(Travel(velocityY, time)));
+
+        // as in Update, a paddle hit moves the ball clear of the paddle, but a
+        // wall bounce in the same tick puts it back at the pre-hit x
+        std::int32_t storedX = x;
+
+        switch (m_playState)
+        {
+        case PLAY_STATE::TOWARD_PLAYER_ONE:
+        {
+            if (x - radius > paddleOneX + width)
+                break;
+
+            if (y + radius >= paddleOneY && y - radius <= paddleOneY + length)
+            {
+                storedX = paddleOneX + width + radius + FIXED_SCALE;
+                DeflectFixed(velocityX, velocityY, y, paddleOneY);
+                m_playState = PLAY_STATE::TOWARD_PLAYER_TWO;
+                break;
+            }
+
+            if (x + radius < paddleOneX)
+            {
+                ++m_playerTwoScore;
+                m_playState = PLAY_STATE::SERVE_PLAYER_ONE;
+            }
+            break;
+        }
+        case PLAY_STATE::TOWARD_PLAYER_TWO:
+        {
+            if (x + radius < paddleTwoX)
+                break;
+
+            if (y + radius >= paddleTwoY && y - radius <= paddleTwoY + length)
+            {
+                storedX = paddleTwoX - radius - FIXED_SCALE;
+                DeflectFixed(velocityX, velocityY, y, paddleTwoY);
+                m_playState = PLAY_STATE::TOWARD_PLAYER_ONE;
+                break;
+            }
+
+            if (x - radius > paddleTwoX + width)
+            {
+                ++m_playerOneScore;
+                m_playState = PLAY_STATE::SERVE_PLAYER_TWO;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        const RectangleShape& courtShape = m_court.GetDimensions();
+        const std::int32_t top = ToFixed(courtShape.y);
+        const std::int32_t bottom = top + ToFixed(courtShape.height);
+        if (y <= top)
+        {
+            storedX = x;
+            y = top;
+            velocityY = -velocityY;
+        }
+        else if (y >= bottom)
+        {
+            storedX = x;
+            y = bottom;
+            velocityY = -velocityY;
+        }
+
+        m_ball.SetPosition({ FromFixed(storedX),FromFixed(y) });
+        m_ball.SetVelocity({ FromFixed(velocityX),FromFixed(velocityY) });
+
+        if (m_playerOneScore >= m_maxScore || m_playerTwoScore >= m_maxScore)
+            return GAME_STATE::MENU;
+
+        return GAME_STATE::IN_GAME;
+    }
+
+    // one step in the given physics mode
+    GAME_STATE Step(const PHYSICS physics, const float elapsedMilliseconds, const PongInput& input)
+    {
+        switch (physics)
+        {
+        case PHYSICS::EXACT:
+            return UpdateExact(elapsedMilliseconds, input);
+        case PHYSICS::FIXED_POINT:
+            return UpdateFixed(elapsedMilliseconds, input);
+        default:
+            return Update(elapsedMilliseconds, input);
+        }
+    }
+
+    void Reset()
+    {
+        *this = PongSimulation(m_maxScore);
+    }
+
+    // the evolving state, for a search to branch from
+    PongState Fork() const
+    {
+        PongState state;
+        state.ballX = m_ball.GetPosition().x;
+        state.ballY = m_ball.GetPosition().y;
+        state.ballVelocityX = m_ball.GetVelocity().x;
+        state.ballVelocityY = m_ball.GetVelocity().y;
+        state.playerOneY = m_playerOne.GetPositionSize().y;
+        state.playerTwoY = m_playerTwo.GetPositionSize().y;
+        state.playerOneScore = static_cast<std::uint8_t>(m_playerOneScore);
+        state.playerTwoScore = static_cast<std::uint8_t>(m_playerTwoScore);
+        state.maxScore = static_cast<std::uint8_t>(m_maxScore);
+        state.playState = m_playState;
+        return state;
+    }
+
+    // puts back a forked state; the next step matches the one the forked simulation would take
+    void Restore(const PongState& state)
+    {
+        m_ball.SetPosition({ state.ballX,state.ballY });
+        m_ball.SetVelocity({ state.ballVelocityX,state.ballVelocityY });
+        m_playerOne.SetPosition({ m_playerOne.GetPositionSize().x,state.playerOneY });
+        m_playerTwo.SetPosition({ m_playerTwo.GetPositionSize().x,state.playerTwoY });
+        m_playerOneScore = state.playerOneScore;
+        m_playerTwoScore = state.playerTwoScore;
+        m_maxScore = state.maxScore;
+        m_playState = state.playState;
+    }
+
+    const Paddle& GetPlayerOne() const
+    {
+        return m_playerOne;
+    }
+
+    const Paddle& GetPlayerTwo() const
+    {
+        return m_playerTwo;
+    }
+
+    const Ball& GetBall() const
+    {
+        return m_ball;
+    }
+
+    const Court& GetCourt() const
+    {
+        return m_court;
+    }
+
+    const std::uint_fast8_t& GetPlayerOneScore() const
+    {
+        return m_playerOneScore;
+    }
+
+    const std::uint_fast8_t& GetPlayerTwoScore() const
+    {
+        return m_playerTwoScore;
+    }
+
+    const std::uint_fast8_t& GetMaxScore() const
+    {
+        return m_maxScore;
+    }
+
+    const PLAY_STATE& GetPlayState() const
+    {
+        return m_playState;
+    }
+
+    // FNV-1a over the state that evolves during a match, to compare runs
+    std::uint64_t Hash() const
+    {
+        const float values[] = {
+            m_ball.GetPosition().x,
+            m_ball.GetPosition().y,
+            m_ball.GetVelocity().x,
+            m_ball.GetVelocity().y,
+            m_playerOne.GetPositionSize().y,
+            m_playerTwo.GetPositionSize().y
+        };
+
+        std::uint64_t hash = 14695981039346656037ull;
+        const auto mix = [&hash](const std::uint32_t value)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                hash ^= (value >> (i * 8)) & 0xff;
+                hash *= 1099511628211ull;
+            }
+        };
+        for (const float value : values)
+        {
+            std::uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            mix(bits);
+        }
+        mix(m_playerOneScore);
+        mix(m_playerTwoScore);
+        mix(static_cast<std::uint32_t>(m_playState));
+        return hash;
+    }
+
+private:
+    static constexpr float NO_EVENT = std::numeric_limits<float>::infinity();
+
+    // UpdateFixed's units per pixel (and per millisecond for step lengths)
+    static const std::int32_t FIXED_SCALE = 256;
+    // floats hold every integer up to 2^24 exactly
+    static const std::int32_t FIXED_LIMIT = (1 << 24) - 1;
+
+    static std::int32_t ClampFixed(const std::int64_t value)
+    {
+        return static_cast<std::int32_t>(value < -FIXED_LIMIT ? -FIXED_LIMIT : value > FIXED_LIMIT ? FIXED_LIMIT : value);
+    }
+
+    // scaling by a power of two is exact and the conversion truncates, so
+    // equal floats give equal integers everywhere
+    static std::int32_t ToFixed(const float value)
+    {
+        const float scaled = value * FIXED_SCALE;
+        if (scaled <= -FIXED_LIMIT)
+            return -FIXED_LIMIT;
+        if (scaled >= FIXED_LIMIT)
+            return FIXED_LIMIT;
+        return static_cast<std::int32_t>(scaled);
+    }
+
+    static float FromFixed(const std::int32_t value)
+    {
+        return static_cast<float>(value) / FIXED_SCALE;
+    }
+
+    // distance covered at velocity (units per second) in time (1/FIXED_SCALE ms), rounded to nearest
+    static std::int32_t Travel(const std::int64_t velocity, const std::int64_t time)
+    {
+        const std::int64_t product = velocity * time;
+        const std::int64_t divisor = 1000 * FIXED_SCALE;
+        return ClampFixed((product + (product >= 0 ? divisor / 2 : -divisor / 2)) / divisor);
+    }
+
+    // Deflect in fixed point
+    static void DeflectFixed(std::int32_t& velocityX, std::int32_t& velocityY, const std::int32_t ballY, const std::int32_t paddleY)
+    {
+        const std::int32_t radius = ToFixed(BALL_RADIUS);
+        const std::int32_t third = ToFixed(PADDLE_LENGTH) / 3;
+        const std::int32_t spin = ToFixed(BALL_VELOCITY) / 2;
+        const std::int32_t increment = ToFixed(BALL_VEL_INCR);
+
+        velocityX = -velocityX;
+
+        if (ballY + radius <= paddleY + third)
+            velocityY -= spin;
+        else if (ballY - radius >= paddleY + third * 2)
+            velocityY += spin;
+
+        velocityX = ClampFixed(static_cast<std::int64_t>(velocityX) + (velocityX > 0 ? increment : -increment));
+        velocityY = ClampFixed(static_cast<std::int64_t>(velocityY) + (velocityY > 0 ? increment : -increment));
+    }
+
+    static float PaddleSpeed(const bool up, const bool down)
+    {
+        return (down ? PADDLE_SPEED : 0) - (up ? PADDLE_SPEED : 0);
+    }
+
+    // seconds until a gap closes at the given speed; negative gaps have already closed
+    static float TimeUntil(const float gap, const float speed)
+    {
+        if (speed == 0)
+            return NO_EVENT;
+        const float time = gap / speed;
+        return time > 0 ? time : 0;
+    }
+
+    // first time in [from, to] at which the ball's offset from the paddle top,
+    // moving at relativeSpeed, lies where the ball overlaps the paddle
+    static float ContactTime(const float offset, const float relativeSpeed, const float from, const float to)
+    {
+        if (from == NO_EVENT || from > to)
+            return NO_EVENT;
+
+        const float low = -BALL_RADIUS;
+        const float high = PADDLE_LENGTH + BALL_RADIUS;
+        const float start = offset + relativeSpeed * from;
+
+        float time = NO_EVENT;
+        if (start >= low && start <= high)
+            time = from;
+        else if (start < low && relativeSpeed > 0)
+            time = from + (low - start) / relativeSpeed;
+        else if (start > high && relativeSpeed < 0)
+            time = from + (high - start) / relativeSpeed;
+
+        return time <= to ? time : NO_EVENT;
+    }
+
+    void MovePaddles(const float paddleOneSpeed, const float paddleTwoSpeed, const float seconds)
+    {
+        const RectangleShape& paddle1 = m_playerOne.GetPositionSize();
+        const RectangleShape& paddle2 = m_playerTwo.GetPositionSize();
+        m_playerOne.SetPosition({ paddle1.x,paddle1.y + paddleOneSpeed * seconds });
+        m_playerTwo.SetPosition({ paddle2.x,paddle2.y + paddleTwoSpeed * seconds });
+    }
+
+    // same bounce as Update: reverse, add spin off the paddle thirds, speed up
+    static Vector2D Deflect(Vector2D velocity, const float ballY, const float paddleY)
+    {
+        velocity.x = -velocity.x;
+
+        if (ballY + BALL_RADIUS <= paddleY + PADDLE_LENGTH / 3)
+            velocity.y -= BALL_VELOCITY / 2;
+        else if (ballY - BALL_RADIUS >= paddleY + PADDLE_LENGTH / 3 * 2)
+            velocity.y += BALL_VELOCITY / 2;
+
+        velocity.x += velocity.x > 0 ? BALL_VEL_INCR : -BALL_VEL_INCR;
+        velocity.y += velocity.y > 0 ? BALL_VEL_INCR : -BALL_VEL_INCR;
+        return velocity;
+    }
+
+    std::uint_fast8_t m_playerOneScore;
+    std::uint_fast8_t m_playerTwoScore;
+    std::uint_fast8_t m_maxScore;
+    Court m_court;
+    Ball m_ball;
+    Paddle m_playerOne;
+    Paddle m_playerTwo;
+    PLAY_STATE m_playState;
+};
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "input_queue.h"
+#include "pong_ai.h"
+#include "pong_core.h"
+#include "replay.h"
+#include "rollback.h"
+#include "sound_cues.h"
+
+// The match as the game plays it: input, the CPU opponent, recording,
+// replays and sound cues around a PongSimulation. It draws nothing, so it
+// runs without a window; GameRenderer draws its previous and current states.
+class PongGame
+{
+public:
+    PongGame(const std::uint_fast8_t scoreToWin)
+        :
+        m_simulation(scoreToWin),
+        m_previous(scoreToWin),
+        m_scoreToWin(scoreToWin),
+        m_physics(PHYSICS::TICK),
+        m_livePhysics(PHYSICS::TICK),
+        m_replay(nullptr),
+        m_cpu(false, CpuSettings(), 1),
+        m_cpuEnabled(false),
+        m_sounds(nullptr),
+        m_tickMilliseconds(UPDATE_MS)
+    {
+    }
+
+    // Simulates the tick that ends at tickEnd. Control changes queued during
+    // the tick are applied from the moment they happened, splitting the tick.
+    // While a replay is playing, the tick comes from the recording instead.
+    GAME_STATE Update(const float elapsedMilliseconds, InputQueue& inputs, const InputQueue::Clock::time_point tickEnd)
+    {
+        m_previous = m_simulation;
+
+        if (m_replay != nullptr)
+        {
+            inputs.Flush();
+            return PlayReplayTick();
+        }
+
+        const bool recording = !m_recordPath.empty();
+        if (recording)
+            m_recorder.BeginTick();
+        const GAME_STATE gameState = Simulate(elapsedMilliseconds, inputs, tickEnd);
+        if (recording)
+            m_recorder.EndTick();
+
+        if (gameState != GAME_STATE::IN_GAME && recording)
+        {
+            if (m_recorder.Save(m_recordPath, m_simulation))
+                std::cout << "recorded match to " << m_recordPath << " (" << m_recorder.GetSize() << " bytes)" << std::endl;
+            else
+                std::cerr << "could not write replay " << m_recordPath << std::endl;
+        }
+        return gameState;
+    }
+
+    // Online tick: the session owns the simulation and rolls it back when the
+    // other player's input turns out different from its prediction; the game
+    // only feeds it local input and draws the latest state.
+    GAME_STATE UpdateNetplay(RollbackSession& session, InputQueue& inputs, const InputQueue::Clock::time_point tickEnd)
+    {
+        m_previous = m_simulation;
+
+        TimedInput change;
+        while (inputs.Pop(tickEnd, change))
+        {
+        }
+
+        if (!session.ShouldWait())
+            session.AdvanceFrame(RollbackSession::LocalBits(inputs.GetApplied()));
+        m_simulation = session.GetSimulation();
+        if (m_sounds != nullptr)
+            SoundCueState::Queue(SoundCueState::Capture(m_previous), SoundCueState::Capture(m_simulation), *m_sounds);
+
+        return session.IsFinished() ? GAME_STATE::MENU : GAME_STATE::IN_GAME;
+    }
+
+    PHYSICS GetPhysics() const
+    {
+        return m_physics;
+    }
+
+    // EXACT resolves collisions at their time of impact instead of per tick;
+    // FIXED_POINT plays the same on every machine, bit for bit
+    void SetPhysics(const PHYSICS physics)
+    {
+        m_physics = physics;
+    }
+
+    // the computer plays player two; its keys are ignored from then on
+    void SetCpuOpponent(const CpuSettings& settings)
+    {
+        m_cpu = CpuOpponent(false, settings, 1);
+        m_cpu.SetTickMilliseconds(m_tickMilliseconds);
+        m_cpuEnabled = true;
+    }
+
+    // the tick Update is called with, for the CPU's timing and the next
+    // recording; a recording already started stores other ticks step by step
+    void SetTickMilliseconds(const float milliseconds)
+    {
+        m_tickMilliseconds = milliseconds;
+        m_cpu.SetTickMilliseconds(milliseconds);
+    }
+
+    float GetTickMilliseconds() const
+    {
+        return m_tickMilliseconds;
+    }
+
+    // hits, bounces and goals are queued to sounds from here on
+    void SetSoundQueue(SoundQueue* sounds)
+    {
+        m_sounds = sounds;
+    }
+
+    // every match played is recorded and written to path when it ends
+    void SetRecordPath(const std::string& path)
+    {
+        m_recordPath = path;
+        BeginRecording();
+    }
+
+    // plays replay back in place of live input, one recorded tick per Update
+    void StartReplay(ReplayReader& replay)
+    {
+        const ReplayHeader& header = replay.GetHeader();
+        m_replay = &replay;
+        m_livePhysics = m_physics;
+        m_physics = header.GetPhysics();
+        m_simulation = PongSimulation(header.maxScore);
+        m_previous = m_simulation;
+    }
+
+    const PongSimulation& GetSimulation() const
+    {
+        return m_simulation;
+    }
+
+    // the state one tick before GetSimulation, for interpolation
+    const PongSimulation& GetPrevious() const
+    {
+        return m_previous;
+    }
+
+    void Reset()
+    {
+        m_simulation = PongSimulation(m_scoreToWin);
+        m_previous = m_simulation;
+        BeginRecording();
+    }
+
+private:
+    GAME_STATE Simulate(const float elapsedMilliseconds, InputQueue& inputs, const InputQueue::Clock::time_point tickEnd)
+    {
+        const InputQueue::Clock::time_point tickStart = tickEnd -
+            std::chrono::duration_cast<InputQueue::Clock::duration>(std::chrono::duration<float, std::milli>(elapsedMilliseconds));
+
+        // the CPU decides once per tick, from the state at its start
+        PongInput cpuInput;
+        if (m_cpuEnabled)
+            m_cpu.Drive(m_simulation, cpuInput);
+
+        PongInput input = WithCpu(inputs.GetApplied(), cpuInput);
+        float simulated = 0;
+        TimedInput change;
+        while (inputs.Pop(tickEnd, change))
+        {
+            float at = std::chrono::duration<float, std::milli>(change.time - tickStart).count();
+            if (at > elapsedMilliseconds)
+                at = elapsedMilliseconds;
+
+            if (at > simulated)
+            {
+                const GAME_STATE gameState = Step(at - simulated, input);
+                simulated = at;
+                if (gameState != GAME_STATE::IN_GAME)
+                    return gameState;
+            }
+            input = WithCpu(change.input, cpuInput);
+        }
+
+        if (elapsedMilliseconds > simulated)
+            return Step(elapsedMilliseconds - simulated, input);
+        return GAME_STATE::IN_GAME;
+    }
+
+    PongInput WithCpu(PongInput input, const PongInput& cpuInput) const
+    {
+        if (!m_cpuEnabled)
+            return input;
+        input.playerTwoUp = cpuInput.playerTwoUp;
+        input.playerTwoDown = cpuInput.playerTwoDown;
+        if (m_simulation.GetPlayState() == PLAY_STATE::SERVE_PLAYER_TWO)
+            input.serve = cpuInput.serve;
+        return input;
+    }
+
+    GAME_STATE PlayReplayTick()
+    {
+        std::size_t count;
+        if (!m_replay->NextTick(m_replaySteps, count))
+            return FinishReplay();
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (Step(m_replaySteps[i].milliseconds, m_replaySteps[i].input) != GAME_STATE::IN_GAME)
+                return FinishReplay();
+        }
+        return GAME_STATE::IN_GAME;
+    }
+
+    GAME_STATE FinishReplay()
+    {
+        std::size_t count;
+        while (m_replay->NextTick(m_replaySteps, count))
+        {
+        }
+
+        if (m_replay->Verify(m_simulation))
+            std::cout << "replay finished, final state matches recording" << std::endl;
+        else
+            std::cout << "replay finished, DESYNC: final state differs from recording" << std::endl;
+
+        m_replay = nullptr;
+        m_physics = m_livePhysics;
+        return GAME_STATE::MENU;
+    }
+
+    void BeginRecording()
+    {
+        ReplayHeader header;
+        header.SetPhysics(m_physics);
+        header.maxScore = m_scoreToWin;
+        header.tickMilliseconds = m_tickMilliseconds;
+        m_recorder.Begin(header);
+    }
+
+    GAME_STATE Step(const float elapsedMilliseconds, const PongInput& input)
+    {
+        if (m_replay == nullptr && !m_recordPath.empty())
+            m_recorder.RecordStep(elapsedMilliseconds, input);
+
+        if (m_sounds == nullptr)
+            return m_simulation.Step(m_physics, elapsedMilliseconds, input);
+
+        const SoundCueState before = SoundCueState::Capture(m_simulation);
+        const GAME_STATE gameState = m_simulation.Step(m_physics, elapsedMilliseconds, input);
+        SoundCueState::Queue(before, SoundCueState::Capture(m_simulation), *m_sounds);
+        return gameState;
+    }
+
+    PongSimulation m_simulation;
+    PongSimulation m_previous;
+    std::uint_fast8_t m_scoreToWin;
+    PHYSICS m_physics;
+    PHYSICS m_livePhysics;
+
+    ReplayRecorder m_recorder;
+    std::string m_recordPath;
+    ReplayReader* m_replay;
+    ReplayStep m_replaySteps[REPLAY_MAX_STEPS_PER_TICK];
+
+    CpuOpponent m_cpu;
+    bool m_cpuEnabled;
+
+    SoundQueue* m_sounds;
+    float m_tickMilliseconds;
+};
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// one finished zone; name must be a string literal or otherwise outlive the profiler
+struct ProfileRecord
+{
+    const char* name;
+    std::int64_t beginNanoseconds;
+    std::int64_t endNanoseconds;
+    std::uint32_t depth;
+};
+
+// Fixed-size ring of the zones one thread has finished. Only its own thread
+// pushes; any thread may read. The writer never waits: a reader that falls
+// more than CAPACITY records behind loses the oldest ones.
+class ProfileRing
+{
+public:
+    static const std::size_t CAPACITY = 1 << 14;
+
+    ProfileRing(const std::uint32_t id)
+        :
+        m_records(new ProfileRecord[CAPACITY]),
+        m_written(0),
+        m_id(id)
+    {
+    }
+
+    void Push(const ProfileRecord& record)
+    {
+        const std::uint64_t index = m_written.load(std::memory_order_relaxed);
+        m_records[index % CAPACITY] = record;
+        m_written.store(index + 1, std::memory_order_release);
+    }
+
+    // Appends the records written since cursor, oldest first, and moves the
+    // cursor past them. Returns how many were overwritten before they could be read.
+    std::uint64_t Read(std::uint64_t& cursor, std::vector<ProfileRecord>& out) const
+    {
+        const std::uint64_t written = m_written.load(std::memory_order_acquire);
+        std::uint64_t first = cursor;
+        std::uint64_t lost = 0;
+        if (written - first > CAPACITY)
+        {
+            lost = written - CAPACITY - first;
+            first = written - CAPACITY;
+        }
+
+        const std::size_t start = out.size();
+        for (std::uint64_t i = first; i < written; ++i)
+            out.push_back(m_records[i % CAPACITY]);
+
+        // the writer may have lapped the copy; drop whatever it overwrote
+        // meanwhile, including the slot of record after, which it may be
+        // writing right now
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const std::uint64_t after = m_written.load(std::memory_order_relaxed);
+        if (after + 1 - first > CAPACITY)
+        {
+            const std::uint64_t overwritten = std::min(after + 1 - CAPACITY - first, written - first);
+            out.erase(out.begin() + start, out.begin() + start + static_cast<std::ptrdiff_t>(overwritten));
+            lost += overwritten;
+        }
+
+        cursor = written;
+        return lost;
+    }
+
+    std::uint32_t GetId() const
+    {
+        return m_id;
+    }
+
+    const std::string& GetName() const
+    {
+        return m_name;
+    }
+
+    void SetName(const std::string& name)
+    {
+        m_name = name;
+    }
+
+private:
+    std::unique_ptr<ProfileRecord[]> m_records;
+    std::atomic<std::uint64_t> m_written;
+    std::uint32_t m_id;
+    std::string m_name;
+};
+
+// Process-wide zone collector. Each thread gets its own ring the first time
+// it records a zone; the rings live until exit so their zones can still be
+// exported after the thread is gone. Disabled, a zone costs one relaxed load.
+class Profiler
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static Profiler& Get()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    static bool IsEnabled()
+    {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    static void SetEnabled(const bool enabled)
+    {
+        s_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    // nanoseconds since the profiler was created
+    std::int64_t Now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_epoch).count();
+    }
+
+    // the calling thread's ring
+    ProfileRing& GetThreadRing()
+    {
+        thread_local ProfileRing* ring = nullptr;
+        if (ring == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_rings.emplace_back(new ProfileRing(static_cast<std::uint32_t>(m_rings.size() + 1)));
+            ring = m_rings.back().get();
+        }
+        return *ring;
+    }
+
+    // names the calling thread in exported traces
+    void SetThreadName(const std::string& name)
+    {
+        ProfileRing& ring = GetThreadRing();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ring.SetName(name);
+    }
+
+    // Writes every zone still held in the rings as Chrome trace event JSON,
+    // for chrome://tracing or ui.perfetto.dev.
+    bool WriteChromeTrace(const std::string& path)
+    {
+        std::ofstream file(path);
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<ProfileRecord> records;
+        bool first = true;
+        for (const std::unique_ptr<ProfileRing>& ring : m_rings)
+        {
+            const std::string name = ring->GetName().empty() ? "thread " + std::to_string(ring->GetId()) : ring->GetName();
+            file << (first ? "" : ",\n")
+                << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->GetId()
+                << ",\"args\":{\"name\":\"" << name << "\"}}";
+            first = false;
+
+            records.clear();
+            std::uint64_t cursor = 0;
+            ring->Read(cursor, records);
+            for (const ProfileRecord& record : records)
+            {
+                file << ",\n{\"name\":\"" << record.name
+                    << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->GetId()
+                    << ",\"ts\":" << record.beginNanoseconds / 1e3
+                    << ",\"dur\":" << (record.endNanoseconds - record.beginNanoseconds) / 1e3 << "}";
+            }
+        }
+        file << "\n]}\n";
+        return static_cast<bool>(file);
+    }
+
+private:
+    Profiler()
+        :
+        m_epoch(Clock::now())
+    {
+    }
+
+    inline static std::atomic<bool> s_enabled{ false };
+
+    Clock::time_point m_epoch;
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<ProfileRing>> m_rings;
+};
+
+// Times the enclosing scope into the current thread's ring while the
+// profiler is enabled. Zones nest; depth 0 is the outermost.
+class ProfileZone
+{
+public:
+    ProfileZone(const char* name)
+        :
+        m_name(name),
+        m_begin(-1)
+    {
+        if (!Profiler::IsEnabled())
+            return;
+        m_begin = Profiler::Get().Now();
+        ++s_depth;
+    }
+
+    ~ProfileZone()
+    {
+        if (m_begin < 0)
+            return;
+        Profiler& profiler = Profiler::Get();
+        --s_depth;
+        profiler.GetThreadRing().Push({ m_name, m_begin, profiler.Now(), s_depth });
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    inline static thread_local std::uint32_t s_depth = 0;
+
+    const char* m_name;
+    std::int64_t m_begin;
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "profiler.h"
+
+// On-screen view of the calling thread's zones: a graph of the last FRAMES
+// frame times, each bar split into the zones directly inside the frame zone,
+// and a table of last/mean/max milliseconds per zone two levels deep.
+class ProfilerOverlay
+{
+public:
+    static const std::size_t FRAMES = 240;
+    static const std::size_t MAX_ZONES = 12;
+
+    // frameZone names the depth-0 zone that wraps one whole frame
+    ProfilerOverlay(sf::RenderTarget& target, const sf::Font& font, const char* frameZone)
+        :
+        m_target(target),
+        m_frameZone(frameZone),
+        m_vertices(sf::Triangles),
+        m_font(font),
+        m_text("", font, TEXT_SIZE),
+        m_cursor(0),
+        m_next(0),
+        m_count(0),
+        m_zoneCount(0),
+        m_visible(false),
+        m_lost(0)
+    {
+        m_text.setFillColor(sf::Color::White);
+    }
+
+    bool IsVisible() const
+    {
+        return m_visible;
+    }
+
+    void Toggle()
+    {
+        m_visible = !m_visible;
+    }
+
+    // takes in the zones this thread has finished since the last call
+    void Collect()
+    {
+        m_records.clear();
+        m_lost += Profiler::Get().GetThreadRing().Read(m_cursor, m_records);
+
+        for (const ProfileRecord& record : m_records)
+        {
+            const float milliseconds = (record.endNanoseconds - record.beginNanoseconds) / 1e6f;
+            if (record.depth == 0 && std::strcmp(record.name, m_frameZone) == 0)
+            {
+                // children finish before their frame, so the pending sample is complete
+                m_pending.total = milliseconds;
+                m_frames[m_next] = m_pending;
+                m_next = (m_next + 1) % FRAMES;
+                if (m_count < FRAMES)
+                    ++m_count;
+                m_pending = FrameSample();
+            }
+            else if (record.depth == 1 || record.depth == 2)
+            {
+                const std::size_t zone = FindZone(record.name, record.depth);
+                if (zone < MAX_ZONES)
+                    m_pending.zones[zone] += milliseconds;
+            }
+        }
+    }
+
+    void Render()
+    {
+        if (!m_visible || m_count == 0)
+            return;
+
+        const sf::View view = m_target.getView();
+        m_target.setView(m_target.getDefaultView());
+
+        std::string table;
+        char line[96];
+        std::snprintf(line, sizeof(line), "%-16s %7s %7s %7s ms", "zone", "last", "mean", "max");
+        table += line;
+        AppendRow(table, m_frameZone, 0, MAX_ZONES);
+        for (std::size_t zone = 0; zone < m_zoneCount; ++zone)
+            AppendRow(table, m_zoneNames[zone], m_zoneDepths[zone], zone);
+        if (m_lost > 0)
+        {
+            std::snprintf(line, sizeof(line), "\n%llu zones dropped", static_cast<unsigned long long>(m_lost));
+            table += line;
+        }
+
+        const float baseline = PANEL_Y + PADDING + GRAPH_HEIGHT;
+        m_text.setString(table);
+        m_text.setPosition(PANEL_X + PADDING + 16, baseline + TABLE_TOP);
+        const sf::FloatRect textBounds = m_text.getGlobalBounds();
+
+        m_vertices.clear();
+        AddRectangle(PANEL_X, PANEL_Y, GRAPH_WIDTH + 2 * PADDING, textBounds.top + textBounds.height + PADDING - PANEL_Y, sf::Color(0, 0, 0, 200));
+
+        // newest frame on the right
+        const float scale = GRAPH_HEIGHT / GRAPH_MAX_MS;
+        for (std::size_t i = 0; i < m_count; ++i)
+        {
+            const FrameSample& sample = m_frames[(m_next + FRAMES - m_count + i) % FRAMES];
+            const float x = PANEL_X + PADDING + (FRAMES - m_count + i) * BAR_WIDTH;
+            float top = baseline;
+            float stacked = 0;
+            for (std::size_t zone = 0; zone < m_zoneCount; ++zone)
+            {
+                if (m_zoneDepths[zone] != 1 || sample.zones[zone] <= 0)
+                    continue;
+                const float barHeight = std::min(sample.zones[zone] * scale, top - (baseline - GRAPH_HEIGHT));
+                top -= barHeight;
+                stacked += sample.zones[zone];
+                AddRectangle(x, top, BAR_WIDTH, barHeight, ZoneColor(zone));
+            }
+
+            // frame time no zone accounts for
+            const float rest = std::min((sample.total - stacked) * scale, top - (baseline - GRAPH_HEIGHT));
+            if (rest > 0)
+                AddRectangle(x, top - rest, BAR_WIDTH, rest, sf::Color(128, 128, 128));
+        }
+
+        // 60 and 30 fps budgets
+        AddRectangle(PANEL_X + PADDING, baseline - 1000 / 60.f * scale, GRAPH_WIDTH, 1, sf::Color(0, 255, 0, 160));
+        AddRectangle(PANEL_X + PADDING, baseline - 1000 / 30.f * scale, GRAPH_WIDTH, 1, sf::Color(255, 0, 0, 160));
+
+        // colour keys beside the zone rows, which follow the header and frame rows
+        const float lineHeight = m_font.getLineSpacing(TEXT_SIZE);
+        for (std::size_t zone = 0; zone < m_zoneCount; ++zone)
+            AddRectangle(PANEL_X + PADDING, baseline + TABLE_TOP + (zone + 2) * lineHeight + 4, 10, 10, ZoneColor(zone));
+
+        m_target.draw(m_vertices);
+        m_target.draw(m_text);
+        m_target.setView(view);
+    }
+
+private:
+    static constexpr float PANEL_X = 10;
+    static constexpr float PANEL_Y = 10;
+    static constexpr float PADDING = 8;
+    static constexpr float BAR_WIDTH = 2;
+    static constexpr float GRAPH_WIDTH = FRAMES * BAR_WIDTH;
+    static constexpr float GRAPH_HEIGHT = 120;
+    static constexpr float GRAPH_MAX_MS = 50;
+    static constexpr float TABLE_TOP = 6;
+    static const unsigned TEXT_SIZE = 14;
+
+    struct FrameSample
+    {
+        float total = 0;
+        float zones[MAX_ZONES] = {};
+    };
+
+    // index of the zone, added on first sight; MAX_ZONES when there is no room
+    std::size_t FindZone(const char* name, const std::uint32_t depth)
+    {
+        for (std::size_t zone = 0; zone < m_zoneCount; ++zone)
+        {
+            if (m_zoneDepths[zone] == depth && std::strcmp(m_zoneNames[zone], name) == 0)
+                return zone;
+        }
+        if (m_zoneCount == MAX_ZONES)
+            return MAX_ZONES;
+        m_zoneNames[m_zoneCount] = name;
+        m_zoneDepths[m_zoneCount] = depth;
+        return m_zoneCount++;
+    }
+
+    // zone MAX_ZONES is the frame itself
+    void AppendRow(std::string& table, const char* name, const std::uint32_t depth, const std::size_t zone) const
+    {
+        float last = 0;
+        float sum = 0;
+        float max = 0;
+        for (std::size_t i = 0; i < m_count; ++i)
+        {
+            const FrameSample& sample = m_frames[(m_next + FRAMES - 1 - i) % FRAMES];
+            const float milliseconds = zone < MAX_ZONES ? sample.zones[zone] : sample.total;
+            if (i == 0)
+                last = milliseconds;
+            sum += milliseconds;
+            if (milliseconds > max)
+                max = milliseconds;
+        }
+
+        char line[96];
+        std::snprintf(line, sizeof(line), "\n%s%-*s %7.2f %7.2f %7.2f",
+            depth > 1 ? "  " : "", depth > 1 ? 14 : 16, name, last, sum / m_count, max);
+        table += line;
+    }
+
+    void AddRectangle(const float x, const float y, const float width, const float height, const sf::Color color)
+    {
+        const sf::Vector2f corners[6] = {
+            { x,y },{ x + width,y },{ x,y + height },
+            { x + width,y },{ x + width,y + height },{ x,y + height } };
+        for (const sf::Vector2f& corner : corners)
+            m_vertices.append(sf::Vertex(corner, color));
+    }
+
+    static sf::Color ZoneColor(const std::size_t zone)
+    {
+        static const sf::Color palette[] = {
+            sf::Color(230, 159, 0), sf::Color(86, 180, 233), sf::Color(0, 158, 115), sf::Color(240, 228, 66),
+            sf::Color(0, 114, 178), sf::Color(213, 94, 0), sf::Color(204, 121, 167), sf::Color(255, 255, 255) };
+        return palette[zone % (sizeof(palette) / sizeof(palette[0]))];
+    }
+
+    sf::RenderTarget& m_target;
+    const char* m_frameZone;
+    sf::VertexArray m_vertices;
+    const sf::Font& m_font;
+    sf::Text m_text;
+
+    std::vector<ProfileRecord> m_records;
+    std::uint64_t m_cursor;
+    FrameSample m_frames[FRAMES];
+    FrameSample m_pending;
+    std::size_t m_next;
+    std::size_t m_count;
+
+    const char* m_zoneNames[MAX_ZONES];
+    std::uint32_t m_zoneDepths[MAX_ZONES];
+    std::size_t m_zoneCount;
+
+    bool m_visible;
+    std::uint64_t m_lost;
+};
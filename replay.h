@@ -0,0 +1,332 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "pong_core.h"
+
+// A replay is the match setup plus every simulation step's input, replayed
+// through the same Update calls. Layout, little-endian:
+//
+//   header   "PRPL", version, flags, max score, 0, seed (u32), tick ms (f32)
+//   runs     bits (< 0x80) then varint n: n whole ticks holding those inputs
+//            0x80 | n (n < 0x7f): one tick split into n steps, each given
+//            as input bits then its length in ms (f32)
+//   end      0xff, both scores, then PongSimulation::Hash() (u64) after the
+//            last tick so playback can detect a desync
+//
+// A match with nobody touching the controls costs a couple of bytes per run
+// of identical ticks.
+
+struct ReplayHeader
+{
+    enum FLAG : std::uint8_t
+    {
+        EXACT_PHYSICS = 1 << 0,
+        FIXED_POINT = 1 << 1
+    };
+
+    PHYSICS GetPhysics() const
+    {
+        if ((flags & FIXED_POINT) != 0)
+            return PHYSICS::FIXED_POINT;
+        return (flags & EXACT_PHYSICS) != 0 ? PHYSICS::EXACT : PHYSICS::TICK;
+    }
+
+    void SetPhysics(const PHYSICS physics)
+    {
+        flags &= static_cast<std::uint8_t>(~(EXACT_PHYSICS | FIXED_POINT));
+        if (physics == PHYSICS::EXACT)
+            flags |= EXACT_PHYSICS;
+        else if (physics == PHYSICS::FIXED_POINT)
+            flags |= FIXED_POINT;
+    }
+
+    std::uint8_t flags = 0;
+    std::uint8_t maxScore = 3;
+    std::uint32_t seed = 0;
+    float tickMilliseconds = UPDATE_MS;
+};
+
+struct ReplayStep
+{
+    float milliseconds;
+    PongInput input;
+};
+
+const std::uint8_t REPLAY_VERSION = 1;
+const std::size_t REPLAY_MAX_STEPS_PER_TICK = 0x7e;
+// room for a long match, so recording does not grow the buffer mid-match
+const std::size_t REPLAY_RESERVE_BYTES = 64 * 1024;
+
+class ReplayRecorder
+{
+public:
+    void Begin(const ReplayHeader& header)
+    {
+        m_header = header;
+        m_data.clear();
+        m_data.reserve(REPLAY_RESERVE_BYTES);
+        m_runLength = 0;
+        m_stepCount = 0;
+
+        for (const char c : { 'P','R','P','L' })
+            m_data.push_back(static_cast<std::uint8_t>(c));
+        m_data.push_back(REPLAY_VERSION);
+        m_data.push_back(header.flags);
+        m_data.push_back(header.maxScore);
+        m_data.push_back(0);
+        PutU32(header.seed);
+        PutF32(header.tickMilliseconds);
+    }
+
+    // one tick is recorded as the steps it was simulated in
+    void BeginTick()
+    {
+        m_stepCount = 0;
+    }
+
+    void RecordStep(const float milliseconds, const PongInput& input)
+    {
+        // more changes than fit in one tick record are folded into the last step
+        if (m_stepCount == REPLAY_MAX_STEPS_PER_TICK)
+        {
+            m_steps[m_stepCount - 1].milliseconds += milliseconds;
+            return;
+        }
+        m_steps[m_stepCount++] = { milliseconds,input };
+    }
+
+    void EndTick()
+    {
+        // nothing was simulated
+        if (m_stepCount == 0)
+            return;
+
+        if (m_stepCount == 1 && m_steps[0].milliseconds == m_header.tickMilliseconds)
+        {
+            const std::uint8_t bits = m_steps[0].input.ToBits();
+            if (m_runLength > 0 && bits != m_runBits)
+                FlushRun();
+            m_runBits = bits;
+            ++m_runLength;
+            return;
+        }
+
+        FlushRun();
+        m_data.push_back(static_cast<std::uint8_t>(0x80 | m_stepCount));
+        for (std::size_t i = 0; i < m_stepCount; ++i)
+        {
+            m_data.push_back(m_steps[i].input.ToBits());
+            PutF32(m_steps[i].milliseconds);
+        }
+    }
+
+    bool Save(const std::string& path, const PongSimulation& finalState)
+    {
+        FlushRun();
+        std::vector<std::uint8_t> data = m_data;
+        data.push_back(0xff);
+        data.push_back(static_cast<std::uint8_t>(finalState.GetPlayerOneScore()));
+        data.push_back(static_cast<std::uint8_t>(finalState.GetPlayerTwoScore()));
+        const std::uint64_t hash = finalState.Hash();
+        for (int i = 0; i < 8; ++i)
+            data.push_back(static_cast<std::uint8_t>(hash >> (i * 8)));
+
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        return static_cast<bool>(file);
+    }
+
+    std::size_t GetSize() const
+    {
+        return m_data.size();
+    }
+
+private:
+    void FlushRun()
+    {
+        if (m_runLength == 0)
+            return;
+        m_data.push_back(m_runBits);
+        for (std::uint64_t n = m_runLength; ; n >>= 7)
+        {
+            if (n < 0x80)
+            {
+                m_data.push_back(static_cast<std::uint8_t>(n));
+                break;
+            }
+            m_data.push_back(static_cast<std::uint8_t>(0x80 | (n & 0x7f)));
+        }
+        m_runLength = 0;
+    }
+
+    void PutU32(const std::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            m_data.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+    }
+
+    void PutF32(const float value)
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        PutU32(bits);
+    }
+
+    ReplayHeader m_header;
+    std::vector<std::uint8_t> m_data;
+    std::uint8_t m_runBits = 0;
+    std::uint64_t m_runLength = 0;
+    ReplayStep m_steps[REPLAY_MAX_STEPS_PER_TICK];
+    std::size_t m_stepCount = 0;
+};
+
+class ReplayReader
+{
+public:
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_position = 0;
+        m_hasFinalState = false;
+
+        if (m_data.size() < HEADER_SIZE || std::memcmp(m_data.data(), "PRPL", 4) != 0 || m_data[4] != REPLAY_VERSION)
+            return false;
+
+        m_header.flags = m_data[5];
+        m_header.maxScore = m_data[6];
+        m_position = 8;
+        m_header.seed = GetU32();
+        m_header.tickMilliseconds = GetF32();
+        Rewind();
+        // played at the recorded tick, so it has to be one the game can run
+        return m_header.maxScore > 0 && m_header.tickMilliseconds >= MIN_UPDATE_MS && m_header.tickMilliseconds < 1e6f;
+    }
+
+    // back to the first tick, to play the same recording again
+    void Rewind()
+    {
+        m_position = HEADER_SIZE;
+        m_runLength = 0;
+        m_ended = false;
+    }
+
+    const ReplayHeader& GetHeader() const
+    {
+        return m_header;
+    }
+
+    // Fills steps with the next tick; returns false at the end of the replay.
+    bool NextTick(ReplayStep* steps, std::size_t& count)
+    {
+        if (m_runLength > 0)
+        {
+            --m_runLength;
+            steps[0] = { m_header.tickMilliseconds,PongInput::FromBits(m_runBits) };
+            count = 1;
+            return true;
+        }
+
+        if (m_ended || m_position >= m_data.size())
+            return false;
+
+        const std::uint8_t tag = m_data[m_position++];
+        if (tag == 0xff)
+        {
+            m_ended = true;
+            if (m_position + 10 <= m_data.size())
+            {
+                m_finalPlayerOneScore = m_data[m_position];
+                m_finalPlayerTwoScore = m_data[m_position + 1];
+                m_position += 2;
+                m_finalHash = GetU32();
+                m_finalHash |= static_cast<std::uint64_t>(GetU32()) << 32;
+                m_hasFinalState = true;
+            }
+            return false;
+        }
+
+        if (tag < 0x80)
+        {
+            // a run is at least one tick, its length a varint of up to 64 bits
+            std::uint64_t length = 0;
+            bool complete = false;
+            for (int shift = 0; shift < 64 && m_position < m_data.size(); shift += 7)
+            {
+                const std::uint8_t byte = m_data[m_position++];
+                length |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if (byte < 0x80)
+                {
+                    complete = true;
+                    break;
+                }
+            }
+            if (!complete || length == 0)
+                return false;
+
+            m_runBits = tag;
+            m_runLength = length - 1;
+            steps[0] = { m_header.tickMilliseconds,PongInput::FromBits(m_runBits) };
+            count = 1;
+            return true;
+        }
+
+        count = tag & 0x7f;
+        if (count > REPLAY_MAX_STEPS_PER_TICK || m_position + count * 5 > m_data.size())
+            return false;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            steps[i].input = PongInput::FromBits(m_data[m_position++]);
+            steps[i].milliseconds = GetF32();
+        }
+        return true;
+    }
+
+    // after the last tick: whether the end marker's state matches simulation
+    bool Verify(const PongSimulation& simulation) const
+    {
+        return m_hasFinalState &&
+            simulation.GetPlayerOneScore() == m_finalPlayerOneScore &&
+            simulation.GetPlayerTwoScore() == m_finalPlayerTwoScore &&
+            simulation.Hash() == m_finalHash;
+    }
+
+private:
+    static const std::size_t HEADER_SIZE = 16;
+
+    std::uint32_t GetU32()
+    {
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4 && m_position < m_data.size(); ++i)
+            value |= static_cast<std::uint32_t>(m_data[m_position++]) << (i * 8);
+        return value;
+    }
+
+    float GetF32()
+    {
+        const std::uint32_t bits = GetU32();
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    ReplayHeader m_header;
+    std::vector<std::uint8_t> m_data;
+    std::size_t m_position = 0;
+    std::uint8_t m_runBits = 0;
+    std::uint64_t m_runLength = 0;
+    bool m_ended = false;
+
+    bool m_hasFinalState = false;
+    std::uint8_t m_finalPlayerOneScore = 0;
+    std::uint8_t m_finalPlayerTwoScore = 0;
+    std::uint64_t m_finalHash = 0;
+};
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "pong_core.h"
+
+struct RollbackStats
+{
+    std::uint64_t frames = 0;
+    std::uint64_t stalls = 0;
+    std::uint64_t rollbacks = 0;
+    std::uint64_t resimulatedFrames = 0;
+    std::uint32_t maxRollbackFrames = 0;
+    double maxRollbackMicroseconds = 0;
+    std::uint64_t packetsReceived = 0;
+    std::uint64_t rejectedPackets = 0;
+};
+
+// Rollback netcode for one side of a two-player match. Every frame is
+// simulated straight away with the local input and a guess for the remote
+// one (whatever the remote player last held). A snapshot of the simulation
+// is kept from before each unconfirmed frame; when the remote input for a
+// frame arrives and differs from the guess, the session rewinds to that
+// frame and re-simulates up to the present with the corrected inputs.
+//
+// The session only produces and consumes packets; sending them is up to the
+// caller. Each packet repeats every local input the peer hasn't acknowledged,
+// so a lost packet is covered by the next one.
+class RollbackSession
+{
+public:
+    // per-player input bits on the wire
+    enum BIT : std::uint8_t
+    {
+        UP = 1 << 0,
+        DOWN = 1 << 1,
+        SERVE = 1 << 2
+    };
+
+    static const std::uint32_t HISTORY = 64;
+    static const std::uint32_t MAX_PREDICTION = 16;
+    static const std::size_t HEADER_SIZE = 18;
+    static const std::size_t MAX_PACKET_SIZE = HEADER_SIZE + HISTORY;
+
+    // localPlayer is 0 for the left paddle, 1 for the right one; both sides
+    // must agree on the score to win and the physics mode
+    RollbackSession(const std::uint_fast8_t scoreToWin, const std::uint8_t localPlayer, const PHYSICS physics)
+        :
+        m_simulation(scoreToWin),
+        m_snapshots(HISTORY, m_simulation),
+        m_localPlayer(localPlayer),
+        m_physics(physics),
+        m_frame(0),
+        m_remoteConfirmed(0),
+        m_remoteFrame(0),
+        m_remoteAdvantage(0),
+        m_acknowledged(0),
+        m_rollbackFrom(NO_ROLLBACK)
+    {
+    }
+
+    // the local player may use either paddle's keys
+    static std::uint8_t LocalBits(const PongInput& input)
+    {
+        return (input.playerOneUp || input.playerTwoUp ? UP : 0) |
+            (input.playerOneDown || input.playerTwoDown ? DOWN : 0) |
+            (input.serve ? SERVE : 0);
+    }
+
+    // the simulation input for one frame; only the serving player's serve counts
+    static PongInput CombineInputs(const PongSimulation& simulation, const std::uint8_t one, const std::uint8_t two)
+    {
+        PongInput input;
+        input.playerOneUp = (one & UP) != 0;
+        input.playerOneDown = (one & DOWN) != 0;
+        input.playerTwoUp = (two & UP) != 0;
+        input.playerTwoDown = (two & DOWN) != 0;
+        input.serve = (simulation.GetPlayState() == PLAY_STATE::SERVE_PLAYER_ONE && (one & SERVE) != 0) ||
+            (simulation.GetPlayState() == PLAY_STATE::SERVE_PLAYER_TWO && (two & SERVE) != 0);
+        return input;
+    }
+
+    // Simulates the next frame with localBits. Returns false without
+    // simulating if the peer has fallen so far behind that the frame could
+    // no longer be rolled back.
+    bool AdvanceFrame(const std::uint8_t localBits)
+    {
+        if (m_frame >= m_remoteConfirmed + MAX_PREDICTION || m_frame - m_acknowledged >= HISTORY - 1)
+        {
+            ++m_stats.stalls;
+            return false;
+        }
+
+        Rollback();
+
+        const std::uint32_t slot = m_frame % HISTORY;
+        m_local[slot] = localBits;
+        if (m_frame >= m_remoteConfirmed)
+            m_remote[slot] = Predict();
+        Simulate(m_frame);
+        ++m_frame;
+        ++m_stats.frames;
+        return true;
+    }
+
+    // Gives the local clock a tick off when it runs ahead of the peer's, so
+    // neither side ends up predicting much further than the link latency.
+    bool ShouldWait() const
+    {
+        const std::int64_t localAdvantage = static_cast<std::int64_t>(m_frame) - m_remoteFrame;
+        return localAdvantage - m_remoteAdvantage >= 2;
+    }
+
+    std::size_t WritePacket(std::uint8_t* buffer) const
+    {
+        std::uint32_t first = m_acknowledged;
+        if (m_frame - first > HISTORY)
+            first = m_frame - HISTORY;
+        const std::uint32_t count = m_frame - first;
+        const std::int64_t advantage = static_cast<std::int64_t>(m_frame) - m_remoteFrame;
+
+        buffer[0] = 'P';
+        buffer[1] = 'N';
+        buffer[2] = static_cast<std::uint8_t>(m_simulation.GetMaxScore());
+        buffer[3] = static_cast<std::uint8_t>(static_cast<std::uint8_t>(m_physics) | m_localPlayer << 2);
+        PutU32(buffer + 4, first);
+        PutU32(buffer + 8, m_frame);
+        PutU32(buffer + 12, m_remoteConfirmed);
+        buffer[16] = static_cast<std::uint8_t>(count);
+        buffer[17] = static_cast<std::uint8_t>(static_cast<std::int8_t>(advantage < -128 ? -128 : advantage > 127 ? 127 : advantage));
+        for (std::uint32_t i = 0; i < count; ++i)
+            buffer[HEADER_SIZE + i] = m_local[(first + i) % HISTORY];
+        return HEADER_SIZE + count;
+    }
+
+    void ReadPacket(const std::uint8_t* data, const std::size_t size)
+    {
+        const std::uint8_t expectedFlags = static_cast<std::uint8_t>(static_cast<std::uint8_t>(m_physics) | (1 - m_localPlayer) << 2);
+        if (size < HEADER_SIZE || data[0] != 'P' || data[1] != 'N' ||
+            data[2] != m_simulation.GetMaxScore() || data[3] != expectedFlags ||
+            size < HEADER_SIZE + data[16])
+        {
+            ++m_stats.rejectedPackets;
+            return;
+        }
+        ++m_stats.packetsReceived;
+
+        const std::uint32_t first = GetU32(data + 4);
+        const std::uint32_t remoteFrame = GetU32(data + 8);
+        const std::uint32_t acknowledged = GetU32(data + 12);
+        const std::uint32_t count = data[16];
+
+        // packets can arrive out of order; only newer information counts
+        if (remoteFrame >= m_remoteFrame)
+        {
+            m_remoteFrame = remoteFrame;
+            m_remoteAdvantage = static_cast<std::int8_t>(data[17]);
+        }
+        if (acknowledged > m_acknowledged && acknowledged <= m_frame)
+            m_acknowledged = acknowledged;
+
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            const std::uint32_t frame = first + i;
+            if (frame < m_remoteConfirmed)
+                continue;
+            if (frame > m_remoteConfirmed || frame >= m_frame + MAX_PREDICTION)
+                break;
+
+            const std::uint8_t bits = data[HEADER_SIZE + i];
+            const std::uint32_t slot = frame % HISTORY;
+            if (frame < m_frame && bits != m_remote[slot] && frame < m_rollbackFrom)
+                m_rollbackFrom = frame;
+            m_remote[slot] = bits;
+            ++m_remoteConfirmed;
+        }
+    }
+
+    // true once the match is over on inputs both sides have confirmed
+    bool IsFinished() const
+    {
+        if (m_rollbackFrom != NO_ROLLBACK)
+            return false;
+        if (m_remoteConfirmed >= m_frame)
+            return IsOver(m_simulation);
+        return IsOver(m_snapshots[m_remoteConfirmed % HISTORY]);
+    }
+
+    // state after the last frame, including predicted remote input
+    const PongSimulation& GetSimulation() const
+    {
+        return m_simulation;
+    }
+
+    std::uint32_t GetFrame() const
+    {
+        return m_frame;
+    }
+
+    // number of leading frames for which the remote input is known
+    std::uint32_t GetConfirmedFrames() const
+    {
+        return m_remoteConfirmed;
+    }
+
+    const RollbackStats& GetStats() const
+    {
+        return m_stats;
+    }
+
+private:
+    static const std::uint32_t NO_ROLLBACK = 0xffffffff;
+
+    static bool IsOver(const PongSimulation& simulation)
+    {
+        return simulation.GetPlayerOneScore() >= simulation.GetMaxScore() ||
+            simulation.GetPlayerTwoScore() >= simulation.GetMaxScore();
+    }
+
+    static void PutU32(std::uint8_t* buffer, const std::uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+            buffer[i] = static_cast<std::uint8_t>(value >> (i * 8));
+    }
+
+    static std::uint32_t GetU32(const std::uint8_t* data)
+    {
+        return data[0] | data[1] << 8 | data[2] << 16 | static_cast<std::uint32_t>(data[3]) << 24;
+    }
+
+    // the remote player keeps holding what they last held
+    std::uint8_t Predict() const
+    {
+        return m_remoteConfirmed > 0 ? m_remote[(m_remoteConfirmed - 1) % HISTORY] : 0;
+    }
+
+    void Simulate(const std::uint32_t frame)
+    {
+        const std::uint32_t slot = frame % HISTORY;
+        m_snapshots[slot] = m_simulation;
+        if (IsOver(m_simulation))
+            return;
+
+        const std::uint8_t one = m_localPlayer == 0 ? m_local[slot] : m_remote[slot];
+        const std::uint8_t two = m_localPlayer == 0 ? m_remote[slot] : m_local[slot];
+        const PongInput input = CombineInputs(m_simulation, one, two);
+
+        m_simulation.Step(m_physics, UPDATE_MS, input);
+    }
+
+    void Rollback()
+    {
+        if (m_rollbackFrom == NO_ROLLBACK)
+            return;
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        const std::uint32_t from = m_rollbackFrom;
+        m_rollbackFrom = NO_ROLLBACK;
+        m_simulation = m_snapshots[from % HISTORY];
+        for (std::uint32_t frame = from; frame < m_frame; ++frame)
+        {
+            if (frame >= m_remoteConfirmed)
+                m_remote[frame % HISTORY] = Predict();
+            Simulate(frame);
+        }
+
+        const std::uint32_t frames = m_frame - from;
+        const double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        ++m_stats.rollbacks;
+        m_stats.resimulatedFrames += frames;
+        if (frames > m_stats.maxRollbackFrames)
+            m_stats.maxRollbackFrames = frames;
+        if (microseconds > m_stats.maxRollbackMicroseconds)
+            m_stats.maxRollbackMicroseconds = microseconds;
+    }
+
+    PongSimulation m_simulation;
+    // state from before each frame still in the history
+    std::vector<PongSimulation> m_snapshots;
+    std::uint8_t m_local[HISTORY] = {};
+    // confirmed remote input, or the prediction that was simulated
+    std::uint8_t m_remote[HISTORY] = {};
+
+    std::uint8_t m_localPlayer;
+    PHYSICS m_physics;
+    std::uint32_t m_frame;
+    std::uint32_t m_remoteConfirmed;
+    std::uint32_t m_remoteFrame;
+    std::int64_t m_remoteAdvantage;
+    std::uint32_t m_acknowledged;
+    std::uint32_t m_rollbackFrom;
+
+    RollbackStats m_stats;
+};
+
+// Stands between a session and its transport to test under bad network
+// conditions on one machine: every packet sent is dropped with the given
+// probability or held back for the latency plus up to jitter, which also
+// reorders packets the way a real link can.
+class LinkConditioner
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    LinkConditioner(const float latencyMilliseconds, const float jitterMilliseconds, const float lossPercent, const std::uint32_t seed)
+        :
+        m_latency(std::chrono::duration<float, std::milli>(latencyMilliseconds)),
+        m_jitterMilliseconds(jitterMilliseconds),
+        m_lossPercent(lossPercent),
+        m_random(seed),
+        m_dropped(0),
+        m_delivered(0)
+    {
+    }
+
+    void Send(const std::uint8_t* data, const std::size_t size, const Clock::time_point now)
+    {
+        std::uniform_real_distribution<float> percent(0, 100);
+        if (m_lossPercent > 0 && percent(m_random) < m_lossPercent)
+        {
+            ++m_dropped;
+            return;
+        }
+
+        Clock::duration delay = std::chrono::duration_cast<Clock::duration>(m_latency);
+        if (m_jitterMilliseconds > 0)
+        {
+            std::uniform_real_distribution<float> jitter(0, m_jitterMilliseconds);
+            delay += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(jitter(m_random)));
+        }
+        m_pending.push_back({ now + delay,std::vector<std::uint8_t>(data, data + size) });
+    }
+
+    // takes the earliest packet due by now
+    bool Receive(const Clock::time_point now, std::vector<std::uint8_t>& packet)
+    {
+        std::size_t earliest = m_pending.size();
+        for (std::size_t i = 0; i < m_pending.size(); ++i)
+        {
+            if (m_pending[i].due <= now && (earliest == m_pending.size() || m_pending[i].due < m_pending[earliest].due))
+                earliest = i;
+        }
+        if (earliest == m_pending.size())
+            return false;
+
+        packet.swap(m_pending[earliest].data);
+        m_pending[earliest] = std::move(m_pending.back());
+        m_pending.pop_back();
+        ++m_delivered;
+        return true;
+    }
+
+    std::uint64_t GetDropped() const
+    {
+        return m_dropped;
+    }
+
+    std::uint64_t GetDelivered() const
+    {
+        return m_delivered;
+    }
+
+private:
+    struct Pending
+    {
+        Clock::time_point due;
+        std::vector<std::uint8_t> data;
+    };
+
+    std::chrono::duration<float, std::milli> m_latency;
+    float m_jitterMilliseconds;
+    float m_lossPercent;
+    std::mt19937 m_random;
+    std::vector<Pending> m_pending;
+    std::uint64_t m_dropped;
+    std::uint64_t m_delivered;
+};
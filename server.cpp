@@ -0,0 +1,176 @@
+#include <SFML/Network.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "match_server.h"
+#include "pong_core.h"
+#include "thread_pool.h"
+
+// Dedicated server: hosts every match in one process, steps them all on a
+// work-stealing pool once per UPDATE_MS and answers over one UDP socket.
+
+typedef std::chrono::steady_clock Clock;
+
+// tick cost over one reporting interval
+struct TickMetrics
+{
+    std::vector<double> workMilliseconds;
+    double stepMilliseconds = 0;
+    std::uint64_t deadlineMisses = 0;
+
+    void Report(const ServerStats& stats, const ThreadPool& pool, std::vector<WorkerStats>& lastWorkers, const double intervalSeconds)
+    {
+        std::vector<double> sorted = workMilliseconds;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0;
+        for (const double milliseconds : sorted)
+            mean += milliseconds;
+        mean = sorted.empty() ? 0 : mean / sorted.size();
+        const double p99 = sorted.empty() ? 0 : sorted[sorted.size() * 99 / 100];
+        const double max = sorted.empty() ? 0 : sorted.back();
+
+        // matches each core could hold at this cost before ticks overrun
+        const unsigned threads = pool.GetThreadCount();
+        const double perCore = static_cast<double>(stats.liveMatches) / threads;
+        const double capacity = mean > 0 ? perCore * UPDATE_MS / mean : 0;
+
+        std::cout << "ticks: " << sorted.size()
+            << "  live: " << stats.liveMatches
+            << "  waiting: " << stats.waitingPlayers
+            << "  finished: " << stats.finishedMatches
+            << "  abandoned: " << stats.abandonedMatches
+            << "  rejected packets: " << stats.rejectedPackets << "\n"
+            << "  tick ms mean " << mean << " p99 " << p99 << " max " << max
+            << " (stepping " << (sorted.empty() ? 0 : stepMilliseconds / sorted.size()) << ", the rest is socket I/O)"
+            << "  deadline misses: " << deadlineMisses
+            << "  matches/core: " << perCore
+            << " (room for ~" << static_cast<std::uint64_t>(capacity) << ")" << "\n";
+
+        const std::vector<WorkerStats> workers = pool.GetStats();
+        for (std::size_t i = 0; i < workers.size(); ++i)
+        {
+            const WorkerStats previous = i < lastWorkers.size() ? lastWorkers[i] : WorkerStats();
+            std::cout << "  worker " << i
+                << ": tasks " << workers[i].tasks - previous.tasks
+                << " stolen " << workers[i].stolen - previous.stolen
+                << " busy " << 100 * (workers[i].busySeconds - previous.busySeconds) / intervalSeconds << "%\n";
+        }
+        std::cout << std::flush;
+
+        lastWorkers = workers;
+        workMilliseconds.clear();
+        stepMilliseconds = 0;
+        deadlineMisses = 0;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    unsigned short port = 7777;
+    unsigned threads = 0;
+    int scoreToWin = 3;
+    double seconds = 0;
+    double statsInterval = 5;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--port") == 0 && hasValue)
+            port = static_cast<unsigned short>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+            threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--score") == 0 && hasValue)
+            scoreToWin = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seconds") == 0 && hasValue)
+            seconds = std::strtod(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--stats") == 0 && hasValue)
+            statsInterval = std::strtod(argv[++i], nullptr);
+        else
+        {
+            std::cerr << "usage: pong_server [--port N] [--threads N] [--score N] [--seconds S] [--stats S]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (scoreToWin < 1 || scoreToWin > 255)
+    {
+        std::cerr << "score to win must be between 1 and 255" << std::endl;
+        return 1;
+    }
+
+    sf::UdpSocket socket;
+    if (socket.bind(port) != sf::Socket::Done)
+    {
+        std::cerr << "could not bind UDP port " << port << std::endl;
+        return 1;
+    }
+    socket.setBlocking(false);
+
+    ThreadPool pool(threads);
+    MatchServer server(pool, static_cast<std::uint_fast8_t>(scoreToWin));
+    std::cout << "serving on UDP port " << port << " with " << pool.GetThreadCount() << " workers" << std::endl;
+
+    const Clock::duration tick = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(UPDATE_MS));
+    const Clock::time_point start = Clock::now();
+    Clock::time_point scheduled = start;
+    Clock::time_point lastReport = start;
+
+    TickMetrics metrics;
+    std::vector<WorkerStats> lastWorkers;
+    std::uint8_t buffer[64];
+    std::uint8_t reply[ServerProtocol::WELCOME_SIZE];
+
+    const auto send = [&socket](const std::uint32_t address, const std::uint16_t toPort, const std::uint8_t* data, const std::size_t size)
+    {
+        socket.send(data, size, sf::IpAddress(address), toPort);
+    };
+
+    while (seconds <= 0 || Clock::now() - start < std::chrono::duration<double>(seconds))
+    {
+        const Clock::time_point tickStart = Clock::now();
+
+        std::size_t received;
+        sf::IpAddress sender;
+        unsigned short senderPort;
+        while (socket.receive(buffer, sizeof(buffer), received, sender, senderPort) == sf::Socket::Done)
+        {
+            const std::size_t replySize = server.HandlePacket(buffer, received, sender.toInteger(), senderPort, reply);
+            if (replySize > 0)
+                socket.send(reply, replySize, sender, senderPort);
+        }
+
+        const Clock::time_point stepStart = Clock::now();
+        server.Tick();
+        metrics.stepMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - stepStart).count();
+        server.ForEachOutgoing(send);
+
+        // a tick misses its deadline when its work runs into the next one
+        const Clock::time_point workEnd = Clock::now();
+        metrics.workMilliseconds.push_back(std::chrono::duration<double, std::milli>(workEnd - tickStart).count());
+        scheduled += tick;
+        if (workEnd > scheduled)
+        {
+            ++metrics.deadlineMisses;
+            // start a fresh schedule rather than bursting to catch up
+            scheduled = workEnd;
+        }
+
+        if (statsInterval > 0 && workEnd - lastReport >= std::chrono::duration<double>(statsInterval))
+        {
+            metrics.Report(server.GetStats(), pool, lastWorkers, std::chrono::duration<double>(workEnd - lastReport).count());
+            lastReport = workEnd;
+        }
+
+        std::this_thread::sleep_until(scheduled);
+    }
+
+    metrics.Report(server.GetStats(), pool, lastWorkers, std::chrono::duration<double>(Clock::now() - lastReport).count());
+    return 0;
+}
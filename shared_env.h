@@ -0,0 +1,484 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "pong_batch.h"
+#include "pong_core.h"
+
+// Many matches exposed to an outside trainer through one POSIX shared-memory
+// object. The trainer writes every match's action into the mapping, bumps a
+// request counter and waits on a response counter; the server steps all the
+// matches with its own PongBatch and then copies the observations into the
+// mapping, one memcpy per field per request. Nothing is serialised or goes
+// through the kernel. Both sides spin a while before sleeping on a futex, so
+// with spare cores the handoff costs a couple of cache line transfers on top
+// of that copy. Linux only.
+//
+// Layout, native byte order: SharedEnvControl at offset 0, then one array
+// per field, each envCount long, 64-byte aligned and found through
+// header.offsets[FIELD]. Actions are PongInput::ToBits() per match;
+// observations are floats in PongBatch's units, with PLAY_STATE as its
+// enumerator's value. reward is +1 per point to player one and -1 per
+// point to player two over the request; done is 1 on the request a match
+// ended, and that match starts again on the next request.
+
+const std::uint32_t SHARED_ENV_MAGIC = 0x564e4550;
+const std::uint32_t SHARED_ENV_VERSION = 1;
+const std::size_t SHARED_ENV_ALIGNMENT = 64;
+const char* const SHARED_ENV_DEFAULT_NAME = "/pong_env";
+
+enum class ENV_FIELD : std::uint_fast8_t
+{
+    ACTION,
+    BALL_X,
+    BALL_Y,
+    BALL_DX,
+    BALL_DY,
+    PLAYER_ONE_Y,
+    PLAYER_TWO_Y,
+    PLAYER_ONE_SCORE,
+    PLAYER_TWO_SCORE,
+    PLAY_STATE,
+    REWARD,
+    DONE,
+    COUNT
+};
+
+enum class ENV_COMMAND : std::uint32_t
+{
+    STEP,
+    RESET,
+    STOP
+};
+
+struct SharedEnvHeader
+{
+    std::atomic<std::uint32_t> magic;
+    std::uint32_t version;
+    std::uint32_t envCount;
+    std::uint32_t scoreToWin;
+    float tickMilliseconds;
+    std::uint32_t reserved;
+    std::uint64_t size;
+    std::uint64_t offsets[static_cast<std::size_t>(ENV_FIELD::COUNT)];
+};
+
+// One direction of the handshake. sequence is the futex word; sleepers lets
+// the other side skip the wake system call when nobody is asleep.
+struct SharedEnvSignal
+{
+    std::atomic<std::uint32_t> sequence;
+    std::atomic<std::uint32_t> sleepers;
+    // request: what to do and for how many ticks; response: server time spent
+    ENV_COMMAND command;
+    std::uint32_t ticks;
+    std::uint64_t workNanoseconds;
+};
+
+struct SharedEnvControl
+{
+    alignas(SHARED_ENV_ALIGNMENT) SharedEnvHeader header;
+    alignas(SHARED_ENV_ALIGNMENT) SharedEnvSignal request;
+    alignas(SHARED_ENV_ALIGNMENT) SharedEnvSignal response;
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "futex words must be plain 32-bit integers");
+
+namespace SharedEnvSync
+{
+    inline void Pause()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    // spins share a core with the other side to no purpose
+    inline unsigned DefaultSpins()
+    {
+        return std::thread::hardware_concurrency() > 1 ? 20000 : 0;
+    }
+
+    inline void Publish(SharedEnvSignal& signal, const std::uint32_t sequence)
+    {
+        signal.sequence.store(sequence, std::memory_order_seq_cst);
+        if (signal.sleepers.load(std::memory_order_seq_cst) > 0)
+            syscall(SYS_futex, &signal.sequence, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+    }
+
+    // Waits up to timeout for the sequence to move on from seen; false if
+    // it did not, so callers can check whether to give up.
+    inline bool WaitForChange(SharedEnvSignal& signal, const std::uint32_t seen, const unsigned spins, const std::chrono::milliseconds timeout)
+    {
+        for (unsigned i = 0; i < spins; ++i)
+        {
+            if (signal.sequence.load(std::memory_order_acquire) != seen)
+                return true;
+            Pause();
+        }
+
+        // the sleeper count goes up before the last check, and the
+        // publisher stores before reading it, so one of them sees the other
+        const timespec wait = { static_cast<std::time_t>(timeout.count() / 1000),static_cast<long>(timeout.count() % 1000 * 1000000) };
+        signal.sleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (signal.sequence.load(std::memory_order_seq_cst) == seen)
+            syscall(SYS_futex, &signal.sequence, FUTEX_WAIT, seen, &wait, nullptr, 0);
+        signal.sleepers.fetch_sub(1, std::memory_order_seq_cst);
+        return signal.sequence.load(std::memory_order_acquire) != seen;
+    }
+}
+
+// A named shared-memory object mapped read-write. The creator unlinks the
+// name again when it is destroyed; mappings already made stay valid.
+class SharedMemory
+{
+public:
+    SharedMemory()
+        :
+        m_data(nullptr),
+        m_size(0),
+        m_owner(false)
+    {
+    }
+
+    ~SharedMemory()
+    {
+        Close();
+    }
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    // replaces any object left behind under the same name
+    bool Create(const std::string& name, const std::size_t size)
+    {
+        Close();
+        const int file = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (file < 0)
+            return false;
+        const bool sized = ftruncate(file, static_cast<off_t>(size)) == 0;
+        m_owner = true;
+        m_name = name;
+        return Map(file, sized ? size : 0);
+    }
+
+    bool Open(const std::string& name)
+    {
+        Close();
+        const int file = shm_open(name.c_str(), O_RDWR, 0);
+        if (file < 0)
+            return false;
+        struct stat status;
+        return Map(file, fstat(file, &status) == 0 ? static_cast<std::size_t>(status.st_size) : 0);
+    }
+
+    void Close()
+    {
+        if (m_data != nullptr)
+            munmap(m_data, m_size);
+        if (m_owner)
+            shm_unlink(m_name.c_str());
+        m_data = nullptr;
+        m_size = 0;
+        m_owner = false;
+    }
+
+    // after a fork, so only the parent removes the name
+    void Disown()
+    {
+        m_owner = false;
+    }
+
+    std::uint8_t* GetData() const
+    {
+        return m_data;
+    }
+
+    std::size_t GetSize() const
+    {
+        return m_size;
+    }
+
+private:
+    bool Map(const int file, const std::size_t size)
+    {
+        void* data = MAP_FAILED;
+        if (size > 0)
+            data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+        close(file);
+        if (data == MAP_FAILED)
+        {
+            Close();
+            return false;
+        }
+        m_data = static_cast<std::uint8_t*>(data);
+        m_size = size;
+        return true;
+    }
+
+    std::uint8_t* m_data;
+    std::size_t m_size;
+    bool m_owner;
+    std::string m_name;
+};
+
+// what both sides see of a mapped environment
+class SharedEnvView
+{
+public:
+    SharedEnvView()
+        :
+        m_control(nullptr)
+    {
+    }
+
+    std::uint32_t GetEnvCount() const
+    {
+        return m_control->header.envCount;
+    }
+
+    std::uint8_t* GetActions() const
+    {
+        return Field<std::uint8_t>(ENV_FIELD::ACTION);
+    }
+
+    const float* GetObservation(const ENV_FIELD field) const
+    {
+        return Field<float>(field);
+    }
+
+    const float* GetRewards() const
+    {
+        return Field<float>(ENV_FIELD::REWARD);
+    }
+
+    const std::uint8_t* GetDone() const
+    {
+        return Field<std::uint8_t>(ENV_FIELD::DONE);
+    }
+
+protected:
+    template <class T>
+    T* Field(const ENV_FIELD field) const
+    {
+        return reinterpret_cast<T*>(m_memory.GetData() + m_control->header.offsets[static_cast<std::size_t>(field)]);
+    }
+
+    SharedMemory m_memory;
+    SharedEnvControl* m_control;
+};
+
+class SharedEnvServer : public SharedEnvView
+{
+public:
+    bool Create(const std::string& name, const std::uint32_t envCount, const std::uint_fast8_t scoreToWin)
+    {
+        std::uint64_t offsets[static_cast<std::size_t>(ENV_FIELD::COUNT)];
+        std::uint64_t size = Align(sizeof(SharedEnvControl));
+        for (std::size_t field = 0; field < static_cast<std::size_t>(ENV_FIELD::COUNT); ++field)
+        {
+            offsets[field] = size;
+            const bool bytes = field == static_cast<std::size_t>(ENV_FIELD::ACTION) || field == static_cast<std::size_t>(ENV_FIELD::DONE);
+            size = Align(size + static_cast<std::uint64_t>(envCount) * (bytes ? 1 : sizeof(float)));
+        }
+        if (envCount == 0 || !m_memory.Create(name, static_cast<std::size_t>(size)))
+            return false;
+
+        // a fresh object reads as zeroes, which the atomics start from
+        m_control = new (m_memory.GetData()) SharedEnvControl();
+        SharedEnvHeader& header = m_control->header;
+        header.version = SHARED_ENV_VERSION;
+        header.envCount = envCount;
+        header.scoreToWin = scoreToWin;
+        header.tickMilliseconds = UPDATE_MS;
+        header.size = size;
+        std::memcpy(header.offsets, offsets, sizeof(offsets));
+
+        m_batch.reset(new PongBatch(envCount, scoreToWin));
+        m_previousOne.assign(envCount, 0);
+        m_previousTwo.assign(envCount, 0);
+        Reset();
+        m_served = 0;
+
+        // trainers wait for the magic before trusting anything else
+        header.magic.store(SHARED_ENV_MAGIC, std::memory_order_release);
+        return true;
+    }
+
+    // Serves requests until a STOP request or until stop is set, which is
+    // checked at least every timeout.
+    void Run(const unsigned spins, const std::atomic<bool>& stop, const std::chrono::milliseconds timeout = std::chrono::milliseconds(100))
+    {
+        while (!stop.load(std::memory_order_relaxed))
+        {
+            if (!SharedEnvSync::WaitForChange(m_control->request, m_served, spins, timeout))
+                continue;
+            m_served = m_control->request.sequence.load(std::memory_order_acquire);
+
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            const ENV_COMMAND command = m_control->request.command;
+            if (command == ENV_COMMAND::RESET)
+                Reset();
+            else if (command == ENV_COMMAND::STEP)
+                Step(m_control->request.ticks > 0 ? m_control->request.ticks : 1);
+            m_control->response.workNanoseconds +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+            SharedEnvSync::Publish(m_control->response, m_served);
+            if (command == ENV_COMMAND::STOP)
+                return;
+        }
+    }
+
+    void Disown()
+    {
+        m_memory.Disown();
+    }
+
+private:
+    static std::uint64_t Align(const std::uint64_t offset)
+    {
+        return (offset + SHARED_ENV_ALIGNMENT - 1) / SHARED_ENV_ALIGNMENT * SHARED_ENV_ALIGNMENT;
+    }
+
+    void Reset()
+    {
+        for (std::size_t i = 0; i < m_batch->GetMatchCount(); ++i)
+            m_batch->ResetMatch(i);
+        std::memset(Field<float>(ENV_FIELD::REWARD), 0, GetEnvCount() * sizeof(float));
+        Publish();
+    }
+
+    void Step(const std::uint32_t ticks)
+    {
+        const std::size_t count = GetEnvCount();
+        m_batch->ResetFinished();
+        std::memcpy(m_previousOne.data(), m_batch->GetPlayerOneScore(), count * sizeof(float));
+        std::memcpy(m_previousTwo.data(), m_batch->GetPlayerTwoScore(), count * sizeof(float));
+
+        // finished matches stay frozen for the rest of the ticks
+        std::memcpy(m_batch->GetInputs(), GetActions(), count);
+        for (std::uint32_t tick = 0; tick < ticks; ++tick)
+            m_batch->Step(UPDATE_MS);
+
+        const float* playerOne = m_batch->GetPlayerOneScore();
+        const float* playerTwo = m_batch->GetPlayerTwoScore();
+        float* reward = Field<float>(ENV_FIELD::REWARD);
+        for (std::size_t i = 0; i < count; ++i)
+            reward[i] = (playerOne[i] - m_previousOne[i]) - (playerTwo[i] - m_previousTwo[i]);
+        Publish();
+    }
+
+    // copies the batch's arrays into the mapping for the trainer to read
+    void Publish()
+    {
+        const std::size_t bytes = GetEnvCount() * sizeof(float);
+        std::memcpy(Field<float>(ENV_FIELD::BALL_X), m_batch->GetBallX(), bytes);
+        std::memcpy(Field<float>(ENV_FIELD::BALL_Y), m_batch->GetBallY(), bytes);
+        std::memcpy(Field<float>(ENV_FIELD::BALL_DX), m_batch->GetBallDX(), bytes);
+        std::memcpy(Field<float>(ENV_FIELD::BALL_DY), m_batch->GetBallDY(), bytes);
+        std::memcpy(Field<float>(ENV_FIELD::PLAYER_ONE_Y), m_batch->GetPlayerOneY(), bytes);
+        std::memcpy(Field<float>(ENV_FIELD::PLAYER_TWO_Y), m_batch->GetPlayerTwoY(), bytes);
+        std::memcpy(Field<float>(ENV_FIELD::PLAYER_ONE_SCORE), m_batch->GetPlayerOneScore(), bytes);
+        std::memcpy(Field<float>(ENV_FIELD::PLAYER_TWO_SCORE), m_batch->GetPlayerTwoScore(), bytes);
+        std::memcpy(Field<float>(ENV_FIELD::PLAY_STATE), m_batch->GetPlayState(), bytes);
+
+        std::uint8_t* done = Field<std::uint8_t>(ENV_FIELD::DONE);
+        for (std::size_t i = 0; i < GetEnvCount(); ++i)
+            done[i] = m_batch->IsFinished(i) ? 1 : 0;
+    }
+
+    std::unique_ptr<PongBatch> m_batch;
+    std::vector<float> m_previousOne;
+    std::vector<float> m_previousTwo;
+    std::uint32_t m_served;
+};
+
+// The trainer's side. Requests are synchronous: each returns once the
+// server has written the observations for it.
+class SharedEnvClient : public SharedEnvView
+{
+public:
+    SharedEnvClient()
+        :
+        m_sequence(0),
+        m_spins(SharedEnvSync::DefaultSpins())
+    {
+    }
+
+    // fails if no server has finished creating name
+    bool Open(const std::string& name)
+    {
+        m_control = nullptr;
+        if (!m_memory.Open(name) || m_memory.GetSize() < sizeof(SharedEnvControl))
+            return false;
+        SharedEnvControl* control = reinterpret_cast<SharedEnvControl*>(m_memory.GetData());
+        if (control->header.magic.load(std::memory_order_acquire) != SHARED_ENV_MAGIC ||
+            control->header.version != SHARED_ENV_VERSION || control->header.size > m_memory.GetSize())
+            return false;
+        m_control = control;
+        m_sequence = control->request.sequence.load(std::memory_order_acquire);
+        return true;
+    }
+
+    void SetSpins(const unsigned spins)
+    {
+        m_spins = spins;
+    }
+
+    // applies GetActions() for ticks ticks
+    void Step(const std::uint32_t ticks = 1)
+    {
+        Request(ENV_COMMAND::STEP, ticks);
+    }
+
+    void Reset()
+    {
+        Request(ENV_COMMAND::RESET, 0);
+    }
+
+    void Stop()
+    {
+        Request(ENV_COMMAND::STOP, 0);
+    }
+
+    // total time the server spent stepping, to tell it apart from signalling
+    std::uint64_t GetServerNanoseconds() const
+    {
+        return m_control->response.workNanoseconds;
+    }
+
+private:
+    void Request(const ENV_COMMAND command, const std::uint32_t ticks)
+    {
+        m_control->request.command = command;
+        m_control->request.ticks = ticks;
+        SharedEnvSync::Publish(m_control->request, ++m_sequence);
+        while (m_control->response.sequence.load(std::memory_order_acquire) != m_sequence)
+            SharedEnvSync::WaitForChange(m_control->response, m_sequence - 1, m_spins, std::chrono::milliseconds(100));
+    }
+
+    std::uint32_t m_sequence;
+    unsigned m_spins;
+};
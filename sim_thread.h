@@ -0,0 +1,303 @@
+#pragma once
+
+#include <SFML/Window.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+
+#include "frame_pacer.h"
+#include "input_queue.h"
+#include "pong_core.h"
+#include "pong_game.h"
+#include "profiler.h"
+#include "spsc_queue.h"
+#include "tick_rate.h"
+#include "triple_buffer.h"
+
+// Above this rate the simulation thread wakes once per SIMULATION_WAKE_MS
+// and runs the ticks due since; input keeps its timing, as each event
+// still lands in the tick it happened in.
+const float SIMULATION_WAKE_MS = 4;
+
+// the last two ticks of a match, as published for drawing
+struct PongSnapshot
+{
+    PongSnapshot(const PongGame& game)
+        :
+        previous(game.GetPrevious()),
+        current(game.GetSimulation()),
+        gameState(GAME_STATE::IN_GAME),
+        tickMilliseconds(UPDATE_MS),
+        tick(0),
+        hasInput(false)
+    {
+    }
+
+    PongSimulation previous;
+    PongSimulation current;
+    GAME_STATE gameState;
+    // time between previous and current
+    float tickMilliseconds;
+    // wall-clock time at which current is the state of the match
+    InputQueue::Clock::time_point tickEnd;
+    std::uint64_t tick;
+    // oldest input applied and not yet seen on screen, for latency
+    bool hasInput;
+    InputQueue::Clock::time_point oldestInput;
+};
+
+// Runs a local match on its own thread at a fixed tick rate, so a slow
+// present or a driver stall on the render thread no longer delays ticks or
+// input sampling. The window thread forwards its events through a lock-free
+// queue, with the time it received them, and draws whichever snapshot is
+// newest from a triple buffer. Between Start and the match ending, only this
+// thread touches the PongGame and InputQueue it was given.
+class SimulationThread
+{
+public:
+    SimulationThread(PongGame& game, InputQueue& inputs)
+        :
+        m_game(game),
+        m_inputs(inputs),
+        m_snapshots(PongSnapshot(game)),
+        m_stop(false),
+        m_tickMilliseconds(UPDATE_MS),
+        m_adaptiveTickRate(false),
+        m_tick(0),
+        m_hasPending(false),
+        m_pendingTick(0),
+        m_displayedTick(0),
+        m_droppedEvents(0)
+    {
+    }
+
+    ~SimulationThread()
+    {
+        Stop();
+    }
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    // the tick rate of matches started from now on; adaptive lets the thread
+    // slow its ticks when they cost too much, see TickRateGovernor
+    void SetTickRate(const float tickMilliseconds, const bool adaptive)
+    {
+        m_tickMilliseconds = tickMilliseconds;
+        m_adaptiveTickRate = adaptive;
+    }
+
+    void Start()
+    {
+        Stop();
+        m_stop.store(false, std::memory_order_relaxed);
+        PongSnapshot& snapshot = m_snapshots.GetWriteBuffer();
+        snapshot.previous = m_game.GetPrevious();
+        snapshot.current = m_game.GetSimulation();
+        snapshot.gameState = GAME_STATE::IN_GAME;
+        snapshot.tickMilliseconds = m_tickMilliseconds;
+        snapshot.tickEnd = InputQueue::Clock::now();
+        snapshot.tick = ++m_tick;
+        snapshot.hasInput = false;
+        m_snapshots.Publish();
+        m_hasPending = false;
+        m_thread = std::thread([this]() { Run(); });
+    }
+
+    // waits for the thread; the game and inputs are the caller's again
+    // afterwards, with the events pushed after its last tick applied so they
+    // are not replayed into the next match
+    void Stop()
+    {
+        if (!m_thread.joinable())
+            return;
+        m_stop.store(true, std::memory_order_relaxed);
+        m_thread.join();
+
+        QueuedEvent queued;
+        while (m_events.Pop(queued))
+            m_inputs.HandleEvent(queued.event, queued.time);
+    }
+
+    bool IsRunning() const
+    {
+        return m_thread.joinable();
+    }
+
+    // window thread; the event is applied as of time
+    void PushEvent(const sf::Event& event, const InputQueue::Clock::time_point time)
+    {
+        if (!m_events.Push({ event,time }))
+            ++m_droppedEvents;
+    }
+
+    // window thread; the newest published snapshot
+    const PongSnapshot& GetSnapshot()
+    {
+        m_snapshots.Update();
+        return m_snapshots.GetReadBuffer();
+    }
+
+    // how far between the snapshot's two ticks to draw at time now
+    static float GetInterpolation(const PongSnapshot& snapshot, const InputQueue::Clock::time_point now)
+    {
+        const float lag = std::chrono::duration<float, std::milli>(now - snapshot.tickEnd).count() / snapshot.tickMilliseconds;
+        return std::min(1.0f, std::max(0.0f, lag));
+    }
+
+    // window thread; call right after the snapshot from GetSnapshot is presented
+    void RecordDisplayed(const PongSnapshot& snapshot, const InputQueue::Clock::time_point displayTime)
+    {
+        m_displayedTick.store(snapshot.tick, std::memory_order_release);
+
+        // an input stays in every snapshot until one holding it is displayed
+        if (!snapshot.hasInput || (m_latency.samples > 0 && snapshot.oldestInput == m_lastReported))
+            return;
+        m_lastReported = snapshot.oldestInput;
+        m_latency.Record(std::chrono::duration<double, std::milli>(displayTime - snapshot.oldestInput).count());
+    }
+
+    const LatencyStats& GetLatency() const
+    {
+        return m_latency;
+    }
+
+    // wake period statistics of the last match, once it has stopped
+    const FrameStats& GetTickStats() const
+    {
+        return m_tickStats;
+    }
+
+    // tick cost and rate of the last match, once it has stopped
+    const TickRateStats& GetTickRateStats() const
+    {
+        return m_tickRateStats;
+    }
+
+    // events lost to a full queue, over every match
+    std::uint64_t GetDroppedEvents() const
+    {
+        return m_droppedEvents;
+    }
+
+private:
+    struct QueuedEvent
+    {
+        sf::Event event;
+        InputQueue::Clock::time_point time;
+    };
+
+    void Run()
+    {
+        Profiler::Get().SetThreadName("simulation");
+
+        TickRateGovernor governor(m_tickMilliseconds, m_adaptiveTickRate);
+        FramePacer pacer(m_tickMilliseconds, 0);
+        auto setTick = [&](const float tickMilliseconds)
+        {
+            // paced at the tick rate itself, so BeginFrame normally returns one
+            // step; fast ticks are batched and need no spinning for precision
+            const bool batched = tickMilliseconds < SIMULATION_WAKE_MS;
+            pacer.SetUpdateMilliseconds(tickMilliseconds);
+            pacer.SetTargetFps(1000 / (batched ? SIMULATION_WAKE_MS : tickMilliseconds));
+            pacer.SetSpinThreshold(batched ? std::chrono::milliseconds(0) : std::chrono::milliseconds(2));
+            m_game.SetTickMilliseconds(tickMilliseconds);
+        };
+        setTick(m_tickMilliseconds);
+        pacer.Resync();
+        auto drainEvents = [this]()
+        {
+            QueuedEvent queued;
+            while (m_events.Pop(queued))
+                m_inputs.HandleEvent(queued.event, queued.time);
+        };
+
+        GAME_STATE gameState = GAME_STATE::IN_GAME;
+        while (gameState == GAME_STATE::IN_GAME && !m_stop.load(std::memory_order_relaxed))
+        {
+            ProfileZone tickZone("tick");
+            const std::uint32_t steps = pacer.BeginFrame();
+            drainEvents();
+
+            const float tickMilliseconds = governor.GetTickMilliseconds();
+            std::uint32_t step = 0;
+            while (step < steps && gameState == GAME_STATE::IN_GAME)
+            {
+                ProfileZone zone("pong.Update");
+                const TickRateGovernor::Clock::time_point tickStart = TickRateGovernor::Clock::now();
+                gameState = m_game.Update(tickMilliseconds, m_inputs, pacer.GetStepEnd(step, steps));
+                governor.RecordTick(TickRateGovernor::Clock::now() - tickStart);
+                ++step;
+            }
+            // only the newest tick of a batch can be drawn
+            if (step > 0)
+                Publish(gameState, tickMilliseconds, pacer.GetStepEnd(step - 1, steps));
+
+            if (governor.Adjust(pacer.GetStats().droppedSteps))
+            {
+                setTick(governor.GetTickMilliseconds());
+                std::cout << "tick rate now " << 1000 / governor.GetTickMilliseconds() << " Hz" << std::endl;
+            }
+
+            ProfileZone zone("wait");
+            pacer.WaitForNextFrame(drainEvents);
+        }
+
+        m_tickStats = pacer.GetStats();
+        m_tickRateStats = governor.GetStats();
+        m_game.SetTickMilliseconds(m_tickMilliseconds);
+    }
+
+    void Publish(const GAME_STATE gameState, const float tickMilliseconds, const InputQueue::Clock::time_point tickEnd)
+    {
+        PongSnapshot& snapshot = m_snapshots.GetWriteBuffer();
+        snapshot.previous = m_game.GetPrevious();
+        snapshot.current = m_game.GetSimulation();
+        snapshot.gameState = gameState;
+        snapshot.tickMilliseconds = tickMilliseconds;
+        snapshot.tickEnd = tickEnd;
+        snapshot.tick = ++m_tick;
+
+        if (m_hasPending && m_displayedTick.load(std::memory_order_acquire) >= m_pendingTick)
+            m_hasPending = false;
+        InputQueue::Clock::time_point oldest;
+        if (m_inputs.TakeUnreported(oldest) && !m_hasPending)
+        {
+            m_hasPending = true;
+            m_pendingTick = snapshot.tick;
+            m_pendingInput = oldest;
+        }
+        snapshot.hasInput = m_hasPending;
+        snapshot.oldestInput = m_pendingInput;
+
+        m_snapshots.Publish();
+    }
+
+    PongGame& m_game;
+    InputQueue& m_inputs;
+    SpscQueue<QueuedEvent, 1024> m_events;
+    TripleBuffer<PongSnapshot> m_snapshots;
+    std::thread m_thread;
+    std::atomic<bool> m_stop;
+    float m_tickMilliseconds;
+    bool m_adaptiveTickRate;
+
+    // simulation thread
+    std::uint64_t m_tick;
+    bool m_hasPending;
+    std::uint64_t m_pendingTick;
+    InputQueue::Clock::time_point m_pendingInput;
+    FrameStats m_tickStats;
+    TickRateStats m_tickRateStats;
+
+    std::atomic<std::uint64_t> m_displayedTick;
+
+    // window thread
+    InputQueue::Clock::time_point m_lastReported;
+    LatencyStats m_latency;
+    std::uint64_t m_droppedEvents;
+};
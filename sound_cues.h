@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "pong_core.h"
+#include "spsc_queue.h"
+
+enum class SOUND : std::uint_fast8_t
+{
+    PADDLE_HIT,
+    WALL_BOUNCE,
+    SCORE,
+    COUNT
+};
+
+// from whichever thread steps the match to the one that plays the sounds
+typedef SpscQueue<SOUND, 64> SoundQueue;
+
+// The parts of a match a step's sounds are worked out from. Comparing them
+// before and after a step finds its hits, bounces and goals the same way for
+// every physics mode, without the simulation itself keeping any record.
+struct SoundCueState
+{
+    PLAY_STATE playState;
+    std::uint_fast8_t playerOneScore;
+    std::uint_fast8_t playerTwoScore;
+    float velocityY;
+
+    static SoundCueState Capture(const PongSimulation& simulation)
+    {
+        return { simulation.GetPlayState(),simulation.GetPlayerOneScore(),simulation.GetPlayerTwoScore(),simulation.GetBall().GetVelocity().y };
+    }
+
+    // queues at most one sound per step; a full queue drops it
+    static void Queue(const SoundCueState& before, const SoundCueState& after, SoundQueue& sounds)
+    {
+        const bool inPlay = before.playState == PLAY_STATE::TOWARD_PLAYER_ONE || before.playState == PLAY_STATE::TOWARD_PLAYER_TWO;
+        if (after.playerOneScore != before.playerOneScore || after.playerTwoScore != before.playerTwoScore)
+            sounds.Push(SOUND::SCORE);
+        else if (inPlay && after.playState != before.playState)
+            sounds.Push(SOUND::PADDLE_HIT);
+        else if (inPlay && before.velocityY * after.velocityY < 0)
+            sounds.Push(SOUND::WALL_BOUNCE);
+    }
+};
+
+const unsigned SOUND_SAMPLE_RATE = 44100;
+
+// The sounds themselves, mono 16-bit PCM: a decaying sine gliding from one
+// pitch to another. Baked into the asset pack, or made at startup without one.
+struct SoundSynthesizer
+{
+    static void Synthesize(const SOUND sound, std::vector<std::int16_t>& samples)
+    {
+        switch (sound)
+        {
+        case SOUND::PADDLE_HIT: Tone(660, 660, 0.05f, samples); break;
+        case SOUND::WALL_BOUNCE: Tone(330, 330, 0.035f, samples); break;
+        default: Tone(520, 390, 0.35f, samples); break;
+        }
+    }
+
+private:
+    static void Tone(const float startHertz, const float endHertz, const float seconds, std::vector<std::int16_t>& samples)
+    {
+        const std::size_t count = static_cast<std::size_t>(seconds * SOUND_SAMPLE_RATE);
+        const float attack = SOUND_SAMPLE_RATE * 0.002f;
+        samples.resize(count);
+        float phase = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const float t = static_cast<float>(i) / count;
+            phase += 2 * 3.14159265f * (startHertz + (endHertz - startHertz) * t) / SOUND_SAMPLE_RATE;
+            // a short fade in and the decay to silence keep the ends from clicking
+            const float envelope = std::fmin(1.0f, i / attack) * (1 - t) * (1 - t);
+            samples[i] = static_cast<std::int16_t>(std::sin(phase) * envelope * 12000);
+        }
+    }
+};
@@ -0,0 +1,628 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+#include "pong_core.h"
+
+// Wire format of the spectator feed, little-endian. A viewer is its address
+// and port.
+//
+//   watch    'P','V', acked sequence (u16)
+//            joins, acks the newest frame held and keeps the viewer alive;
+//            0 acks nothing
+//   update   'P','U', sequence (u16), baseline (u16), changed fields (u16),
+//            time since the baseline (varint), then for each changed field
+//            its difference from the baseline (zigzag varint), then how long
+//            after its frame the update was sent (varint)
+//            baseline 0 is a keyframe, coded against all zeros
+namespace SpectatorProtocol
+{
+    const std::size_t WATCH_SIZE = 4;
+    const std::size_t UPDATE_HEADER_SIZE = 8;
+
+    inline void PutU16(std::uint8_t* buffer, const std::uint16_t value)
+    {
+        buffer[0] = static_cast<std::uint8_t>(value);
+        buffer[1] = static_cast<std::uint8_t>(value >> 8);
+    }
+
+    inline std::uint16_t GetU16(const std::uint8_t* data)
+    {
+        return static_cast<std::uint16_t>(data[0] | data[1] << 8);
+    }
+
+    inline std::size_t PutVarint(std::uint8_t* buffer, std::uint32_t value)
+    {
+        std::size_t size = 0;
+        while (value >= 0x80)
+        {
+            buffer[size++] = static_cast<std::uint8_t>(value | 0x80);
+            value >>= 7;
+        }
+        buffer[size++] = static_cast<std::uint8_t>(value);
+        return size;
+    }
+
+    // false if the data ends first or the value runs past 32 bits
+    inline bool GetVarint(const std::uint8_t* data, const std::size_t size, std::size_t& position, std::uint32_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 35 && position < size; shift += 7)
+        {
+            const std::uint8_t byte = data[position++];
+            value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    inline std::uint32_t ZigZag(const std::int32_t value)
+    {
+        return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+    }
+
+    inline std::int32_t UnZigZag(const std::uint32_t value)
+    {
+        return static_cast<std::int32_t>(value >> 1) ^ -static_cast<std::int32_t>(value & 1);
+    }
+
+    // sequences wrap and skip 0; true when a is later than b
+    inline bool IsNewer(const std::uint16_t a, const std::uint16_t b)
+    {
+        return static_cast<std::int16_t>(a - b) > 0;
+    }
+}
+
+enum class SPECTATOR_FIELD : std::uint_fast8_t
+{
+    BALL_X,
+    BALL_Y,
+    BALL_DX,
+    BALL_DY,
+    PLAYER_ONE_Y,
+    PLAYER_ONE_DY,
+    PLAYER_TWO_Y,
+    PLAYER_TWO_DY,
+    PLAYER_ONE_SCORE,
+    PLAYER_TWO_SCORE,
+    MAX_SCORE,
+    PLAY_STATE,
+    COUNT
+};
+
+// The match as spectators see it: positions in 1/POSITION_SCALE pixels,
+// speeds in 1/POSITION_SCALE pixels a second, at a match time in
+// milliseconds. Between frames a viewer moves the ball and paddles on at
+// their speeds, with the ball riding the server's paddle while it waits to
+// serve, so a new frame is only needed when a speed changes: hits, bounces,
+// serves, goals and keys pressed or let go.
+struct SpectatorFrame
+{
+    static const std::size_t FIELD_COUNT = static_cast<std::size_t>(SPECTATOR_FIELD::COUNT);
+    static constexpr float POSITION_SCALE = 8;
+
+    std::uint32_t milliseconds = 0;
+    std::int32_t fields[FIELD_COUNT] = {};
+
+    std::int32_t Get(const SPECTATOR_FIELD field) const
+    {
+        return fields[static_cast<std::size_t>(field)];
+    }
+
+    void Set(const SPECTATOR_FIELD field, const std::int32_t value)
+    {
+        fields[static_cast<std::size_t>(field)] = value;
+    }
+
+    // current at milliseconds, one tick of tickMilliseconds after previous;
+    // the paddles' speeds are how far that tick moved them
+    static SpectatorFrame Capture(const PongSimulation& previous, const PongSimulation& current, const float tickMilliseconds, const std::uint32_t milliseconds)
+    {
+        const float perSecond = 1000 / tickMilliseconds;
+        const float playerOneY = current.GetPlayerOne().GetPositionSize().y;
+        const float playerTwoY = current.GetPlayerTwo().GetPositionSize().y;
+
+        SpectatorFrame frame;
+        frame.milliseconds = milliseconds;
+        frame.Set(SPECTATOR_FIELD::BALL_X, Quantize(current.GetBall().GetPosition().x));
+        frame.Set(SPECTATOR_FIELD::BALL_Y, Quantize(current.GetBall().GetPosition().y));
+        frame.Set(SPECTATOR_FIELD::BALL_DX, Quantize(current.GetBall().GetVelocity().x));
+        frame.Set(SPECTATOR_FIELD::BALL_DY, Quantize(current.GetBall().GetVelocity().y));
+        frame.Set(SPECTATOR_FIELD::PLAYER_ONE_Y, Quantize(playerOneY));
+        frame.Set(SPECTATOR_FIELD::PLAYER_ONE_DY, Quantize((playerOneY - previous.GetPlayerOne().GetPositionSize().y) * perSecond));
+        frame.Set(SPECTATOR_FIELD::PLAYER_TWO_Y, Quantize(playerTwoY));
+        frame.Set(SPECTATOR_FIELD::PLAYER_TWO_DY, Quantize((playerTwoY - previous.GetPlayerTwo().GetPositionSize().y) * perSecond));
+        frame.Set(SPECTATOR_FIELD::PLAYER_ONE_SCORE, current.GetPlayerOneScore());
+        frame.Set(SPECTATOR_FIELD::PLAYER_TWO_SCORE, current.GetPlayerTwoScore());
+        frame.Set(SPECTATOR_FIELD::MAX_SCORE, current.GetMaxScore());
+        frame.Set(SPECTATOR_FIELD::PLAY_STATE, static_cast<std::int32_t>(current.GetPlayState()));
+        return frame;
+    }
+
+    // this frame moved on to milliseconds, the same way on both ends
+    SpectatorFrame Extrapolate(const std::uint32_t to) const
+    {
+        const double seconds = static_cast<std::int32_t>(to - milliseconds) / 1000.0;
+        SpectatorFrame frame = *this;
+        frame.milliseconds = to;
+        Advance(frame, SPECTATOR_FIELD::PLAYER_ONE_Y, SPECTATOR_FIELD::PLAYER_ONE_DY, seconds);
+        Advance(frame, SPECTATOR_FIELD::PLAYER_TWO_Y, SPECTATOR_FIELD::PLAYER_TWO_DY, seconds);
+
+        const PLAY_STATE playState = static_cast<PLAY_STATE>(Get(SPECTATOR_FIELD::PLAY_STATE));
+        if (playState == PLAY_STATE::SERVE_PLAYER_ONE || playState == PLAY_STATE::SERVE_PLAYER_TWO)
+        {
+            const SPECTATOR_FIELD server = playState == PLAY_STATE::SERVE_PLAYER_ONE ? SPECTATOR_FIELD::PLAYER_ONE_Y : SPECTATOR_FIELD::PLAYER_TWO_Y;
+            frame.Set(SPECTATOR_FIELD::BALL_Y, Get(SPECTATOR_FIELD::BALL_Y) + frame.Get(server) - Get(server));
+        }
+        else
+        {
+            Advance(frame, SPECTATOR_FIELD::BALL_X, SPECTATOR_FIELD::BALL_DX, seconds);
+            Advance(frame, SPECTATOR_FIELD::BALL_Y, SPECTATOR_FIELD::BALL_DY, seconds);
+        }
+        return frame;
+    }
+
+    PongState ToState() const
+    {
+        PongState state;
+        state.ballX = Get(SPECTATOR_FIELD::BALL_X) / POSITION_SCALE;
+        state.ballY = Get(SPECTATOR_FIELD::BALL_Y) / POSITION_SCALE;
+        state.ballVelocityX = Get(SPECTATOR_FIELD::BALL_DX) / POSITION_SCALE;
+        state.ballVelocityY = Get(SPECTATOR_FIELD::BALL_DY) / POSITION_SCALE;
+        state.playerOneY = Get(SPECTATOR_FIELD::PLAYER_ONE_Y) / POSITION_SCALE;
+        state.playerTwoY = Get(SPECTATOR_FIELD::PLAYER_TWO_Y) / POSITION_SCALE;
+        state.playerOneScore = static_cast<std::uint8_t>(Get(SPECTATOR_FIELD::PLAYER_ONE_SCORE));
+        state.playerTwoScore = static_cast<std::uint8_t>(Get(SPECTATOR_FIELD::PLAYER_TWO_SCORE));
+        state.maxScore = static_cast<std::uint8_t>(Get(SPECTATOR_FIELD::MAX_SCORE));
+        state.playState = static_cast<PLAY_STATE>(Get(SPECTATOR_FIELD::PLAY_STATE));
+        return state;
+    }
+
+    static std::int32_t Quantize(const float value)
+    {
+        return static_cast<std::int32_t>(std::lround(value * POSITION_SCALE));
+    }
+
+private:
+    static void Advance(SpectatorFrame& frame, const SPECTATOR_FIELD position, const SPECTATOR_FIELD speed, const double seconds)
+    {
+        frame.Set(position, frame.Get(position) + static_cast<std::int32_t>(std::lround(frame.Get(speed) * seconds)));
+    }
+};
+
+struct SpectatorStats
+{
+    std::uint64_t viewers = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t encodes = 0;
+    std::uint64_t deltas = 0;
+    std::uint64_t keyframes = 0;
+    std::uint64_t resends = 0;
+    std::uint64_t bytesSent = 0;
+    std::uint64_t packetsReceived = 0;
+    std::uint64_t rejectedPackets = 0;
+    std::uint64_t timedOutViewers = 0;
+};
+
+// Streams one match to any number of viewers without a socket of its own:
+// the caller feeds it the match after every tick and the viewers' datagrams,
+// and sends what ForEachOutgoing hands back. Each viewer is sent the newest
+// frame as a delta against the newest frame it acknowledged, again every
+// RESEND_MILLISECONDS until it acknowledges, and as a keyframe every
+// KEYFRAME_MILLISECONDS. Viewers on the same baseline share one encoding,
+// so a tick costs a few compares per viewer once the frame is coded.
+class SpectatorBroadcast
+{
+public:
+    // frames kept as baselines; a viewer acked further back gets a keyframe
+    static const std::uint16_t HISTORY = 32;
+    static const std::uint32_t RESEND_MILLISECONDS = 100;
+    static const std::uint32_t KEYFRAME_MILLISECONDS = 5000;
+    static const std::uint32_t TIMEOUT_MILLISECONDS = 5000;
+    static const std::size_t MAX_UPDATE_SIZE = SpectatorProtocol::UPDATE_HEADER_SIZE + 5 * (SpectatorFrame::FIELD_COUNT + 2);
+    // how far a viewer's extrapolation may drift before a new frame is sent
+    static constexpr float SLACK_PIXELS = 1;
+
+    SpectatorBroadcast()
+        :
+        m_newest(0),
+        m_lastSequence(0)
+    {
+    }
+
+    // a datagram from a viewer at address/port
+    void HandlePacket(const std::uint8_t* data, const std::size_t size, const std::uint32_t address, const std::uint16_t port, const std::uint32_t milliseconds)
+    {
+        using namespace SpectatorProtocol;
+        if (size < WATCH_SIZE || data[0] != 'P' || data[1] != 'V')
+        {
+            ++m_stats.rejectedPackets;
+            return;
+        }
+        ++m_stats.packetsReceived;
+
+        const std::uint64_t key = static_cast<std::uint64_t>(address) << 16 | port;
+        std::unordered_map<std::uint64_t, std::size_t>::const_iterator found = m_viewerIndex.find(key);
+        if (found == m_viewerIndex.end())
+        {
+            Viewer viewer;
+            viewer.address = address;
+            viewer.port = port;
+            viewer.keyframeAt = milliseconds;
+            found = m_viewerIndex.emplace(key, m_viewers.size()).first;
+            m_viewers.push_back(viewer);
+            m_stats.viewers = m_viewers.size();
+        }
+
+        Viewer& viewer = m_viewers[found->second];
+        viewer.heardAt = milliseconds;
+        const std::uint16_t acked = GetU16(data + 2);
+        if (acked != 0 && Find(acked) != nullptr && (viewer.acked == 0 || IsNewer(acked, viewer.acked)))
+            viewer.acked = acked;
+    }
+
+    // the match after a tick; makes a new frame when the viewers'
+    // extrapolation of the newest one no longer holds
+    void Update(const PongSimulation& previous, const PongSimulation& current, const float tickMilliseconds, const std::uint32_t milliseconds)
+    {
+        const SpectatorFrame frame = SpectatorFrame::Capture(previous, current, tickMilliseconds, milliseconds);
+        if (m_newest != 0 && !Diverged(Find(m_newest)->Extrapolate(milliseconds), frame))
+            return;
+
+        m_lastSequence = static_cast<std::uint16_t>(m_lastSequence + 1 == 0 ? 1 : m_lastSequence + 1);
+        Stored& stored = m_history[m_lastSequence % HISTORY];
+        stored.sequence = m_lastSequence;
+        stored.frame = frame;
+        m_newest = m_lastSequence;
+        ++m_stats.frames;
+
+        // the cached encodings were of the previous frame
+        for (Encoding& encoding : m_encodings)
+            encoding.sequence = 0;
+        m_keyframe.sequence = 0;
+    }
+
+    // Calls send(address, port, data, size) for every packet due at
+    // milliseconds and drops viewers not heard from for TIMEOUT_MILLISECONDS.
+    template <class Send>
+    void ForEachOutgoing(const std::uint32_t milliseconds, Send send)
+    {
+        for (std::size_t i = 0; i < m_viewers.size();)
+        {
+            if (milliseconds - m_viewers[i].heardAt > TIMEOUT_MILLISECONDS)
+            {
+                Remove(i);
+                ++m_stats.timedOutViewers;
+                continue;
+            }
+            if (m_newest != 0)
+                SendTo(m_viewers[i], milliseconds, send);
+            ++i;
+        }
+    }
+
+    std::uint16_t GetNewestSequence() const
+    {
+        return m_newest;
+    }
+
+    const SpectatorFrame* GetNewest() const
+    {
+        return m_newest != 0 ? Find(m_newest) : nullptr;
+    }
+
+    const SpectatorStats& GetStats() const
+    {
+        return m_stats;
+    }
+
+private:
+    struct Viewer
+    {
+        std::uint32_t address = 0;
+        std::uint16_t port = 0;
+        std::uint16_t acked = 0;
+        std::uint16_t sent = 0;
+        std::uint32_t sentAt = 0;
+        std::uint32_t keyframeAt = 0;
+        std::uint32_t heardAt = 0;
+    };
+
+    struct Stored
+    {
+        std::uint16_t sequence = 0;
+        SpectatorFrame frame;
+    };
+
+    // the newest frame coded against one baseline; sequence 0 when stale
+    struct Encoding
+    {
+        std::uint16_t sequence = 0;
+        std::uint16_t baseline = 0;
+        std::size_t size = 0;
+        std::uint8_t data[MAX_UPDATE_SIZE];
+    };
+
+    const SpectatorFrame* Find(const std::uint16_t sequence) const
+    {
+        const Stored& stored = m_history[sequence % HISTORY];
+        if (stored.sequence != sequence || sequence == 0 || static_cast<std::uint16_t>(m_newest - sequence) >= HISTORY)
+            return nullptr;
+        return &stored.frame;
+    }
+
+    // paddles are judged by where they are, not how fast they went this
+    // tick: at fast tick rates a paddle tracking the ball moves in short
+    // pulses, and matching each would mean a frame every tick
+    static bool Diverged(const SpectatorFrame& predicted, const SpectatorFrame& actual)
+    {
+        const std::int32_t slack = static_cast<std::int32_t>(SLACK_PIXELS * SpectatorFrame::POSITION_SCALE);
+        for (std::size_t i = 0; i < SpectatorFrame::FIELD_COUNT; ++i)
+        {
+            const SPECTATOR_FIELD field = static_cast<SPECTATOR_FIELD>(i);
+            if (field == SPECTATOR_FIELD::PLAYER_ONE_DY || field == SPECTATOR_FIELD::PLAYER_TWO_DY)
+                continue;
+            const bool exact = field >= SPECTATOR_FIELD::PLAYER_ONE_SCORE;
+            if (std::abs(predicted.fields[i] - actual.fields[i]) > (exact ? 0 : slack))
+                return true;
+        }
+        return false;
+    }
+
+    template <class Send>
+    void SendTo(Viewer& viewer, const std::uint32_t milliseconds, Send send)
+    {
+        const bool keyframeDue = milliseconds - viewer.keyframeAt >= KEYFRAME_MILLISECONDS;
+        const bool behind = viewer.acked != m_newest;
+        const bool inFlight = viewer.sent == m_newest && milliseconds - viewer.sentAt < RESEND_MILLISECONDS;
+        if (!keyframeDue && (!behind || inFlight))
+            return;
+
+        const bool baselineKept = viewer.acked != 0 && Find(viewer.acked) != nullptr;
+        const Encoding& encoding = keyframeDue || !baselineKept ? GetEncoding(0) : GetEncoding(viewer.acked);
+        if (encoding.baseline == 0)
+        {
+            viewer.keyframeAt = milliseconds;
+            ++m_stats.keyframes;
+        }
+        else
+            ++m_stats.deltas;
+        if (!keyframeDue && viewer.sent == m_newest)
+            ++m_stats.resends;
+        viewer.sent = m_newest;
+        viewer.sentAt = milliseconds;
+
+        // only the age of the frame differs between viewers
+        std::uint8_t packet[MAX_UPDATE_SIZE + 5];
+        std::copy(encoding.data, encoding.data + encoding.size, packet);
+        const std::size_t size = encoding.size + SpectatorProtocol::PutVarint(packet + encoding.size, milliseconds - Find(m_newest)->milliseconds);
+        m_stats.bytesSent += size;
+        send(viewer.address, viewer.port, packet, size);
+    }
+
+    const Encoding& GetEncoding(const std::uint16_t baseline)
+    {
+        Encoding& encoding = baseline == 0 ? m_keyframe : m_encodings[baseline % HISTORY];
+        if (encoding.sequence == m_newest && encoding.baseline == baseline)
+            return encoding;
+
+        using namespace SpectatorProtocol;
+        static const SpectatorFrame ZERO;
+        const SpectatorFrame& base = baseline == 0 ? ZERO : *Find(baseline);
+        const SpectatorFrame& frame = *Find(m_newest);
+
+        std::uint8_t* data = encoding.data;
+        data[0] = 'P';
+        data[1] = 'U';
+        PutU16(data + 2, m_newest);
+        PutU16(data + 4, baseline);
+        std::size_t size = UPDATE_HEADER_SIZE;
+        size += PutVarint(data + size, frame.milliseconds - base.milliseconds);
+        std::uint16_t changed = 0;
+        for (std::size_t i = 0; i < SpectatorFrame::FIELD_COUNT; ++i)
+        {
+            if (frame.fields[i] == base.fields[i])
+                continue;
+            changed |= static_cast<std::uint16_t>(1 << i);
+            size += PutVarint(data + size, ZigZag(frame.fields[i] - base.fields[i]));
+        }
+        PutU16(data + 6, changed);
+
+        encoding.sequence = m_newest;
+        encoding.baseline = baseline;
+        encoding.size = size;
+        ++m_stats.encodes;
+        return encoding;
+    }
+
+    void Remove(const std::size_t index)
+    {
+        const Viewer& viewer = m_viewers[index];
+        m_viewerIndex.erase(static_cast<std::uint64_t>(viewer.address) << 16 | viewer.port);
+        if (index + 1 != m_viewers.size())
+        {
+            m_viewers[index] = m_viewers.back();
+            m_viewerIndex[static_cast<std::uint64_t>(m_viewers[index].address) << 16 | m_viewers[index].port] = index;
+        }
+        m_viewers.pop_back();
+        m_stats.viewers = m_viewers.size();
+    }
+
+    Stored m_history[HISTORY];
+    Encoding m_encodings[HISTORY];
+    Encoding m_keyframe;
+    std::uint16_t m_newest;
+    std::uint16_t m_lastSequence;
+
+    std::vector<Viewer> m_viewers;
+    std::unordered_map<std::uint64_t, std::size_t> m_viewerIndex;
+    SpectatorStats m_stats;
+};
+
+struct SpectatorViewStats
+{
+    std::uint64_t updates = 0;
+    std::uint64_t keyframes = 0;
+    // out of order, repeated, or against a baseline no longer held
+    std::uint64_t skipped = 0;
+    std::uint64_t rejected = 0;
+};
+
+// The viewer's end: decodes updates, acknowledges the newest frame and
+// extrapolates it for drawing. The view runs behind the match by the
+// quickest delivery seen so far, so an update normally arrives just as the
+// view reaches its time and the ball doesn't overshoot a bounce first.
+class SpectatorView
+{
+public:
+    // watches are sent at least this often to stay subscribed
+    static const std::uint32_t KEEPALIVE_MILLISECONDS = 1000;
+
+    SpectatorView()
+        :
+        m_newest(0),
+        m_hasClock(false),
+        m_clockOffset(0),
+        m_ackDue(true),
+        m_watchedAt(0)
+    {
+    }
+
+    // an update arriving at local time milliseconds
+    void HandlePacket(const std::uint8_t* data, const std::size_t size, const std::uint32_t milliseconds)
+    {
+        using namespace SpectatorProtocol;
+        if (size < UPDATE_HEADER_SIZE || data[0] != 'P' || data[1] != 'U')
+        {
+            ++m_stats.rejected;
+            return;
+        }
+
+        const std::uint16_t sequence = GetU16(data + 2);
+        const std::uint16_t baseline = GetU16(data + 4);
+        const std::uint16_t changed = GetU16(data + 6);
+        const SpectatorFrame* base = nullptr;
+        static const SpectatorFrame ZERO;
+        if (baseline == 0)
+            base = &ZERO;
+        else if (m_history[baseline % SpectatorBroadcast::HISTORY].sequence == baseline)
+            base = &m_history[baseline % SpectatorBroadcast::HISTORY].frame;
+
+        if (sequence == 0 || base == nullptr || (m_newest != 0 && !IsNewer(sequence, m_newest)))
+        {
+            // still acked, in case the ack that would stop the resends was lost
+            m_ackDue = true;
+            ++m_stats.skipped;
+            return;
+        }
+
+        SpectatorFrame frame = *base;
+        std::size_t position = UPDATE_HEADER_SIZE;
+        std::uint32_t value;
+        if (!GetVarint(data, size, position, value))
+        {
+            ++m_stats.rejected;
+            return;
+        }
+        frame.milliseconds = base->milliseconds + value;
+        for (std::size_t i = 0; i < SpectatorFrame::FIELD_COUNT; ++i)
+        {
+            if ((changed & (1 << i)) == 0)
+                continue;
+            if (!GetVarint(data, size, position, value))
+            {
+                ++m_stats.rejected;
+                return;
+            }
+            frame.fields[i] = base->fields[i] + UnZigZag(value);
+        }
+        std::uint32_t age;
+        if (!GetVarint(data, size, position, age))
+        {
+            ++m_stats.rejected;
+            return;
+        }
+
+        // sent at frame time + age; the smallest gap to here is the closest
+        // the clocks can be matched
+        const std::int64_t offset = static_cast<std::int64_t>(frame.milliseconds) + age - milliseconds;
+        if (!m_hasClock || offset > m_clockOffset)
+            m_clockOffset = offset;
+        m_hasClock = true;
+
+        Stored& stored = m_history[sequence % SpectatorBroadcast::HISTORY];
+        stored.sequence = sequence;
+        stored.frame = frame;
+        m_newest = sequence;
+        m_ackDue = true;
+        ++m_stats.updates;
+        if (baseline == 0)
+            ++m_stats.keyframes;
+    }
+
+    // the size of a watch packet to send at local time milliseconds, or 0
+    std::size_t WriteWatch(std::uint8_t* buffer, const std::uint32_t milliseconds)
+    {
+        if (!m_ackDue && milliseconds - m_watchedAt < KEEPALIVE_MILLISECONDS)
+            return 0;
+        m_ackDue = false;
+        m_watchedAt = milliseconds;
+        buffer[0] = 'P';
+        buffer[1] = 'V';
+        SpectatorProtocol::PutU16(buffer + 2, m_newest);
+        return SpectatorProtocol::WATCH_SIZE;
+    }
+
+    bool HasFrame() const
+    {
+        return m_newest != 0;
+    }
+
+    std::uint16_t GetNewestSequence() const
+    {
+        return m_newest;
+    }
+
+    const SpectatorFrame& GetNewest() const
+    {
+        return m_history[m_newest % SpectatorBroadcast::HISTORY].frame;
+    }
+
+    // the match time on view at local time milliseconds
+    std::uint32_t GetMatchMilliseconds(const std::uint32_t milliseconds) const
+    {
+        return static_cast<std::uint32_t>(milliseconds + m_clockOffset);
+    }
+
+    // the match as drawn at local time milliseconds; needs HasFrame
+    SpectatorFrame GetFrame(const std::uint32_t milliseconds) const
+    {
+        return GetNewest().Extrapolate(GetMatchMilliseconds(milliseconds));
+    }
+
+    const SpectatorViewStats& GetStats() const
+    {
+        return m_stats;
+    }
+
+private:
+    struct Stored
+    {
+        std::uint16_t sequence = 0;
+        SpectatorFrame frame;
+    };
+
+    Stored m_history[SpectatorBroadcast::HISTORY];
+    std::uint16_t m_newest;
+    bool m_hasClock;
+    std::int64_t m_clockOffset;
+    bool m_ackDue;
+    std::uint32_t m_watchedAt;
+    SpectatorViewStats m_stats;
+};
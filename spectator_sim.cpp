@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "match_server.h"
+#include "pong_bots.h"
+#include "pong_core.h"
+#include "rollback.h"
+#include "spectator.h"
+
+// Streams bot matches to many spectators at once, each behind its own
+// conditioned link both ways, on a simulated clock. Measures what the feed
+// costs per viewer: bytes and packets each way, the broadcaster's time, and
+// how far each viewer's extrapolated picture strays from the match at the
+// time it shows. After the matches the links run on until every viewer
+// should hold the newest frame, which is then checked.
+
+// UDP over IPv4 adds this much to every datagram
+const std::size_t UDP_IP_HEADER_BYTES = 28;
+// true states kept to compare views against; covers the delay of any link
+const std::size_t TRUTH_TICKS = 1024;
+const std::uint32_t DRAIN_MILLISECONDS = 3000;
+
+struct Viewer
+{
+    Viewer(const float latency, const float jitter, const float loss, const std::uint32_t seed)
+        :
+        down(latency, jitter, loss, seed),
+        up(latency, jitter, loss, seed + 1)
+    {
+    }
+
+    SpectatorView view;
+    LinkConditioner down;
+    LinkConditioner up;
+};
+
+struct Outgoing
+{
+    std::uint32_t viewer;
+    std::size_t size;
+    std::uint8_t data[SpectatorBroadcast::MAX_UPDATE_SIZE + 5];
+};
+
+struct Incoming
+{
+    std::uint32_t viewer;
+    std::vector<std::uint8_t> data;
+};
+
+struct Match
+{
+    Match(const std::uint_fast8_t scoreToWin, const std::uint32_t seed, const float tickMilliseconds)
+        :
+        simulation(scoreToWin),
+        previous(scoreToWin),
+        one(POLICY::CPU, true, seed, CpuSettings::Normal()),
+        two(POLICY::TRACK, false, seed + 1, CpuSettings())
+    {
+        one.SetTickMilliseconds(tickMilliseconds);
+        truth.resize(TRUTH_TICKS);
+    }
+
+    PongSimulation simulation;
+    PongSimulation previous;
+    PaddleController one;
+    PaddleController two;
+    SpectatorBroadcast broadcast;
+    std::vector<std::unique_ptr<Viewer>> viewers;
+    std::vector<SpectatorFrame> truth;
+    std::vector<Outgoing> outbox;
+    std::vector<Incoming> inbox;
+    std::size_t inboxSize = 0;
+};
+
+struct ViewStats
+{
+    std::uint64_t samples = 0;
+    double errorSum = 0;
+    double maxError = 0;
+    std::uint64_t within = 0;
+    std::uint64_t wrongScore = 0;
+    double delaySum = 0;
+};
+
+int main(int argc, char** argv)
+{
+    std::uint32_t matches = 2;
+    std::uint32_t viewers = 250;
+    double seconds = 60;
+    float tickMilliseconds = UPDATE_MS;
+    int scoreToWin = 5;
+    float latency = 30;
+    float jitter = 10;
+    float loss = 1;
+    std::uint32_t seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--matches") == 0 && hasValue)
+            matches = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--viewers") == 0 && hasValue)
+            viewers = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--seconds") == 0 && hasValue)
+            seconds = std::strtod(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--tick-rate") == 0 && hasValue)
+            tickMilliseconds = std::max(1000 / std::strtof(argv[++i], nullptr), MIN_UPDATE_MS);
+        else if (std::strcmp(argv[i], "--score") == 0 && hasValue)
+            scoreToWin = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--latency") == 0 && hasValue)
+            latency = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--jitter") == 0 && hasValue)
+            jitter = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--loss") == 0 && hasValue)
+            loss = std::strtof(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+            seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else
+        {
+            std::cerr << "usage: pong_spectator_sim [--matches N] [--viewers N] [--seconds S] [--tick-rate HZ]\n"
+                         "                          [--score N] [--latency MS] [--jitter MS] [--loss PERCENT] [--seed N]" << std::endl;
+            return 1;
+        }
+    }
+    if (scoreToWin < 1 || scoreToWin > 255 || matches == 0 || viewers == 0 || !(seconds > 0) || !std::isfinite(tickMilliseconds))
+    {
+        std::cerr << "need a score of 1 to 255, a match, a viewer, some time and a tick rate" << std::endl;
+        return 1;
+    }
+    const std::uint_fast8_t maxScore = static_cast<std::uint_fast8_t>(scoreToWin);
+
+    std::vector<Match> hosted;
+    hosted.reserve(matches);
+    for (std::uint32_t m = 0; m < matches; ++m)
+    {
+        hosted.emplace_back(maxScore, seed + m * 2, tickMilliseconds);
+        for (std::uint32_t v = 0; v < viewers; ++v)
+        {
+            const std::uint32_t viewerSeed = (seed + m * 0x9e3779b9u) ^ (v * 0x85ebca6bu);
+            hosted.back().viewers.emplace_back(new Viewer(latency, jitter, loss, viewerSeed));
+        }
+        hosted.back().outbox.resize(viewers);
+    }
+
+    const std::uint64_t playTicks = static_cast<std::uint64_t>(seconds * 1000 / tickMilliseconds);
+    const std::uint64_t drainTicks = static_cast<std::uint64_t>(DRAIN_MILLISECONDS / tickMilliseconds);
+    const LinkConditioner::Clock::duration tick = std::chrono::duration_cast<LinkConditioner::Clock::duration>(
+        std::chrono::duration<double, std::milli>(tickMilliseconds));
+
+    std::uint64_t bytesDown = 0;
+    std::uint64_t packetsDown = 0;
+    std::uint64_t bytesUp = 0;
+    std::uint64_t packetsUp = 0;
+    std::uint64_t finishedMatches = 0;
+    std::chrono::steady_clock::duration broadcastTime(0);
+    ViewStats stats;
+    std::vector<std::uint8_t> packet;
+    std::uint8_t watch[SpectatorProtocol::WATCH_SIZE];
+
+    LinkConditioner::Clock::time_point now;
+    for (std::uint64_t t = 1; t <= playTicks + drainTicks; ++t)
+    {
+        now += tick;
+        const std::uint32_t milliseconds = static_cast<std::uint32_t>(std::lround(t * static_cast<double>(tickMilliseconds)));
+        const bool playing = t <= playTicks;
+
+        for (Match& match : hosted)
+        {
+            // the broadcaster hears no more of the match while the links drain
+            if (playing)
+            {
+                match.previous = match.simulation;
+                const PongInput input = PaddleController::Combine(match.simulation,
+                    match.one.Decide(match.simulation), match.two.Decide(match.simulation));
+                if (match.simulation.Update(tickMilliseconds, input) != GAME_STATE::IN_GAME)
+                {
+                    ++finishedMatches;
+                    match.simulation = PongSimulation(maxScore);
+                }
+            }
+            match.truth[t % TRUTH_TICKS] = SpectatorFrame::Capture(match.previous, match.simulation, tickMilliseconds, milliseconds);
+
+            match.inboxSize = 0;
+            for (std::uint32_t v = 0; v < match.viewers.size(); ++v)
+            {
+                while (match.viewers[v]->up.Receive(now, packet))
+                {
+                    if (match.inbox.size() == match.inboxSize)
+                        match.inbox.emplace_back();
+                    Incoming& incoming = match.inbox[match.inboxSize++];
+                    incoming.viewer = v;
+                    incoming.data.swap(packet);
+                }
+            }
+
+            // only the broadcaster's own work is timed, not the links
+            std::size_t outgoing = 0;
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < match.inboxSize; ++i)
+                match.broadcast.HandlePacket(match.inbox[i].data.data(), match.inbox[i].data.size(), match.inbox[i].viewer, 0, milliseconds);
+            if (playing)
+                match.broadcast.Update(match.previous, match.simulation, tickMilliseconds, milliseconds);
+            match.broadcast.ForEachOutgoing(milliseconds, [&](const std::uint32_t address, const std::uint16_t, const std::uint8_t* data, const std::size_t size)
+            {
+                Outgoing& out = match.outbox[outgoing++];
+                out.viewer = address;
+                out.size = size;
+                std::memcpy(out.data, data, size);
+            });
+            broadcastTime += std::chrono::steady_clock::now() - start;
+
+            for (std::size_t i = 0; i < outgoing; ++i)
+            {
+                const Outgoing& out = match.outbox[i];
+                match.viewers[out.viewer]->down.Send(out.data, out.size, now);
+                bytesDown += out.size;
+                ++packetsDown;
+            }
+
+            for (const std::unique_ptr<Viewer>& viewer : match.viewers)
+            {
+                while (viewer->down.Receive(now, packet))
+                    viewer->view.HandlePacket(packet.data(), packet.size(), milliseconds);
+                const std::size_t size = viewer->view.WriteWatch(watch, milliseconds);
+                if (size > 0)
+                {
+                    viewer->up.Send(watch, size, now);
+                    bytesUp += size;
+                    ++packetsUp;
+                }
+
+                // the picture drawn now, against the match at the time it shows
+                if (!playing || !viewer->view.HasFrame())
+                    continue;
+                const std::uint32_t shown = viewer->view.GetMatchMilliseconds(milliseconds);
+                const std::uint64_t shownTick = static_cast<std::uint64_t>(shown / tickMilliseconds);
+                if (shownTick == 0 || shownTick > t || t - shownTick >= TRUTH_TICKS)
+                    continue;
+                const SpectatorFrame& truth = match.truth[shownTick % TRUTH_TICKS];
+                const SpectatorFrame drawn = viewer->view.GetNewest().Extrapolate(truth.milliseconds);
+                const double error = std::hypot(
+                    drawn.Get(SPECTATOR_FIELD::BALL_X) - truth.Get(SPECTATOR_FIELD::BALL_X),
+                    drawn.Get(SPECTATOR_FIELD::BALL_Y) - truth.Get(SPECTATOR_FIELD::BALL_Y)) / SpectatorFrame::POSITION_SCALE;
+                ++stats.samples;
+                stats.errorSum += error;
+                stats.maxError = std::max(stats.maxError, error);
+                if (error <= 2)
+                    ++stats.within;
+                if (drawn.Get(SPECTATOR_FIELD::PLAYER_ONE_SCORE) != truth.Get(SPECTATOR_FIELD::PLAYER_ONE_SCORE) ||
+                    drawn.Get(SPECTATOR_FIELD::PLAYER_TWO_SCORE) != truth.Get(SPECTATOR_FIELD::PLAYER_TWO_SCORE) ||
+                    drawn.Get(SPECTATOR_FIELD::PLAY_STATE) != truth.Get(SPECTATOR_FIELD::PLAY_STATE))
+                    ++stats.wrongScore;
+                stats.delaySum += milliseconds - shown;
+            }
+        }
+    }
+
+    // after the drain every viewer should hold the broadcaster's newest frame
+    std::uint64_t inSync = 0;
+    SpectatorStats totals;
+    std::uint64_t skipped = 0;
+    for (const Match& match : hosted)
+    {
+        const SpectatorFrame* newest = match.broadcast.GetNewest();
+        for (const std::unique_ptr<Viewer>& viewer : match.viewers)
+        {
+            const SpectatorView& view = viewer->view;
+            if (newest != nullptr && view.HasFrame() && view.GetNewestSequence() == match.broadcast.GetNewestSequence() &&
+                view.GetNewest().milliseconds == newest->milliseconds &&
+                std::equal(newest->fields, newest->fields + SpectatorFrame::FIELD_COUNT, view.GetNewest().fields))
+                ++inSync;
+            skipped += view.GetStats().skipped;
+        }
+        const SpectatorStats& broadcast = match.broadcast.GetStats();
+        totals.frames += broadcast.frames;
+        totals.encodes += broadcast.encodes;
+        totals.deltas += broadcast.deltas;
+        totals.keyframes += broadcast.keyframes;
+        totals.resends += broadcast.resends;
+        totals.timedOutViewers += broadcast.timedOutViewers;
+    }
+
+    const double viewerSeconds = static_cast<double>(matches) * viewers * (playTicks + drainTicks) * tickMilliseconds / 1000;
+    const double matchSeconds = static_cast<double>(matches) * playTicks * tickMilliseconds / 1000;
+    const double fullStateBytes = ServerProtocol::STATE_SIZE * 1000 / tickMilliseconds;
+    const double broadcastSeconds = std::chrono::duration<double>(broadcastTime).count();
+    const double simulatedSeconds = (playTicks + drainTicks) * tickMilliseconds / 1000;
+
+    std::cout << matches << " matches x " << viewers << " viewers, " << seconds << " s of play at "
+        << 1000 / tickMilliseconds << " Hz (" << finishedMatches << " matches finished), links "
+        << latency << " ms + " << jitter << " ms jitter, " << loss << "% loss\n"
+        << "down per viewer: " << bytesDown / viewerSeconds << " B/s in " << packetsDown / viewerSeconds << " packets/s ("
+        << (bytesDown + packetsDown * UDP_IP_HEADER_BYTES) / viewerSeconds << " B/s with UDP/IP headers)\n"
+        << "up per viewer: " << bytesUp / viewerSeconds << " B/s in " << packetsUp / viewerSeconds << " packets/s ("
+        << (bytesUp + packetsUp * UDP_IP_HEADER_BYTES) / viewerSeconds << " B/s with headers)\n"
+        << "a full state every tick would be " << fullStateBytes << " B/s ("
+        << fullStateBytes + UDP_IP_HEADER_BYTES * 1000 / tickMilliseconds << " B/s with headers)\n"
+        << "frames: " << totals.frames << " (" << totals.frames / matchSeconds << "/s per match)"
+        << "  encodes: " << totals.encodes
+        << "  sent deltas: " << totals.deltas
+        << " keyframes: " << totals.keyframes
+        << " resends: " << totals.resends
+        << "  skipped by viewers: " << skipped << "\n"
+        << "broadcaster: " << broadcastSeconds * 1e9 / viewerSeconds << " ns per viewer per second, "
+        << 100 * broadcastSeconds / matches / simulatedSeconds << "% of a core per match\n"
+        << "ball error px: mean " << (stats.samples > 0 ? stats.errorSum / stats.samples : 0.0)
+        << " max " << stats.maxError
+        << "  within 2 px: " << (stats.samples > 0 ? 100.0 * stats.within / stats.samples : 0.0) << "%"
+        << "  score or state behind: " << (stats.samples > 0 ? 100.0 * stats.wrongScore / stats.samples : 0.0) << "%"
+        << "  view delay ms: " << (stats.samples > 0 ? stats.delaySum / stats.samples : 0.0) << "\n"
+        << "viewers holding the newest frame after the drain: " << inSync << " of " << static_cast<std::uint64_t>(matches) * viewers
+        << "  timed out: " << totals.timedOutViewers << std::endl;
+
+    return inSync == static_cast<std::uint64_t>(matches) * viewers ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Fixed-capacity ring between one producer thread and one consumer thread.
+// Push and Pop never block or allocate; Push fails while the ring is full.
+// Each side caches the other's index and only rereads it when the ring
+// looks full or empty, so the shared indices stay out of the hot path.
+template <class T, std::size_t CAPACITY>
+class SpscQueue
+{
+public:
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+    bool Push(const T& value)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headCache == CAPACITY)
+        {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail - m_headCache == CAPACITY)
+                return false;
+        }
+
+        m_slots[tail & (CAPACITY - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(T& value)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tailCache)
+        {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tailCache)
+                return false;
+        }
+
+        value = m_slots[head & (CAPACITY - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // consumer side
+    alignas(64) std::atomic<std::size_t> m_head{ 0 };
+    std::size_t m_tailCache = 0;
+
+    // producer side
+    alignas(64) std::atomic<std::size_t> m_tail{ 0 };
+    std::size_t m_headCache = 0;
+
+    alignas(64) std::array<T, CAPACITY> m_slots;
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct WorkerStats
+{
+    std::uint64_t tasks = 0;
+    std::uint64_t stolen = 0;
+    double busySeconds = 0;
+};
+
+// Fork-join pool with one task deque per worker. ParallelFor deals chunks
+// out round-robin; a worker runs its own newest chunk first and, once its
+// deque is empty, steals the oldest chunk from another worker, so an uneven
+// split evens out without a shared queue everyone contends on. The calling
+// thread counts as one of the workers and helps until the loop is done.
+class ThreadPool
+{
+public:
+    // 0 uses one worker per hardware thread
+    explicit ThreadPool(unsigned threads)
+        :
+        m_generation(0),
+        m_pending(0),
+        m_stop(false)
+    {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads == 0)
+            threads = 1;
+
+        for (unsigned i = 0; i < threads; ++i)
+            m_workers.emplace_back(new Worker());
+        for (unsigned i = 1; i < threads; ++i)
+            m_threads.emplace_back(&ThreadPool::Run, this, i);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads)
+            thread.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned GetThreadCount() const
+    {
+        return static_cast<unsigned>(m_workers.size());
+    }
+
+    // Calls body(begin, end) over [0, count) in chunks of up to grain items
+    // and returns once every chunk has run. Not reentrant.
+    template <class Body>
+    void ParallelFor(const std::size_t count, std::size_t grain, Body& body)
+    {
+        if (count == 0)
+            return;
+        if (grain == 0)
+            grain = 1;
+
+        const std::size_t chunks = (count + grain - 1) / grain;
+        m_pending.store(chunks, std::memory_order_relaxed);
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk)
+        {
+            const std::size_t begin = chunk * grain;
+            const std::size_t end = begin + grain < count ? begin + grain : count;
+            Worker& worker = *m_workers[chunk % m_workers.size()];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back({ &Invoke<Body>,&body,begin,end });
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        while (m_pending.load(std::memory_order_acquire) > 0)
+        {
+            if (!RunOne(0))
+                std::this_thread::yield();
+        }
+    }
+
+    std::vector<WorkerStats> GetStats() const
+    {
+        std::vector<WorkerStats> stats;
+        for (const std::unique_ptr<Worker>& worker : m_workers)
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            stats.push_back(worker->stats);
+        }
+        return stats;
+    }
+
+private:
+    struct Task
+    {
+        void (*run)(void* context, std::size_t begin, std::size_t end);
+        void* context;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    struct Worker
+    {
+        mutable std::mutex mutex;
+        std::deque<Task> tasks;
+        WorkerStats stats;
+    };
+
+    template <class Body>
+    static void Invoke(void* context, const std::size_t begin, const std::size_t end)
+    {
+        (*static_cast<Body*>(context))(begin, end);
+    }
+
+    // runs one task from index's own deque, or stolen from another
+    bool RunOne(const std::size_t index)
+    {
+        Task task;
+        bool stolen = false;
+        if (!PopBack(*m_workers[index], task))
+        {
+            bool found = false;
+            for (std::size_t i = 1; i < m_workers.size() && !found; ++i)
+                found = PopFront(*m_workers[(index + i) % m_workers.size()], task);
+            if (!found)
+                return false;
+            stolen = true;
+        }
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        task.run(task.context, task.begin, task.end);
+        const std::chrono::duration<double> busy = std::chrono::steady_clock::now() - start;
+
+        {
+            Worker& worker = *m_workers[index];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            ++worker.stats.tasks;
+            worker.stats.stolen += stolen ? 1 : 0;
+            worker.stats.busySeconds += busy.count();
+        }
+        m_pending.fetch_sub(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    static bool PopBack(Worker& worker, Task& task)
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty())
+            return false;
+        task = worker.tasks.back();
+        worker.tasks.pop_back();
+        return true;
+    }
+
+    static bool PopFront(Worker& worker, Task& task)
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty())
+            return false;
+        task = worker.tasks.front();
+        worker.tasks.pop_front();
+        return true;
+    }
+
+    void Run(const std::size_t index)
+    {
+        std::uint64_t seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&]() { return m_stop || m_generation != seen; });
+                if (m_stop)
+                    return;
+                seen = m_generation;
+            }
+
+            while (RunOne(index))
+            {
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::uint64_t m_generation;
+    std::atomic<std::size_t> m_pending;
+    bool m_stop;
+};
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "pong_core.h"
+
+struct TickRateStats
+{
+    std::uint64_t ticks = 0;
+    double meanMicroseconds = 0;
+    double maxMicroseconds = 0;
+    // share of the wall time spent inside ticks, of one core
+    double load = 0;
+    float requestedHz = 0;
+    float currentHz = 0;
+    float lowestHz = 0;
+    std::uint32_t changes = 0;
+};
+
+// Times every tick and, when adaptive, picks the tick rate from what the
+// ticks cost. Each WINDOW it compares the time spent ticking with the time
+// that passed: over MAX_LOAD, or with steps dropped by the pacer, the rate is
+// halved, down to the classic UPDATE_MS rate at the slowest. It climbs back
+// one doubling at a time towards the requested rate once the faster rate
+// would have stayed under RAISE_LOAD for RAISE_WINDOWS in a row, so a
+// machine that can't keep up runs slower ticks instead of falling behind.
+class TickRateGovernor
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static constexpr double MAX_LOAD = 0.5;
+    static constexpr double RAISE_LOAD = 0.25;
+    static const std::uint32_t RAISE_WINDOWS = 4;
+
+    TickRateGovernor(const float tickMilliseconds, const bool adaptive)
+        :
+        m_requested(tickMilliseconds),
+        m_current(tickMilliseconds),
+        m_slowest(std::max(tickMilliseconds, UPDATE_MS)),
+        m_adaptive(adaptive),
+        m_start(Clock::now()),
+        m_windowStart(m_start),
+        m_windowBusy(0),
+        m_busy(0),
+        m_droppedSteps(0),
+        m_quietWindows(0)
+    {
+        m_stats.requestedHz = 1000 / tickMilliseconds;
+        m_stats.lowestHz = m_stats.requestedHz;
+    }
+
+    float GetTickMilliseconds() const
+    {
+        return m_current;
+    }
+
+    void RecordTick(const Clock::duration cost)
+    {
+        m_windowBusy += cost;
+        ++m_stats.ticks;
+        const double microseconds = std::chrono::duration<double, std::micro>(cost).count();
+        if (microseconds > m_stats.maxMicroseconds)
+            m_stats.maxMicroseconds = microseconds;
+    }
+
+    // call once a frame with the pacer's dropped step count; true when the
+    // tick changed and GetTickMilliseconds has the new one
+    bool Adjust(const std::uint64_t droppedSteps)
+    {
+        const Clock::time_point now = Clock::now();
+        const Clock::duration window = now - m_windowStart;
+        if (window < WINDOW)
+            return false;
+
+        const double load = static_cast<double>(m_windowBusy.count()) / window.count();
+        const bool dropped = droppedSteps > m_droppedSteps;
+        m_droppedSteps = droppedSteps;
+        m_busy += m_windowBusy;
+        m_windowBusy = Clock::duration(0);
+        m_windowStart = now;
+        if (!m_adaptive)
+            return false;
+
+        const float previous = m_current;
+        if ((load > MAX_LOAD || dropped) && m_current < m_slowest)
+        {
+            m_current = std::min(m_current * 2, m_slowest);
+            m_quietWindows = 0;
+        }
+        else if (m_current > m_requested && load * m_current / std::max(m_current / 2, m_requested) < RAISE_LOAD)
+        {
+            if (++m_quietWindows == RAISE_WINDOWS)
+            {
+                m_current = std::max(m_current / 2, m_requested);
+                m_quietWindows = 0;
+            }
+        }
+        else
+            m_quietWindows = 0;
+
+        if (m_current == previous)
+            return false;
+        ++m_stats.changes;
+        m_stats.lowestHz = std::min(m_stats.lowestHz, 1000 / m_current);
+        return true;
+    }
+
+    // starts a fresh window, for frames whose ticks ran on another thread
+    void Resync(const std::uint64_t droppedSteps)
+    {
+        m_busy += m_windowBusy;
+        m_windowBusy = Clock::duration(0);
+        m_windowStart = Clock::now();
+        m_droppedSteps = droppedSteps;
+        m_quietWindows = 0;
+    }
+
+    TickRateStats GetStats() const
+    {
+        TickRateStats stats = m_stats;
+        const Clock::duration busy = m_busy + m_windowBusy;
+        const Clock::duration elapsed = Clock::now() - m_start;
+        if (stats.ticks > 0)
+            stats.meanMicroseconds = std::chrono::duration<double, std::micro>(busy).count() / stats.ticks;
+        if (elapsed.count() > 0)
+            stats.load = static_cast<double>(busy.count()) / elapsed.count();
+        stats.currentHz = 1000 / m_current;
+        return stats;
+    }
+
+private:
+    static constexpr std::chrono::milliseconds WINDOW = std::chrono::milliseconds(500);
+
+    float m_requested;
+    float m_current;
+    float m_slowest;
+    bool m_adaptive;
+
+    Clock::time_point m_start;
+    Clock::time_point m_windowStart;
+    Clock::duration m_windowBusy;
+    Clock::duration m_busy;
+    std::uint64_t m_droppedSteps;
+    std::uint32_t m_quietWindows;
+
+    TickRateStats m_stats;
+};
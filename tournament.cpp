@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pong_ai.h"
+#include "pong_bots.h"
+#include "pong_core.h"
+#include "thread_pool.h"
+
+// Round-robin tournament between paddle bots. Every pairing plays the same
+// number of matches under the game's rules, swapping sides each match, and
+// the matches are spread over a thread pool. Each match is seeded from its
+// index alone, so the results do not depend on how many threads ran them.
+
+struct Entrant
+{
+    std::string name;
+    POLICY policy = POLICY::TRACK;
+    CpuSettings cpuSettings;
+    std::unique_ptr<RecordedPaddle> recording;
+};
+
+// one match, seen from the pairing's first entrant
+struct MatchResult
+{
+    std::uint8_t firstScore = 0;
+    std::uint8_t secondScore = 0;
+    bool finished = false;
+    std::uint32_t ticks = 0;
+    std::uint32_t rallies = 0;
+    std::uint32_t returns = 0;
+    std::uint32_t rallyTicks = 0;
+    std::uint32_t longestRally = 0;
+};
+
+struct Pairing
+{
+    std::size_t first;
+    std::size_t second;
+};
+
+struct TournamentSetup
+{
+    std::vector<Entrant> entrants;
+    std::vector<Pairing> pairings;
+    std::uint32_t seed = 1;
+    std::uint_fast8_t scoreToWin = 3;
+    std::uint64_t maxTicks = 100000;
+    PHYSICS physics = PHYSICS::TICK;
+};
+
+static std::uint32_t SeedFor(const std::uint32_t seed, const std::uint64_t match)
+{
+    std::uint64_t x = (static_cast<std::uint64_t>(seed) << 32) ^ match;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return static_cast<std::uint32_t>(x ^ (x >> 31));
+}
+
+static bool ParseEntrant(const char* spec, Entrant& entrant)
+{
+    entrant.name = spec;
+    if (std::strcmp(spec, "idle") == 0)
+        entrant.policy = POLICY::IDLE;
+    else if (std::strcmp(spec, "track") == 0)
+        entrant.policy = POLICY::TRACK;
+    else if (std::strcmp(spec, "random") == 0)
+        entrant.policy = POLICY::RANDOM;
+    else if (std::strcmp(spec, "cpu-easy") == 0 || std::strcmp(spec, "cpu-normal") == 0 || std::strcmp(spec, "cpu-hard") == 0)
+    {
+        entrant.policy = POLICY::CPU;
+        entrant.cpuSettings = spec[4] == 'e' ? CpuSettings::Easy() : spec[4] == 'h' ? CpuSettings::Hard() : CpuSettings::Normal();
+    }
+    else if (std::strncmp(spec, "recorded:", 9) == 0)
+    {
+        // player one's keys from a replay, as pong and pong_headless --record write them
+        entrant.policy = POLICY::RECORDED;
+        entrant.recording.reset(new RecordedPaddle());
+        if (!entrant.recording->Load(spec + 9, true))
+        {
+            std::cerr << "could not load replay " << spec + 9 << std::endl;
+            return false;
+        }
+    }
+    else
+        return false;
+    return true;
+}
+
+static MatchResult PlayMatch(const TournamentSetup& setup, const std::uint64_t match)
+{
+    const Pairing& pairing = setup.pairings[match % setup.pairings.size()];
+    const bool firstIsPlayerOne = match / setup.pairings.size() % 2 == 0;
+    const Entrant& one = setup.entrants[firstIsPlayerOne ? pairing.first : pairing.second];
+    const Entrant& two = setup.entrants[firstIsPlayerOne ? pairing.second : pairing.first];
+
+    const std::uint32_t seed = SeedFor(setup.seed, match);
+    PaddleController playerOne(one.policy, true, seed, one.cpuSettings, one.recording.get());
+    PaddleController playerTwo(two.policy, false, seed ^ 0x5bd1e995u, two.cpuSettings, two.recording.get());
+    PongSimulation simulation(setup.scoreToWin);
+
+    MatchResult result;
+    std::uint32_t rallyReturns = 0;
+    std::uint32_t rallyStart = 0;
+    GAME_STATE gameState = GAME_STATE::IN_GAME;
+    while (gameState == GAME_STATE::IN_GAME && result.ticks < setup.maxTicks)
+    {
+        const PLAY_STATE before = simulation.GetPlayState();
+        const std::uint_fast8_t scoresBefore = simulation.GetPlayerOneScore() + simulation.GetPlayerTwoScore();
+        const PongInput input = PaddleController::Combine(simulation, playerOne.Decide(simulation), playerTwo.Decide(simulation));
+        gameState = simulation.Step(setup.physics, UPDATE_MS, input);
+        ++result.ticks;
+
+        // a rally runs from the serve to the goal and is as long as its returns
+        const PLAY_STATE after = simulation.GetPlayState();
+        const bool served = (before == PLAY_STATE::SERVE_PLAYER_ONE || before == PLAY_STATE::SERVE_PLAYER_TWO) && after != before;
+        if (simulation.GetPlayerOneScore() + simulation.GetPlayerTwoScore() != scoresBefore)
+        {
+            ++result.rallies;
+            result.returns += rallyReturns;
+            result.rallyTicks += result.ticks - rallyStart;
+            if (rallyReturns > result.longestRally)
+                result.longestRally = rallyReturns;
+            rallyReturns = 0;
+        }
+        else if (served)
+            rallyStart = result.ticks;
+        else if (after != before)
+            ++rallyReturns;
+    }
+
+    result.finished = gameState != GAME_STATE::IN_GAME;
+    const std::uint8_t playerOneScore = static_cast<std::uint8_t>(simulation.GetPlayerOneScore());
+    const std::uint8_t playerTwoScore = static_cast<std::uint8_t>(simulation.GetPlayerTwoScore());
+    result.firstScore = firstIsPlayerOne ? playerOneScore : playerTwoScore;
+    result.secondScore = firstIsPlayerOne ? playerTwoScore : playerOneScore;
+    return result;
+}
+
+struct MatchRange
+{
+    const TournamentSetup& setup;
+    std::vector<MatchResult>& results;
+
+    void operator()(const std::size_t begin, const std::size_t end) const
+    {
+        for (std::size_t match = begin; match < end; ++match)
+            results[match] = PlayMatch(setup, match);
+    }
+};
+
+// Bradley-Terry fit of every result at once on the Elo scale, so unlike
+// match-by-match Elo updates the ratings do not depend on the order the
+// matches are counted in. Each pairing gets one extra drawn match, which
+// keeps an entrant that never lost or never won at a finite rating.
+static std::vector<double> FitRatings(const std::vector<std::vector<double>>& points, const std::vector<std::vector<double>>& played)
+{
+    const std::size_t count = points.size();
+    std::vector<double> strength(count, 1.0);
+    std::vector<double> next(count);
+    for (int iteration = 0; iteration < 10000; ++iteration)
+    {
+        double change = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            double won = 0;
+            double expected = 0;
+            for (std::size_t j = 0; j < count; ++j)
+            {
+                if (i == j)
+                    continue;
+                won += points[i][j] + 0.5;
+                expected += (played[i][j] + 1) / (strength[i] + strength[j]);
+            }
+            next[i] = won / expected;
+        }
+
+        // pin the geometric mean so the ratings centre on 1500
+        double logMean = 0;
+        for (const double s : next)
+            logMean += std::log(s) / count;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            next[i] /= std::exp(logMean);
+            change = std::fmax(change, std::fabs(std::log(next[i] / strength[i])));
+        }
+        strength.swap(next);
+        if (change < 1e-10)
+            break;
+    }
+
+    std::vector<double> ratings(count);
+    for (std::size_t i = 0; i < count; ++i)
+        ratings[i] = 1500 + 400 * std::log10(strength[i]);
+    return ratings;
+}
+
+static void PrintUsage()
+{
+    std::cerr << "usage: pong_tournament [--policy SPEC]... [--matches N] [--score N] [--seed N]\n"
+                 "                       [--max-ticks N] [--threads N] [--fixed-point]\n"
+                 "  SPEC: idle, track, random, cpu-easy, cpu-normal, cpu-hard or recorded:REPLAY\n"
+                 "  default: track random cpu-easy cpu-normal cpu-hard" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    TournamentSetup setup;
+    std::uint64_t matchesPerPairing = 1000;
+    unsigned threads = 0;
+    int scoreToWin = 3;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--policy") == 0 && hasValue)
+        {
+            setup.entrants.emplace_back();
+            if (!ParseEntrant(argv[++i], setup.entrants.back()))
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--matches") == 0 && hasValue)
+            matchesPerPairing = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--score") == 0 && hasValue)
+            scoreToWin = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--seed") == 0 && hasValue)
+            setup.seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--max-ticks") == 0 && hasValue)
+            setup.maxTicks = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--threads") == 0 && hasValue)
+            threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--fixed-point") == 0)
+            setup.physics = PHYSICS::FIXED_POINT;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (setup.entrants.empty())
+    {
+        for (const char* spec : { "track","random","cpu-easy","cpu-normal","cpu-hard" })
+        {
+            setup.entrants.emplace_back();
+            ParseEntrant(spec, setup.entrants.back());
+        }
+    }
+    if (setup.entrants.size() < 2 || matchesPerPairing == 0)
+    {
+        std::cerr << "need at least two policies and one match per pairing" << std::endl;
+        return 1;
+    }
+    if (scoreToWin < 1 || scoreToWin > 255)
+    {
+        std::cerr << "score to win must be between 1 and 255" << std::endl;
+        return 1;
+    }
+    setup.scoreToWin = static_cast<std::uint_fast8_t>(scoreToWin);
+
+    const std::size_t entrantCount = setup.entrants.size();
+    for (std::size_t first = 0; first < entrantCount; ++first)
+        for (std::size_t second = first + 1; second < entrantCount; ++second)
+            setup.pairings.push_back({ first,second });
+
+    // pairings interleaved, so any prefix of the matches covers all of them
+    const std::uint64_t matchCount = matchesPerPairing * setup.pairings.size();
+    std::vector<MatchResult> results(matchCount);
+    ThreadPool pool(threads);
+    MatchRange range{ setup,results };
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    pool.ParallelFor(matchCount, 4, range);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::vector<std::vector<double>> points(entrantCount, std::vector<double>(entrantCount, 0));
+    std::vector<std::vector<double>> played(entrantCount, std::vector<double>(entrantCount, 0));
+    std::vector<std::uint64_t> wins(entrantCount, 0);
+    std::vector<std::uint64_t> losses(entrantCount, 0);
+    std::vector<std::uint64_t> unfinished(entrantCount, 0);
+
+    // wide enough for the longest pairing name
+    int nameWidth = 24;
+    for (const Entrant& entrant : setup.entrants)
+        nameWidth = std::max(nameWidth, static_cast<int>(entrant.name.size() * 2 + 3));
+
+    std::uint64_t totalTicks = 0;
+    std::uint64_t hash = 14695981039346656037ull;
+    std::printf("\n%-*s %8s %8s %8s %10s %14s %10s %8s\n", nameWidth, "pairing", "matches", "first", "second", "unfinished", "returns/rally", "rally s", "longest");
+    for (std::size_t p = 0; p < setup.pairings.size(); ++p)
+    {
+        const Pairing& pairing = setup.pairings[p];
+        std::uint64_t firstWins = 0;
+        std::uint64_t secondWins = 0;
+        std::uint64_t rallies = 0;
+        std::uint64_t returns = 0;
+        std::uint64_t rallyTicks = 0;
+        std::uint32_t longest = 0;
+        for (std::uint64_t match = p; match < matchCount; match += setup.pairings.size())
+        {
+            const MatchResult& result = results[match];
+            totalTicks += result.ticks;
+            rallies += result.rallies;
+            returns += result.returns;
+            rallyTicks += result.rallyTicks;
+            longest = result.longestRally > longest ? result.longestRally : longest;
+            for (const std::uint32_t value : { std::uint32_t(result.firstScore),std::uint32_t(result.secondScore),result.ticks })
+            {
+                hash ^= value;
+                hash *= 1099511628211ull;
+            }
+
+            double firstPoints = 0.5;
+            if (!result.finished)
+            {
+                ++unfinished[pairing.first];
+                ++unfinished[pairing.second];
+            }
+            else if (result.firstScore > result.secondScore)
+            {
+                ++firstWins;
+                firstPoints = 1;
+            }
+            else
+            {
+                ++secondWins;
+                firstPoints = 0;
+            }
+            points[pairing.first][pairing.second] += firstPoints;
+            points[pairing.second][pairing.first] += 1 - firstPoints;
+            played[pairing.first][pairing.second] += 1;
+            played[pairing.second][pairing.first] += 1;
+        }
+        wins[pairing.first] += firstWins;
+        losses[pairing.first] += secondWins;
+        wins[pairing.second] += secondWins;
+        losses[pairing.second] += firstWins;
+
+        const std::string name = setup.entrants[pairing.first].name + " v " + setup.entrants[pairing.second].name;
+        std::printf("%-*s %8llu %8llu %8llu %10llu %14.2f %10.2f %8u\n", nameWidth, name.c_str(),
+            static_cast<unsigned long long>(matchesPerPairing),
+            static_cast<unsigned long long>(firstWins),
+            static_cast<unsigned long long>(secondWins),
+            static_cast<unsigned long long>(matchesPerPairing - firstWins - secondWins),
+            rallies > 0 ? static_cast<double>(returns) / rallies : 0.0,
+            rallies > 0 ? rallyTicks * UPDATE_MS / 1000 / rallies : 0.0,
+            longest);
+    }
+
+    const std::vector<double> ratings = FitRatings(points, played);
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < entrantCount; ++i)
+    {
+        std::size_t at = order.size();
+        while (at > 0 && ratings[order[at - 1]] < ratings[i])
+            --at;
+        order.insert(order.begin() + at, i);
+    }
+
+    std::printf("\n%-4s %-*s %8s %8s %8s %10s\n", "rank", nameWidth, "policy", "elo", "won", "lost", "unfinished");
+    for (std::size_t rank = 0; rank < order.size(); ++rank)
+    {
+        const std::size_t i = order[rank];
+        std::printf("%-4zu %-*s %8.0f %8llu %8llu %10llu\n", rank + 1, nameWidth, setup.entrants[i].name.c_str(), ratings[i],
+            static_cast<unsigned long long>(wins[i]),
+            static_cast<unsigned long long>(losses[i]),
+            static_cast<unsigned long long>(unfinished[i]));
+    }
+
+    std::cout << "\nmatches: " << matchCount
+        << "  threads: " << pool.GetThreadCount()
+        << "  seconds: " << elapsed.count()
+        << "  matches/s: " << matchCount / elapsed.count()
+        << "  ticks/s: " << totalTicks / elapsed.count() << "\n"
+        << "results hash: " << std::hex << hash << std::dec << std::endl;
+    return 0;
+}
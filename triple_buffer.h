@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Hands the newest value from one writer thread to one reader thread without
+// either of them ever waiting. The writer fills its back slot and swaps it
+// for the middle one; the reader swaps the middle slot for its front slot
+// whenever a newer value has arrived there. Values published faster than
+// the reader takes them are dropped, only the latest is kept.
+template <class T>
+class TripleBuffer
+{
+public:
+    explicit TripleBuffer(const T& initial)
+        :
+        m_slots{ initial,initial,initial },
+        m_back(0),
+        m_middle(1),
+        m_front(2)
+    {
+    }
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // writer only; the slot stays the writer's until Publish
+    T& GetWriteBuffer()
+    {
+        return m_slots[m_back];
+    }
+
+    // Makes the write buffer the newest value. Returns false if the value it
+    // replaces was never taken by the reader.
+    bool Publish()
+    {
+        const std::uint8_t previous = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel);
+        m_back = previous & INDEX;
+        return (previous & FRESH) == 0;
+    }
+
+    // reader only; moves to the newest value, returns false if there is none since last time
+    bool Update()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    // reader only; stays valid and unchanged until the next Update
+    const T& GetReadBuffer() const
+    {
+        return m_slots[m_front];
+    }
+
+private:
+    static const std::uint8_t INDEX = 3;
+    static const std::uint8_t FRESH = 4;
+
+    T m_slots[3];
+    std::uint8_t m_back;
+    // slot index, plus FRESH while it holds a value the reader hasn't taken
+    alignas(64) std::atomic<std::uint8_t> m_middle;
+    alignas(64) std::uint8_t m_front;
+};